@@ -1,8 +1,9 @@
 struct Input
 {
-    float4 position : Position;
+    float3 position : Position;
     float4 color : Color;
-    float4 normal : Normal;
+    float2 normal : Normal; // octahedral
+    float2 uv : TexCoord;
 };
 
 struct Output
@@ -18,13 +19,21 @@ cbuffer ModelBuffer { float4x4 model; };
 [[vk::binding(1, 0)]] // binding slot 1, descriptor set 0
 cbuffer ViewProjectionBuffer { float4x4 view, proj, viewProj; };
 
+// inverse of the octahedral encoding on the cpu side
+float3 decode_oct(float2 oct)
+{
+    float3 n = float3(oct, 1.0f - abs(oct.x) - abs(oct.y));
+    float t = saturate(-n.z);
+    n.xy -= (step(0.0f, n.xy) * 2.0f - 1.0f) * t;
+    return normalize(n);
+}
 
 Output main(Input input)
 {
     Output output;
-    output.worldPos = input.position;
+    output.worldPos = float4(input.position, 1.0f);
     output.screenPos = mul(viewProj, output.worldPos);
-    output.color = input.color;
-    output.normal = input.normal;
+    output.color = float4(input.color.rgb, input.uv.x); // uv stays hidden in w for the pixel shaders
+    output.normal = float4(decode_oct(input.normal), input.uv.y);
     return output;
 }
\ No newline at end of file
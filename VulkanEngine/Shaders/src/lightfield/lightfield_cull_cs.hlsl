@@ -0,0 +1,81 @@
+struct DrawRecord
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+    uint3 padding;
+    float4 sphere; // bounding sphere, xyz center and w radius
+};
+struct DrawCommand
+{
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+[[vk::binding(0, 0)]] // binding slot 0, descriptor set 0
+StructuredBuffer<DrawRecord> records;
+[[vk::binding(1, 0)]] // binding slot 1, descriptor set 0
+RWStructuredBuffer<DrawCommand> commands;
+
+[[vk::binding(0, 1)]] // binding slot 0, descriptor set 1
+cbuffer CullBuffer
+{
+    float4x4 view;
+    float4 posOffsets[9];
+    float4 planes[6]; // frustum planes in view space, normals point inwards
+};
+
+[[vk::binding(0, 2)]] // binding slot 0, descriptor set 2
+StructuredBuffer<float4x4> models;
+
+struct PCS
+{
+    uint nDraws;
+};
+[[vk::push_constant]] PCS pcs;
+
+static const uint nViews = 9;
+
+void write_command(uint iCommand, DrawRecord record, bool bVisible)
+{
+    DrawCommand command;
+    command.indexCount = record.indexCount;
+    command.instanceCount = bVisible ? 1 : 0;
+    command.firstIndex = record.firstIndex;
+    command.vertexOffset = record.vertexOffset;
+    command.firstInstance = record.firstInstance;
+    commands[iCommand] = command;
+}
+
+// one thread per entity, writing its draw for each view and one for all views at once (multiview)
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    uint iDraw = id.x;
+    if (iDraw >= pcs.nDraws) return;
+
+    // same transform as the forward pass, the view matrix is rigid so only the model's scale grows the radius
+    DrawRecord record = records[iDraw];
+    float4x4 model = models[record.firstInstance];
+    float3 center = mul(view, mul(model, float4(record.sphere.xyz, 1.0f))).xyz;
+    float3x3 axes = transpose((float3x3) model); // rows are the scaled model axes
+    float3 scales = float3(length(axes[0]), length(axes[1]), length(axes[2]));
+    record.sphere.w *= max(scales.x, max(scales.y, scales.z));
+
+    bool bAnyVisible = false;
+    for (uint iView = 0; iView < nViews; iView++) {
+        float3 viewCenter = center + posOffsets[iView].xyz;
+        bool bVisible = true;
+        for (uint i = 0; i < 6; i++) {
+            bVisible = bVisible && dot(planes[i].xyz, viewCenter) + planes[i].w > -record.sphere.w;
+        }
+        write_command(iView * pcs.nDraws + iDraw, record, bVisible);
+        bAnyVisible = bAnyVisible || bVisible;
+    }
+    write_command(nViews * pcs.nDraws + iDraw, record, bAnyVisible);
+}
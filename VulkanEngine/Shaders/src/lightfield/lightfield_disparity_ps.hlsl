@@ -3,15 +3,17 @@ struct PCS
     uint iRenderMode;
     uint iFilterMode;
     uint iPostProcessingMode;
-    
+
     float depthModA;
     float depthModB;
-    
+
     uint bUseHeat;
 };
 [[vk::push_constant]] PCS pcs;
-Texture2D colorTex : register(t0);
-Texture2D<float> comparisonTex : register(t1);
+Texture2D gradientsTex : register(t0); // Lx, Ly, Lu, Lv
+Texture2D disparityTex : register(t1); // disparity, confidence, filter index
+Texture2D<float> comparisonTex : register(t2);
+Texture2DArray colBuffArr : register(t3);
 
 float4 get_heat(float val)
 {
@@ -20,97 +22,104 @@ float4 get_heat(float val)
     return float4(sin(heatLvl), sin(heatLvl * 2), cos(heatLvl), 1.0f);
 }
 
-float convert_back(float s)
-{
-    return s * 20.0f - 10.0f;
-}
-
-float4 read_color(uint2 pos)
+// basically post processing
+float read_disparity(uint2 pos)
 {
-    if (pcs.iRenderMode == 3)
+    // TODO:
+    // (haar wavelet)
+    if (pcs.iPostProcessingMode == 0) // no processing
     {
-        float f = colorTex[pos].r;
-        return get_heat(convert_back(f));
+        return disparityTex[pos].x;
     }
-    
-    if (pcs.iRenderMode == 7)
+    else if (pcs.iPostProcessingMode == 1) // 3x3 average blur
     {
-        float f = colorTex[pos].r;
-        return convert_back(f).rrrr;
+        float val = 0.0f;
+        for (int x = -1; x < 2; x++) {
+            for (int y = -1; y < 2; y++) {
+                val += disparityTex[uint2(pos.x + x, pos.y + y)].x;
+            }
+        }
+        return val / 9.0f;
     }
-    else
+    else // 3x3 gauss blur
     {
-        return colorTex[pos];
+        float gauss[9] =
+        {
+            1.0f / 16.0f, 1.0f / 8.0f, 1.0f / 16.0f,
+            1.0f / 8.0f, 1.0f / 4.0f, 1.0f / 8.0f,
+            1.0f / 16.0f, 1.0f / 8.0f, 1.0f / 16.0f
+
+            //0.075f, 0.124f, 0.075f,
+            //0.124f, 0.204f, 0.124f,
+            //0.075f, 0.124f, 0.075f
+        };
+
+        float val = 0.0f;
+        for (int x = -1; x < 2; x++)
+        {
+            for (int y = -1; y < 2; y++)
+            {
+                float gaussFactor = gauss[(x + 1) + (y + 1) * 3];
+                val += disparityTex[uint2(pos.x + x, pos.y + y)].x * gaussFactor;
+            }
+        }
+        return val;
     }
 }
 
-// basically post processing
+// maps the canonical outputs of the gradients pass to the selected visualisation
 float4 main(float4 screenPos : SV_Position) : SV_Target
 {
-    // TODO: 
-    // gauss blur
-    // general average
-    // (haar wavelet)
-    if (pcs.iRenderMode == 6)
+    uint2 pos = uint2(screenPos.x, screenPos.y);
+
+    if (pcs.iRenderMode == 0) // middle view
     {
-        float comparison = comparisonTex[uint2(screenPos.x, screenPos.y)];
-        return get_heat(comparison);
+        return colBuffArr[uint3(pos, 4)]; // TODO: switch between views?
     }
-    else
+    else if (pcs.iRenderMode == 1) // gradients view (Lx & Lu)
     {
-        float4 color;
-        color.w = 1.0f;
-        if (pcs.iPostProcessingMode == 0) // no processing
-        {
-            color = read_color(uint2(screenPos.x, screenPos.y));
-        }
-        else if (pcs.iPostProcessingMode == 1) // 3x3 average blur
-        {
-            float3 val = float3(0.0f, 0.0f, 0.0f);
-            for (int x = -1; x < 2; x++) {
-                for (int y = -1; y < 2; y++) {
-                    val += read_color(uint2(screenPos.x + x, screenPos.y + y)).xyz;
-                }
-            }
-            color.xyz = val / 9.0f;
-        }
-        else // 3x3 gauss blur
-        {
-            float gauss[9] =
-            {
-                1.0f / 16.0f, 1.0f / 8.0f, 1.0f / 16.0f,
-                1.0f / 8.0f, 1.0f / 4.0f, 1.0f / 8.0f,
-                1.0f / 16.0f, 1.0f / 8.0f, 1.0f / 16.0f
-                
-                //0.075f, 0.124f, 0.075f,
-                //0.124f, 0.204f, 0.124f,
-                //0.075f, 0.124f, 0.075f
-            };
-            
-            float3 val = float3(0.0f, 0.0f, 0.0f);
-            for (int x = -1; x < 2; x++)
-            {
-                for (int y = -1; y < 2; y++)
-                {
-                    float gaussFactor = gauss[(x + 1) + (y + 1) * 3];
-                    val += read_color(uint2(screenPos.x + x, screenPos.y + y)).xyz * gaussFactor;
-                }
-            }
-            color.xyz = val;
-            
-        }
-        
-        if (pcs.iRenderMode == 7) // comparison mode, comparing approximated disparity with approximated depth
-        {
-            float comparison = comparisonTex[uint2(screenPos.x, screenPos.y)];
-            //float disp = read_color(uint2(screenPos.x, screenPos.y)).r;
-            float disp = color.x;
-        //return get_heat(comparison - disp);
-            return (comparison - disp) * (comparison - disp);
-        }
-        else
+        float4 gradients = gradientsTex[pos];
+        return float4(gradients.x, gradients.z, 0.0f, 1.0f);
+    }
+    else if (pcs.iRenderMode == 2) // gradients view (Ly, Lv)
+    {
+        float4 gradients = gradientsTex[pos];
+        return float4(gradients.y, gradients.w, 0.0f, 1.0f);
+    }
+    else if (pcs.iRenderMode == 3) // disparity view
+    {
+        return get_heat(read_disparity(pos));
+    }
+    else if (pcs.iRenderMode == 4) // depth view
+    {
+        // derive depth from disparity
+        float depth = 1.0f / (pcs.depthModA + pcs.depthModB * abs(read_disparity(pos)));
+        return get_heat(depth);
+    }
+    else if (pcs.iRenderMode == 5) // certainty view
+    {
+        // scale certainty to make it visible
+        float certainty = disparityTex[pos].y * 500.0f;
+        return get_heat(certainty);
+    }
+    else if (pcs.iRenderMode == 6) // ground truth view
+    {
+        return get_heat(comparisonTex[pos]);
+    }
+    else if (pcs.iRenderMode == 7) // comparison mode, comparing approximated disparity with ground truth
+    {
+        float diff = comparisonTex[pos] - read_disparity(pos);
+        return float4((diff * diff).rrr, 1.0f);
+    }
+    else // filter size view
+    {
+        float4 filterColors[4] =
         {
-            return color;
-        }
+            float4(1.0f, 1.0f, 1.0f, 1.0f), // 3-tap
+            float4(1.0f, 0.0f, 0.0f, 1.0f), // 5-tap
+            float4(0.0f, 1.0f, 0.0f, 1.0f), // 7-tap
+            float4(0.0f, 0.0f, 1.0f, 1.0f)  // 9-tap
+        };
+        return filterColors[(uint) disparityTex[pos].z];
     }
-}
\ No newline at end of file
+}
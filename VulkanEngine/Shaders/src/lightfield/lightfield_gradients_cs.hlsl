@@ -54,7 +54,12 @@ struct PCS
     uint bUseHeat;
 };
 [[vk::push_constant]] PCS pcs;
-Texture2DArray colBuffArr : register(t0);
+[[vk::binding(0, 0)]] // binding slot 0, descriptor set 0
+Texture2DArray colBuffArr;
+[[vk::binding(1, 0)]] [[vk::image_format("rgba16f")]]
+RWTexture2D<float4> gradientsOut; // Lx, Ly, Lu, Lv
+[[vk::binding(2, 0)]] [[vk::image_format("rgba32f")]]
+RWTexture2D<float4> disparityOut; // disparity, confidence, filter index
 
 float4 get_gradients(int3 texPos, int tapSize, float p[9], float d[9])
 {
@@ -115,20 +120,16 @@ float2 get_disparity(float4 gradients)
     float disparity = a / confidence;
     return float2(disparity, confidence);
 }
-float4 get_heat(float val)
-{
-    // heatmap view (https://www.shadertoy.com/view/WslGRN)
-    float heatLvl = val * 3.14159265 / 2;
-    return float4(sin(heatLvl), sin(heatLvl * 2), cos(heatLvl), 1.0f);
-}
-float convert(float val)
-{
-    return (val + 10.0f) / 20.0f;
-}
 
-float4 main(float4 screenPos : SV_Position) : SV_Target
+// one thread per pixel, groups past the image edges do nothing
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
 {
-    int3 texPos = int3(screenPos.xy, 0);
+    uint width, height;
+    gradientsOut.GetDimensions(width, height);
+    if (id.x >= width || id.y >= height)
+        return;
+    int3 texPos = int3(id.xy, 0);
     
     // derivative approximation filters
     float p_tap3[9] = {  0.229879f,  0.540242f,  0.229879f,/**/0.000000f, 0.000000f,    0.000000f, 0.000000f,    0.000000f, 0.000000f };
@@ -159,6 +160,7 @@ float4 main(float4 screenPos : SV_Position) : SV_Target
     float4 gradients;
     float disparity;
     float certainty;
+    uint filterIndex = 0;
     // choose gradients
     if (pcs.iFilterMode == 0)
     {
@@ -172,6 +174,8 @@ float4 main(float4 screenPos : SV_Position) : SV_Target
                 allGradients[1] > cutoff || allGradients[1] < -cutoff ? allGradients[1] :
                 allGradients[2] > cutoff || allGradients[2] < -cutoff ? allGradients[2] :
                 allGradients[3] > cutoff || allGradients[3] < -cutoff ? allGradients[3] : allGradients[0];
+            disparity = get_disparity(gradients).x;
+            certainty = get_disparity(gradients).y;
         }
         // choose the filter with the highest certainty
         else
@@ -185,61 +189,18 @@ float4 main(float4 screenPos : SV_Position) : SV_Target
             }
             gradients = allGradients[baseIndex];
             disparity = allDisparities[baseIndex].x;
-            
+            filterIndex = baseIndex;
         }
     }
     else // specific filter for gradients
     {
-        uint index = pcs.iFilterMode - 1u;
-        gradients = allGradients[index];
-        disparity = allDisparities[index].x;
-        certainty = allDisparities[index].y;
+        filterIndex = pcs.iFilterMode - 1u;
+        gradients = allGradients[filterIndex];
+        disparity = allDisparities[filterIndex].x;
+        certainty = allDisparities[filterIndex].y;
     }
     
-    if (pcs.iRenderMode == 0) // middle view
-    {
-        return colBuffArr[uint3(screenPos.xy, 4)]; // TODO: switch between views?
-    }
-    else if (pcs.iRenderMode == 1) // gradients view (Lx & Lu)
-    {
-        return float4(gradients.x, gradients.z, 0.0f, 1.0f);
-    }
-    else if (pcs.iRenderMode == 2) // gradients view (Ly, Lv)
-    {
-        return float4(gradients.y, gradients.w, 0.0f, 1.0f);
-    }
-    else if (pcs.iRenderMode == 3 || pcs.iRenderMode == 7) // disparity view
-    {
-        float s = disparity.x;
-        //col = float4(s, s, s, 1.0f);
-        
-        return convert(s).rrrr;
-    }
-    else if (pcs.iRenderMode == 4) // depth view
-    {
-        // derive depth from disparity
-        //float depth = 1.0f / (pcs.depthModA + pcs.depthModB * disparity.x);
-        float depth = 1.0f / (pcs.depthModA + pcs.depthModB * abs(disparity.x));
-        //col = float4(depth, depth, depth, 1.0f);
-        
-        return get_heat(depth);
-    }
-    else if (pcs.iRenderMode == 5) // certainty view
-    {
-        // scale certainty to make it visible
-        certainty *= 500.0f;
-        return (get_heat(certainty));
-    }
-    else // passthrough
-    {
-        // when gradients equal 0, choose larger filter size
-        //const float cutoff = 0.000001f;
-        //gradients =
-        //    allGradients[0] > cutoff || allGradients[0] < -cutoff ? float4(0.0f, 0.0f, 0.0f, 1.0f) :
-        //    allGradients[1] > cutoff || allGradients[1] < -cutoff ? float4(1.0f, 0.0f, 0.0f, 1.0f) :
-        //    allGradients[2] > cutoff || allGradients[2] < -cutoff ? float4(0.0f, 1.0f, 0.0f, 1.0f) :
-        //    allGradients[3] > cutoff || allGradients[3] < -cutoff ? float4(0.0f, 0.0f, 1.0f, 1.0f) : float4(1.0f, 1.0f, 1.0f, 1.0f);
-        
-        return float4(0.0f, 0.0f, 0.0f, 1.0f);
-    }
+    // canonical outputs, all visualisation happens in the disparity pass
+    gradientsOut[id.xy] = gradients;
+    disparityOut[id.xy] = float4(disparity, certainty, (float) filterIndex, 0.0f);
 }
\ No newline at end of file
@@ -5,10 +5,43 @@ struct Input
     float4 normal : Normal;
 };
 
-float4 main(Input input) : SV_Target
+struct Output
+{
+    float4 color : SV_Target0;
+    float disparity : SV_Target1; // exact ground truth for the estimators
+};
+
+[[vk::binding(2, 1)]] // binding slot 2, descriptor set 1
+cbuffer OffsetBuffer { float4 posOffsets[9]; float4 disparityScale; };
+
+// pseudo random unit gradient of a lattice cell
+float2 hash(float2 cell)
+{
+    uint2 h = (uint2) (int2) cell * uint2(1597334673u, 3812015801u);
+    uint n = (h.x ^ h.y) * 1597334673u;
+    float angle = (float) n * (6.2831853f / 4294967296.0f);
+    return float2(cos(angle), sin(angle));
+}
+// gradient noise in [-1, 1], zero on every integer uv so untiled surfaces keep their plain color
+float gradient_noise(float2 uv)
+{
+    float2 cell = floor(uv);
+    float2 f = uv - cell;
+    float2 w = f * f * (3.0f - 2.0f * f);
+    float a = dot(hash(cell), f);
+    float b = dot(hash(cell + float2(1.0f, 0.0f)), f - float2(1.0f, 0.0f));
+    float c = dot(hash(cell + float2(0.0f, 1.0f)), f - float2(0.0f, 1.0f));
+    float d = dot(hash(cell + float2(1.0f, 1.0f)), f - float2(1.0f, 1.0f));
+    return lerp(lerp(a, b, w.x), lerp(c, d, w.x), w.y) * 1.4142f;
+}
+
+Output main(Input input)
 {
     float3 color = input.color.rgb;
     float2 uv = float2(input.color.w, input.normal.w);
+
+    // procedural texture, the uv tiling of a primitive sets its frequency
+    color *= 1.0f + 0.5f * gradient_noise(uv);
     
     // noise color based on uv
     float2 integers;
@@ -33,5 +66,9 @@ float4 main(Input input) : SV_Target
     //float a, b, c;
     //float attenB = 1.0f / (a * dist * dist + b * dist + c);
     
-    return float4(color, input.color.a);
+    Output output;
+    output.color = float4(color, input.color.a);
+    // view space depth, the offsets only shift the views sideways
+    output.disparity = disparityScale.x / input.worldPos.z;
+    return output;
 }
\ No newline at end of file
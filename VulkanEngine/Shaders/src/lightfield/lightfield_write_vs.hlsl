@@ -1,8 +1,9 @@
 struct Input
 {
-    float4 position : Position;
+    float3 position : Position;
     float4 color : Color;
-    float4 normal : Normal;
+    float2 normal : Normal; // octahedral
+    float2 uv : TexCoord;
 };
 
 struct Output
@@ -13,24 +14,41 @@ struct Output
     float4 normal : Normal;
 };
 
-[[vk::binding(0, 0)]] // binding slot 0, descriptor set 0
-cbuffer ModelBuffer { float4x4 model; };
 [[vk::binding(1, 0)]] // binding slot 1, descriptor set 0
 cbuffer ViewProjectionBuffer { float4x4 view, proj, viewProj; };
 
 [[vk::binding(2, 1)]] // binding slot 2, descriptor set 1
-cbuffer OffsetBuffer { float4 posOffset; };
+cbuffer OffsetBuffer { float4 posOffsets[9]; float4 disparityScale; };
+
+[[vk::binding(0, 2)]] // binding slot 0, descriptor set 2
+StructuredBuffer<float4x4> models; // indexed by instance, which starts at each draw's first instance
+
+// view rendered by this pass, only used when multiview is unavailable
+struct PCS
+{
+    uint iView;
+};
+[[vk::push_constant]] PCS pcs;
 
+// inverse of the octahedral encoding on the cpu side
+float3 decode_oct(float2 oct)
+{
+    float3 n = float3(oct, 1.0f - abs(oct.x) - abs(oct.y));
+    float t = saturate(-n.z);
+    n.xy -= (step(0.0f, n.xy) * 2.0f - 1.0f) * t;
+    return normalize(n);
+}
 
-Output main(Input input)
+Output main(Input input, uint iInstance : SV_InstanceID)
 {
     Output output;
-    output.worldPos = input.position;
+    float4x4 model = models[iInstance];
+    output.worldPos = mul(model, float4(input.position, 1.0f));
     output.worldPos = mul(view, output.worldPos);
-    output.worldPos += posOffset; // individual cam offset
+    output.worldPos += posOffsets[pcs.iView]; // individual cam offset
     
     output.screenPos = mul(proj, output.worldPos);
-    output.color = input.color;
-    output.normal = input.normal;
+    output.color = float4(input.color.rgb, input.uv.x); // uv stays hidden in w for the pixel shaders
+    output.normal = float4(normalize(mul((float3x3) model, decode_oct(input.normal))), input.uv.y); // exact for uniform scales
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,46 @@
+# writes the synthetic validation dataset: a textured square in front of a textured background,
+# rendered into the 3x3 views with exact sub-pixel shifts, and its ground truth disparity
+# usage: python generate.py [output folder]
+import math, struct, sys, zlib
+
+W = H = 64
+SQUARE = (20, 44) # foreground square in the center view
+DISPARITY_BG, DISPARITY_FG = -0.5, 0.8
+CAM_FILES = [
+	"input_Cam039.png", "input_Cam048.png", "input_Cam057.png",
+	"input_Cam040.png", "input_Cam049.png", "input_Cam058.png",
+	"input_Cam041.png", "input_Cam050.png", "input_Cam059.png"]
+
+def texture(x, y, k, bForeground):
+	if bForeground: s = math.sin(0.45 * x + 0.2 * y + k) + 0.6 * math.sin(0.15 * x - 0.55 * y + 2 * k)
+	else: s = math.sin(0.25 * x - 0.35 * y + 1.7 * k) + 0.7 * math.sin(0.6 * x + 0.1 * y + k)
+	return max(0, min(255, int(round(128 + 60 * s))))
+
+# camera u shifts along x and v along y, as in lightfield_gradients_cs
+def render_view(u, v):
+	pixels = bytearray()
+	for y in range(H):
+		for x in range(W):
+			fx, fy = x + DISPARITY_FG * (u - 1), y + DISPARITY_FG * (v - 1)
+			bForeground = SQUARE[0] <= fx < SQUARE[1] and SQUARE[0] <= fy < SQUARE[1]
+			tx, ty = (fx, fy) if bForeground else (x + DISPARITY_BG * (u - 1), y + DISPARITY_BG * (v - 1))
+			pixels += bytes([texture(tx, ty, k, bForeground) for k in range(3)]) + b"\xff"
+	return pixels
+
+def write_png(filename, pixels):
+	def chunk(tag, data): return struct.pack(">I", len(data)) + tag + data + struct.pack(">I", zlib.crc32(tag + data) & 0xffffffff)
+	raw = b"".join(b"\x00" + bytes(pixels[y * W * 4:(y + 1) * W * 4]) for y in range(H))
+	with open(filename, "wb") as file:
+		file.write(b"\x89PNG\r\n\x1a\n" + chunk(b"IHDR", struct.pack(">IIBBBBB", W, H, 8, 6, 0, 0, 0)) + chunk(b"IDAT", zlib.compress(raw, 9)) + chunk(b"IEND", b""))
+
+# greyscale pfm, little endian with rows bottom to top
+def write_pfm(filename, values):
+	rows = b"".join(struct.pack("<%df" % W, *values[y * W:(y + 1) * W]) for y in reversed(range(H)))
+	with open(filename, "wb") as file:
+		file.write(b"Pf\n%d %d\n-1\n" % (W, H) + rows)
+
+folder = sys.argv[1] if len(sys.argv) > 1 else "."
+for i, camFile in enumerate(CAM_FILES):
+	write_png(f"{folder}/{camFile}", render_view(i // 3, i % 3))
+inSquare = lambda x, y: SQUARE[0] <= x < SQUARE[1] and SQUARE[0] <= y < SQUARE[1]
+write_pfm(f"{folder}/gt_disp_lowres.pfm", [DISPARITY_FG if inSquare(x, y) else DISPARITY_BG for y in range(H) for x in range(W)])
@@ -0,0 +1,81 @@
+#pragma once
+
+// fixed set of worker threads that split batches of jobs among themselves
+class ThreadPool
+{
+public:
+	ThreadPool() = default;
+	~ThreadPool() = default;
+	ROF_COPY_MOVE_DELETE(ThreadPool)
+
+public:
+	void init(uint32_t nThreads = 0)
+	{
+		// leave one core to the main thread, which waits on the batch anyways
+		if (nThreads == 0) nThreads = std::max(2u, std::thread::hardware_concurrency()) - 1u;
+
+		bRunning = true;
+		for (uint32_t i = 0; i < nThreads; i++) {
+			workers.emplace_back([this, i]() { work(i); });
+		}
+		VMI_LOG("Thread pool running " << nThreads << " workers");
+	}
+	void destroy()
+	{
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			bRunning = false;
+		}
+		jobAvailable.notify_all();
+		for (auto& worker : workers) worker.join();
+		workers.clear();
+	}
+
+	// runs job(iJob, iThread) for every iJob in [0, nJobs) and blocks until all of them are done,
+	// iThread identifies the worker so jobs can use per-thread resources without locking
+	void dispatch(uint32_t nJobs, std::function<void(uint32_t, uint32_t)> job)
+	{
+		if (nJobs == 0) return;
+
+		std::unique_lock<std::mutex> lock(mutex);
+		currentJob = std::move(job);
+		nJobsTotal = nJobs;
+		iNextJob = 0;
+		nJobsDone = 0;
+		jobAvailable.notify_all();
+		batchDone.wait(lock, [this]() { return nJobsDone == nJobsTotal; });
+		currentJob = nullptr;
+	}
+	uint32_t get_thread_count()
+	{
+		return (uint32_t)workers.size();
+	}
+
+private:
+	void work(uint32_t iThread)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			jobAvailable.wait(lock, [this]() { return !bRunning || iNextJob < nJobsTotal; });
+			if (!bRunning) return;
+
+			// grab the next job of the batch and run it without holding the lock
+			uint32_t iJob = iNextJob++;
+			lock.unlock();
+			currentJob(iJob, iThread);
+			lock.lock();
+
+			if (++nJobsDone == nJobsTotal) batchDone.notify_one();
+		}
+	}
+
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable jobAvailable, batchDone;
+	bool bRunning = false;
+
+	// current batch
+	std::function<void(uint32_t, uint32_t)> currentJob;
+	uint32_t nJobsTotal = 0, iNextJob = 0, nJobsDone = 0;
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+// wall clock spans of named steps, which may run on any thread, logged as one table once they are done
+class Timeline
+{
+public:
+	Timeline() : start(std::chrono::high_resolution_clock::now()) {}
+	~Timeline() = default;
+	ROF_COPY_MOVE_DELETE(Timeline)
+
+public:
+	template<typename Func> void record(const char* name, Func&& func)
+	{
+		auto begin = std::chrono::high_resolution_clock::now();
+		func();
+		auto end = std::chrono::high_resolution_clock::now();
+
+		std::unique_lock<std::mutex> lock(mutex);
+		entries.push_back({ name, begin, end, std::this_thread::get_id() });
+	}
+	void log(const char* title)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		std::sort(entries.begin(), entries.end(), [](auto& a, auto& b) { return a.begin < b.begin; });
+
+		// threads are numbered in order of their first step, the calling thread usually being 0
+		std::vector<std::thread::id> threads;
+		VMI_LOG(title << " timeline (ms):");
+		for (auto& entry : entries) {
+			auto it = std::find(threads.begin(), threads.end(), entry.thread);
+			if (it == threads.end()) it = threads.insert(threads.end(), entry.thread);
+			VMI_LOG("  " << to_ms(entry.begin) << " - " << to_ms(entry.end) << "  [" << std::distance(threads.begin(), it) << "] " << entry.name);
+		}
+		VMI_LOG("  " << to_ms(std::chrono::high_resolution_clock::now()) << " total");
+	}
+
+private:
+	// since construction, padded so the columns line up
+	std::string to_ms(std::chrono::high_resolution_clock::time_point time)
+	{
+		char buffer[32];
+		snprintf(buffer, sizeof(buffer), "%8.1f", std::chrono::duration<float, std::milli>(time - start).count());
+		return buffer;
+	}
+
+private:
+	struct Entry
+	{
+		const char* name;
+		std::chrono::high_resolution_clock::time_point begin, end;
+		std::thread::id thread;
+	};
+	std::chrono::high_resolution_clock::time_point start;
+	std::vector<Entry> entries;
+	std::mutex mutex;
+};
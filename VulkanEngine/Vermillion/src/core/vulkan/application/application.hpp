@@ -1,6 +1,7 @@
 #pragma once
 
 #include "input.hpp"
+#include "launch_options.hpp"
 #include "scene_objects/scene.hpp"
 #include "window.hpp"
 #include "devices/device_manager.hpp"
@@ -10,17 +11,21 @@
 class Application
 {
 public:
-	Application()
+	Application(const LaunchOptions& options)
 	{
 		VMI_LOG("[Initializing] Independent vulkan functions...");
 		vk::DynamicLoader dl;
 		PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
 		VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
 
-		window.init(fullscreenMode ? fullscreenResolution : windowedResolution, fullscreenMode);
-		deviceManager.init(window.get_vulkan_instance(), window.get_vulkan_surface());
-		renderer.init(deviceManager.get_device_wrapper(), window, std::string("lightfields/").append(mainFolder).append(subFolder).c_str());
-		scene.init();
+		Timeline timeline;
+		timeline.record("Window", [&]() { window.init(fullscreenMode ? fullscreenResolution : windowedResolution, fullscreenMode); });
+		timeline.record("Device", [&]() { deviceManager.init(window.get_vulkan_instance(), window.get_vulkan_surface()); });
+		if (options.bRenderPasses) deviceManager.get_device_wrapper().bDynamicRendering = false;
+		if (options.bSyncCompute) deviceManager.get_device_wrapper().bAsyncCompute = false;
+		renderer.init(deviceManager.get_device_wrapper(), window, std::string("lightfields/").append(mainFolder).append(subFolder).c_str(), options.presentMode, timeline);
+		timeline.record("Scene", [&]() { scene.init(options.sceneConfigPath.empty() ? SceneConfig() : SceneConfig::load(options.sceneConfigPath)); });
+		timeline.log("Startup");
 		VMI_LOG("[Initialization Complete]" << std::endl);
 	}
 	~Application()
@@ -49,9 +54,15 @@ private:
 		if (!poll_inputs()) return false;
 		handle_inputs();
 		scene.update();
-		renderer.handle_allocations(deviceManager.get_device_wrapper(), scene.reg);
+		renderer.handle_allocations(deviceManager.get_device_wrapper(), scene.reg, scene.transforms);
 		imgui_end();
 
+		// e.g. present mode changes
+		if (renderer.bRebuildKHR) {
+			renderer.bRebuildKHR = false;
+			resize(true);
+		}
+
 		if (!bPaused) render();
 		else stall();
 
@@ -59,7 +70,7 @@ private:
 	}
 	void render()
 	{
-		renderer.render(deviceManager.get_device_wrapper(), scene.reg, pushConstant);
+		renderer.render(deviceManager.get_device_wrapper(), scene.reg, scene.transforms, pushConstant);
 	}
 	void stall()
 	{
@@ -84,13 +95,16 @@ private:
 			case 2: ImGui::Text("Gradients Vertical - RG"); break;
 			case 3: ImGui::Text("Disparity - Heatmap RGB"); break;
 			case 4: ImGui::Text("Depth - Heatmap RGB"); break;
-			case 5: {
-				ImGui::Text("0-filler spots - RGB");
-				ImGui::Text("Color refers to filter size used to fill:");
+			case 5: ImGui::Text("Certainty - Heatmap RGB"); break;
+			case 6: ImGui::Text("Ground Truth - Heatmap RGB"); break;
+			case 7: ImGui::Text("Squared Error to Ground Truth - Grey"); break;
+			case 8: {
+				ImGui::Text("Filter size - RGB");
+				ImGui::Text("Color refers to filter size used:");
+				ImGui::Text("White = 3");
 				ImGui::Text("Red = 5");
 				ImGui::Text("Green = 7");
 				ImGui::Text("Blue = 9");
-				ImGui::Text("White = N/A");
 				break;
 			}
 			}
@@ -103,6 +117,9 @@ private:
 			ImGui::Text("F1 - F8: render modes");
 			ImGui::Text("SHIFT + F1 - F5: tap filter modes");
 			ImGui::Text("LCTRL + F1 - F3: post processing modes");
+			ImGui::Text("LCTRL + T: full resolution tiled estimate");
+			ImGui::Text("LCTRL + R: compare to CPU estimate");
+			ImGui::Text("LALT + F1: filter size view");
 			ImGui::Text("RCTRL: toggle sim/benchmark");
 			ImGui::Text("F10: device memory dump");
 			ImGui::Text("F11: fullscreen");
@@ -203,10 +220,19 @@ private:
 			if (input.keysPressed.count(SDLK_s)) {
 				renderer.bSaveLightfield = true;
 			}
+			if (input.keysPressed.count(SDLK_t)) {
+				renderer.bEstimateTiled = true;
+			}
+			if (input.keysPressed.count(SDLK_r)) {
+				renderer.bCompareCpu = true;
+			}
 			if (input.keysPressed.count(SDLK_F1)) pushConstant.iPostProcessingMode = 0;
 			else if (input.keysPressed.count(SDLK_F2)) pushConstant.iPostProcessingMode = 1;
 			else if (input.keysPressed.count(SDLK_F3)) pushConstant.iPostProcessingMode = 2;
 		}
+		else if (input.keysDown.count(SDLK_LALT)) {
+			if (input.keysPressed.count(SDLK_F1)) pushConstant.iRenderMode = 8;
+		}
 		else {
 			if (input.keysPressed.count(SDLK_F1)) pushConstant.iRenderMode = 0;
 			else if (input.keysPressed.count(SDLK_F2)) pushConstant.iRenderMode = 1;
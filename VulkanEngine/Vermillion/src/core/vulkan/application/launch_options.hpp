@@ -0,0 +1,67 @@
+#pragma once
+
+// settings that can be passed on the command line, everything else keeps its defaults
+struct LaunchOptions
+{
+	vk::PresentModeKHR presentMode = vk::PresentModeKHR::eFifo;
+	std::string sceneConfigPath; // generated scene for load testing, see SceneConfig
+	bool bRenderPasses = false; // keeps render passes and framebuffers even when dynamic rendering is supported
+	bool bSyncCompute = false; // estimates depth on the graphics queue even when a compute only queue exists
+	std::string cpuEstimatePath; // dataset folder to estimate on the CPU instead of starting the renderer, see CpuEstimator
+	std::string validatePath; // dataset folder to check the gradients pass against its golden files, see Validator
+	bool bUpdateGolden = false; // records the golden files of the validated dataset anew
+	bool bSelfTest = false; // runs the checks of SelfTest instead of starting the renderer
+
+	static LaunchOptions parse(int argc, char** argv)
+	{
+		LaunchOptions options;
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			bool bHasValue = i + 1 < argc;
+
+			if (arg == "--present-mode" && bHasValue) {
+				std::string value = argv[++i];
+				if (!parse_present_mode(value, options.presentMode)) {
+					VMI_WARN("Unknown present mode '" << value << "', expected fifo, fifo-relaxed, mailbox or immediate");
+				}
+			}
+			else if (arg == "--scene" && bHasValue) {
+				options.sceneConfigPath = argv[++i];
+			}
+			else if (arg == "--render-passes") {
+				options.bRenderPasses = true;
+			}
+			else if (arg == "--sync-compute") {
+				options.bSyncCompute = true;
+			}
+			else if (arg == "--cpu-estimate" && bHasValue) {
+				options.cpuEstimatePath = argv[++i];
+				// dataset folders are joined with file names directly
+				if (!options.cpuEstimatePath.empty() && options.cpuEstimatePath.back() != '/') options.cpuEstimatePath.append("/");
+			}
+			else if (arg == "--validate" && bHasValue) {
+				options.validatePath = argv[++i];
+				if (!options.validatePath.empty() && options.validatePath.back() != '/') options.validatePath.append("/");
+			}
+			else if (arg == "--update-golden") {
+				options.bUpdateGolden = true;
+			}
+			else if (arg == "--self-test") {
+				options.bSelfTest = true;
+			}
+			else {
+				VMI_WARN("Ignoring unknown argument: " << arg);
+			}
+		}
+		return options;
+	}
+	static bool parse_present_mode(const std::string& name, vk::PresentModeKHR& presentMode)
+	{
+		if (name == "fifo") presentMode = vk::PresentModeKHR::eFifo;
+		else if (name == "fifo-relaxed") presentMode = vk::PresentModeKHR::eFifoRelaxed;
+		else if (name == "mailbox") presentMode = vk::PresentModeKHR::eMailbox;
+		else if (name == "immediate") presentMode = vk::PresentModeKHR::eImmediate;
+		else return false;
+		return true;
+	}
+};
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "buffers/ring_buffer.hpp"
+
+// checks of the engine's plain containers, they need neither a window nor a device and run in release builds as well
+class SelfTest
+{
+public:
+	// returns whether every check passed, failures are logged one by one
+	static bool run()
+	{
+		VMI_LOG("[Self test]");
+		bool bPassed = true;
+		for (uint32_t nFrames : { 0u, 1u, 3u }) {
+			RingBuffer<Probe> ring;
+			ring.set_size(nFrames).init(7u);
+			bPassed &= check_ring(ring, nFrames);
+		}
+
+		// resizing reallocates the frames, the links have to follow
+		RingBuffer<Probe> ring;
+		ring.set_size(3);
+		ring.get_next();
+		ring.set_size(5).init(7u);
+		bPassed &= check_ring(ring, 5);
+
+		VMI_LOG(std::endl << (bPassed ? "[Self test passed]" : "[Self test failed]"));
+		return bPassed;
+	}
+
+private:
+	// counts the calls the ring forwards to its frames
+	struct Probe
+	{
+		void init(uint32_t value)
+		{
+			this->value = value;
+			nInits++;
+		}
+		void destroy()
+		{
+			nDestroys++;
+		}
+
+		uint32_t value = 0;
+		uint32_t nInits = 0, nDestroys = 0;
+	};
+
+	static bool check(bool bCondition, uint32_t nFrames, const char* what)
+	{
+		if (!bCondition) VMI_ERR("RingBuffer of " << nFrames << " frames: " << what);
+		return bCondition;
+	}
+	// a freshly initialized ring of nFrames frames, destroyed at the end
+	static bool check_ring(RingBuffer<Probe>& ring, uint32_t nFrames)
+	{
+		bool bPassed = check(ring.get_size() == nFrames, nFrames, "wrong size");
+
+		// every frame initialized once, get_all() in index order
+		std::vector<Probe*> all = ring.get_all();
+		bPassed &= check(all.size() == nFrames, nFrames, "get_all() returned the wrong number of frames");
+		for (uint32_t i = 0; i < all.size(); i++) {
+			bPassed &= check(all[i] == &ring[i], nFrames, "get_all() out of index order");
+			bPassed &= check(all[i]->nInits == 1 && all[i]->value == 7, nFrames, "frame not initialized exactly once");
+		}
+
+		// two full turns, get_next() starts after the first frame and wraps around to it
+		if (nFrames > 0) {
+			bPassed &= check(ring.get_current_index() == 0, nFrames, "does not start at the first frame");
+			for (uint32_t i = 1; i <= 2 * nFrames; i++) {
+				Probe& probe = ring.get_next();
+				bPassed &= check(&probe == &ring[i % nFrames], nFrames, "get_next() out of order");
+				bPassed &= check(ring.get_current_index() == i % nFrames && &ring.get_current() == &probe, nFrames, "current frame not the one get_next() returned");
+			}
+		}
+
+		ring.destroy();
+		for (Probe* pProbe : all) bPassed &= check(pProbe->nDestroys == 1, nFrames, "frame not destroyed exactly once");
+		return bPassed;
+	}
+};
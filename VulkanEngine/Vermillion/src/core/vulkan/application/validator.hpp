@@ -0,0 +1,283 @@
+#pragma once
+
+#include "devices/device_manager.hpp"
+#include "renderer.hpp"
+
+// headless regression check of the gradients pass, preferably on a software driver like Mesa's lavapipe so it runs without a GPU:
+// estimates a dataset, compares the disparity with golden files next to it and with the CPU estimator, and times the pass.
+// Vermillion-Windows/validation holds a small synthetic dataset for this, timings have to be recorded on the machine running it
+class Validator
+{
+public:
+	Validator() = default;
+	~Validator() = default;
+	ROF_COPY_MOVE_DELETE(Validator)
+
+public:
+	// records the golden files instead when bUpdateGolden is set, returns whether every check passed
+	bool run(const std::string& folder, bool bUpdateGolden)
+	{
+		VMI_LOG("[Validating] " << folder);
+		init();
+		DeviceWrapper& deviceWrapper = deviceManager.get_device_wrapper();
+		std::string deviceName = deviceWrapper.deviceProperties.deviceName.data();
+		VMI_LOG("Device: " << deviceName);
+
+		LightfieldData data;
+		threadPool.dispatch(Lightfield::nFiles, [&](uint32_t iFile, uint32_t iThread) { Lightfield::decode_file(folder, iFile, data); });
+		vk::Extent2D extent = data.viewExtents[Lightfield::iCenterCamera];
+		if (!data.views[Lightfield::iCenterCamera]) {
+			VMI_ERR("Validation needs the center view");
+			Lightfield::free_views(data);
+			destroy();
+			return false;
+		}
+
+		// the upload frees the views, so the reference is estimated first
+		CpuEstimate cpuEstimate = CpuEstimator::estimate(data, pushConstant.iFilterMode, threadPool);
+		LightfieldCreateInfo lightfieldInfo = { deviceWrapper, extent, allocator, descAllocator, layoutCache, folder, 1, false };
+		lightfield.init(lightfieldInfo);
+		GradientsPassCreateInfo gradientsInfo = { deviceWrapper, layoutCache, lightfield };
+		gradientsPass.init(gradientsInfo);
+		lightfield.upload(deviceWrapper, stagingRing, commandPool, data);
+
+		float passTime = execute(deviceWrapper);
+		std::vector<float4> gpuDisparity;
+		lightfield.read_disparity(deviceWrapper, stagingRing, commandPool, 0, gpuDisparity);
+
+		bool bPassed = check_cpu(cpuEstimate, gpuDisparity, extent);
+		bPassed &= check_golden(std::string(folder).append("golden_disparity.pfm"), gpuDisparity, extent, bUpdateGolden);
+		if (passTime > 0.0f) bPassed &= check_timing(std::string(folder).append("golden_timing.txt"), deviceName, passTime, bUpdateGolden);
+
+		destroy();
+		VMI_LOG(std::endl << (bPassed ? "[Validation passed]" : "[Validation failed]"));
+		return bPassed;
+	}
+
+private:
+	void init()
+	{
+		VMI_LOG("[Initializing] Independent vulkan functions...");
+		PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
+		VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
+
+		// no window, so neither surface nor WSI extensions
+		vk::ApplicationInfo appInfo = vk::ApplicationInfo()
+			.setPApplicationName("Validation")
+			.setApplicationVersion(VK_MAKE_API_VERSION(0, 0, 1, 0))
+			.setPEngineName("Vermillion")
+			.setEngineVersion(VK_MAKE_API_VERSION(0, 0, 1, 0))
+			.setApiVersion(VK_API_VERSION_1_1);
+		instance = vk::createInstance(vk::InstanceCreateInfo().setPApplicationInfo(&appInfo));
+		VULKAN_HPP_DEFAULT_DISPATCHER.init(instance);
+
+		vk::SurfaceKHR surface;
+		deviceManager.init(instance, surface, true);
+		DeviceWrapper& deviceWrapper = deviceManager.get_device_wrapper();
+		deviceWrapper.bAsyncCompute = false; // the pass is timed on its own, nothing to overlap with
+
+		vma::AllocatorCreateFlags flags = vma::AllocatorCreateFlagBits::eKhrDedicatedAllocation;
+		if (deviceWrapper.bMemoryBudget) flags |= vma::AllocatorCreateFlagBits::eExtMemoryBudget;
+		vma::AllocatorCreateInfo allocatorInfo = vma::AllocatorCreateInfo()
+			.setPhysicalDevice(deviceWrapper.physicalDevice)
+			.setDevice(deviceWrapper.logicalDevice)
+			.setInstance(instance)
+			.setVulkanApiVersion(VK_API_VERSION_1_1)
+			.setFlags(flags);
+		allocator = vma::createAllocator(allocatorInfo);
+
+		stagingRing.init(allocator);
+		descAllocator.init(deviceWrapper);
+		vk::CommandPoolCreateInfo commandPoolInfo = vk::CommandPoolCreateInfo()
+			.setQueueFamilyIndex(deviceWrapper.iQueue)
+			.setFlags(vk::CommandPoolCreateFlagBits::eTransient);
+		commandPool = deviceWrapper.logicalDevice.createCommandPool(commandPoolInfo);
+		threadPool.init();
+	}
+	void destroy()
+	{
+		DeviceWrapper& deviceWrapper = deviceManager.get_device_wrapper();
+		deviceWrapper.wait_for_submissions();
+
+		gradientsPass.destroy(deviceWrapper);
+		lightfield.destroy(deviceWrapper, allocator);
+		deviceWrapper.logicalDevice.destroyCommandPool(commandPool);
+		descAllocator.destroy(deviceWrapper);
+		layoutCache.destroy(deviceWrapper);
+		stagingRing.destroy(deviceWrapper);
+		allocator.destroy();
+		threadPool.destroy();
+
+		deviceManager.destroy();
+		instance.destroy();
+	}
+
+	// runs the pass a few times back to back and returns its median time in ms, or 0 without timestamps
+	float execute(DeviceWrapper& deviceWrapper)
+	{
+		uint32_t validBits = deviceWrapper.physicalDevice.getQueueFamilyProperties()[deviceWrapper.iQueue].timestampValidBits;
+		if (validBits == 0) VMI_WARN("GPU timestamps unsupported, the gradients pass is not timed");
+		vk::QueryPool queryPool;
+		if (validBits > 0) queryPool = deviceWrapper.logicalDevice.createQueryPool(vk::QueryPoolCreateInfo()
+			.setQueryType(vk::QueryType::eTimestamp)
+			.setQueryCount(2 * nRuns));
+
+		vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+			.setLevel(vk::CommandBufferLevel::ePrimary)
+			.setCommandPool(commandPool)
+			.setCommandBufferCount(1);
+		vk::CommandBuffer commandBuffer;
+		auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&allocInfo, &commandBuffer);
+		commandBuffer.begin(vk::CommandBufferBeginInfo().setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+		if (queryPool) commandBuffer.resetQueryPool(queryPool, 0, 2 * nRuns);
+
+		LightfieldFrame& frame = lightfield.frames[0];
+		vk::ImageSubresourceRange range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+		std::array<vk::ImageMemoryBarrier, 2> barriers;
+		barriers[0] = vk::ImageMemoryBarrier()
+			.setDstAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setOldLayout(vk::ImageLayout::eUndefined)
+			.setNewLayout(vk::ImageLayout::eGeneral)
+			.setImage(frame.gradientsImage)
+			.setSubresourceRange(range);
+		barriers[1] = barriers[0];
+		barriers[1].setImage(frame.disparityImage);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, barriers);
+
+		// every run overwrites the outputs of the previous one
+		vk::MemoryBarrier outputBarrier = vk::MemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eShaderWrite);
+		for (uint32_t iRun = 0; iRun < nRuns; iRun++) {
+			if (iRun > 0) commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eComputeShader, {}, outputBarrier, {}, {});
+			if (queryPool) commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, 2 * iRun);
+			gradientsPass.execute(commandBuffer, pushConstant, 0);
+			if (queryPool) commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, 2 * iRun + 1);
+		}
+
+		// readbacks expect the layout the frame graph leaves the outputs in
+		for (auto& barrier : barriers) {
+			barrier.oldLayout = vk::ImageLayout::eGeneral;
+			barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+			barrier.srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		}
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barriers);
+		commandBuffer.end();
+
+		uint64_t timelineValue = deviceWrapper.submit(vk::SubmitInfo().setCommandBufferCount(1).setPCommandBuffers(&commandBuffer));
+		deviceWrapper.wait_for(timelineValue);
+		deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, commandBuffer);
+		if (!queryPool) return 0.0f;
+
+		std::array<uint64_t, 2 * nRuns> stamps;
+		vk::Result result = deviceWrapper.logicalDevice.getQueryPoolResults(queryPool, 0, 2 * nRuns, sizeof(stamps), stamps.data(), sizeof(uint64_t),
+			vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+		deviceWrapper.logicalDevice.destroyQueryPool(queryPool);
+		if (result != vk::Result::eSuccess) return 0.0f;
+
+		uint64_t timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1ull;
+		std::array<float, nRuns> times;
+		for (uint32_t iRun = 0; iRun < nRuns; iRun++) {
+			uint64_t ticks = (stamps[2 * iRun + 1] - stamps[2 * iRun]) & timestampMask;
+			times[iRun] = (float)((double)ticks * (double)deviceWrapper.deviceProperties.limits.timestampPeriod / 1000000.0);
+		}
+		std::sort(times.begin(), times.end());
+		VMI_LOG("Gradients pass: " << times[nRuns / 2] << " ms (median of " << nRuns << " runs)");
+		return times[nRuns / 2];
+	}
+
+	// the CPU estimator follows the shader closely, but sums in another order and decodes srgb itself
+	bool check_cpu(const CpuEstimate& cpuEstimate, const std::vector<float4>& gpuDisparity, vk::Extent2D extent)
+	{
+		CpuDifference difference = CpuEstimator::compare(cpuEstimate, gpuDisparity, extent);
+		// a dataset without certain pixels would pass without comparing any disparity
+		bool bPassed = difference.nCertain > 0 && difference.meanAbs <= cpuMeanTolerance && difference.sameFilterShare >= cpuFilterShare;
+		VMI_LOG("CPU reference: mean abs difference " << difference.meanAbs << ", max " << difference.maxAbs
+			<< ", same filter for " << 100.0f * difference.sameFilterShare << "% of pixels" << (bPassed ? "" : " -> FAILED"));
+		return bPassed;
+	}
+	// the golden disparity comes from a device or from a direct port of the shader, so only rounding may differ.
+	// pixels near the edges read past them, which is undefined for the shader and not compared
+	bool check_golden(const std::string& filename, const std::vector<float4>& gpuDisparity, vk::Extent2D extent, bool bUpdate)
+	{
+		if (bUpdate) {
+			std::vector<float> disparityOnly(gpuDisparity.size());
+			for (size_t i = 0; i < disparityOnly.size(); i++) disparityOnly[i] = gpuDisparity[i].x;
+			Lightfield::write_pfm(filename.c_str(), disparityOnly.data(), extent.width, extent.height);
+			VMI_LOG("Golden disparity recorded to " << filename);
+			return true;
+		}
+		std::vector<float> golden;
+		vk::Extent2D goldenExtent;
+		if (!Lightfield::read_pfm(filename.c_str(), golden, goldenExtent)) {
+			VMI_ERR("Golden disparity missing: " << filename << ", record it with --update-golden");
+			return false;
+		}
+		if (goldenExtent != extent) {
+			VMI_ERR("Golden disparity is " << goldenExtent.width << "x" << goldenExtent.height << ", estimate is " << extent.width << "x" << extent.height);
+			return false;
+		}
+
+		float maxDiff = 0.0f;
+		size_t nFailed = 0;
+		for (uint32_t y = CpuEstimator::halo; y + CpuEstimator::halo < extent.height; y++) {
+			for (uint32_t x = CpuEstimator::halo; x + CpuEstimator::halo < extent.width; x++) {
+				size_t i = (size_t)y * extent.width + x;
+				if (gpuDisparity[i].y < CpuEstimator::minCertainty) continue;
+				float diff = std::abs(golden[i] - gpuDisparity[i].x);
+				maxDiff = std::max(maxDiff, diff);
+				if (!(diff <= goldenTolerance)) nFailed++;
+			}
+		}
+		VMI_LOG("Golden disparity: max abs difference " << maxDiff << ", " << nFailed << " pixels off" << (nFailed == 0 ? "" : " -> FAILED"));
+		return nFailed == 0;
+	}
+	// timings only compare on the device they were recorded on, any other device has to record its own
+	bool check_timing(const std::string& filename, const std::string& deviceName, float passTime, bool bUpdate)
+	{
+		if (bUpdate) {
+			std::ofstream out(filename);
+			out << deviceName << "\n" << passTime << "\n";
+			VMI_LOG("Golden timing recorded to " << filename);
+			return true;
+		}
+		std::ifstream file(filename);
+		std::string goldenDevice;
+		float goldenTime = 0.0f;
+		// timings only mean something on the device that recorded them, so without one for this device the check is advisory
+		if (!std::getline(file, goldenDevice) || !(file >> goldenTime) || goldenTime <= 0.0f) {
+			VMI_WARN("Golden timing missing: " << filename << ", pass took " << passTime << " ms, record it with --update-golden");
+			return true;
+		}
+		if (goldenDevice != deviceName) {
+			VMI_WARN("Golden timing is from " << goldenDevice << ", not " << deviceName << ", pass took " << passTime << " ms, record it with --update-golden");
+			return true;
+		}
+
+		bool bPassed = passTime <= goldenTime * timingTolerance;
+		VMI_LOG("Golden timing: " << goldenTime << " ms, now " << passTime << " ms" << (bPassed ? "" : " -> FAILED"));
+		return bPassed;
+	}
+
+private:
+	static constexpr uint32_t nRuns = 5;
+	static constexpr float cpuMeanTolerance = 1e-3f; // mean abs disparity difference to the CPU estimate
+	static constexpr float cpuFilterShare = 0.99f; // share of pixels for which both choose the same filter
+	static constexpr float goldenTolerance = 1e-4f; // abs disparity difference per pixel
+	static constexpr float timingTolerance = 1.5f; // factor the pass may be slower by, timings are noisy on shared machines
+
+	vk::DynamicLoader dl;
+	vk::Instance instance;
+	DeviceManager deviceManager;
+	vma::Allocator allocator;
+	StagingRing stagingRing;
+	DescriptorAllocator descAllocator;
+	LayoutCache layoutCache;
+	ThreadPool threadPool;
+	vk::CommandPool commandPool;
+
+	Lightfield lightfield;
+	GradientsPass gradientsPass;
+	PC pushConstant; // defaults, all filters combined
+};
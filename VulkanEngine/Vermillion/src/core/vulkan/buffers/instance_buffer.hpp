@@ -0,0 +1,132 @@
+#pragma once
+
+#include "devices/device_wrapper.hpp"
+#include "wrappers/descriptor_allocator.hpp"
+#include "wrappers/layout_cache.hpp"
+#include "scene_objects/ecs/transform.hpp"
+
+// model matrix of every transform slot, one persistently mapped region per frame in flight,
+// read through a dynamic storage buffer offset by the vertex shader (indexed by instance) and by culling
+class InstanceBuffer
+{
+public:
+	InstanceBuffer() = default;
+	~InstanceBuffer() = default;
+	ROF_COPY_MOVE_DELETE(InstanceBuffer)
+
+public:
+	void init(DeviceWrapper& deviceWrapper, vma::Allocator& allocator, DescriptorAllocator& descAllocator, LayoutCache& layoutCache, uint32_t nFrames)
+	{
+		frameVersions.assign(nFrames, UINT64_MAX);
+		create_buffer(deviceWrapper, allocator);
+
+		// a single set covers every frame, the region is picked through the dynamic offset
+		descSet = descAllocator.allocate(deviceWrapper, get_desc_set_layout(deviceWrapper, layoutCache));
+		write_desc_set(deviceWrapper);
+	}
+	void destroy(vma::Allocator& allocator)
+	{
+		allocator.destroyBuffer(buffer, alloc);
+		pMapped = nullptr;
+	}
+
+	// only once the frame's previous use was waited on, rebuilds its matrices if the store changed since
+	void update(DeviceWrapper& deviceWrapper, vma::Allocator& allocator, const TransformStore& store, ThreadPool& threadPool, uint32_t iFrame)
+	{
+		if (store.get_count() > maxInstances) grow(deviceWrapper, allocator, store.get_count());
+
+		dynamicOffset = (uint32_t)(regionSize * iFrame);
+		if (frameVersions[iFrame] == store.get_version()) return;
+		frameVersions[iFrame] = store.get_version();
+
+		nInstances = store.get_count();
+		systems::Transform::build_matrices(store, reinterpret_cast<float4x4*>(pMapped + dynamicOffset), nInstances, threadPool);
+		allocator.flushAllocation(alloc, dynamicOffset, sizeof(float4x4) * nInstances);
+	}
+
+	vk::DescriptorSet& get_desc_set()
+	{
+		return descSet;
+	}
+	// region of the last update
+	uint32_t get_dynamic_offset()
+	{
+		return dynamicOffset;
+	}
+	uint32_t get_instance_count()
+	{
+		return nInstances;
+	}
+	static vk::DescriptorSetLayout get_desc_set_layout(DeviceWrapper& deviceWrapper, LayoutCache& layoutCache)
+	{
+		vk::DescriptorSetLayoutBinding layoutBinding = vk::DescriptorSetLayoutBinding()
+			.setBinding(0)
+			.setStageFlags(vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eCompute)
+			.setDescriptorType(vk::DescriptorType::eStorageBufferDynamic)
+			.setDescriptorCount(1)
+			.setPImmutableSamplers(nullptr);
+		return layoutCache.get_desc_set_layout(deviceWrapper, { layoutBinding });
+	}
+
+private:
+	// rarely happens, so the buffer is simply rebuilt once no frame uses it anymore
+	void grow(DeviceWrapper& deviceWrapper, vma::Allocator& allocator, uint32_t nRequired)
+	{
+		uint32_t newMaxInstances = maxInstances;
+		while (newMaxInstances < nRequired) newMaxInstances *= 2;
+		VMI_WARN("Instance buffer too small for " << nRequired << " instances, growing to " << newMaxInstances << " instances");
+
+		deviceWrapper.wait_for_submissions();
+		allocator.destroyBuffer(buffer, alloc);
+		maxInstances = newMaxInstances;
+		create_buffer(deviceWrapper, allocator);
+		write_desc_set(deviceWrapper);
+
+		// the matrices of every frame were lost along with the buffer
+		for (auto& version : frameVersions) version = UINT64_MAX;
+	}
+	void create_buffer(DeviceWrapper& deviceWrapper, vma::Allocator& allocator)
+	{
+		vk::DeviceSize alignment = deviceWrapper.deviceProperties.limits.minStorageBufferOffsetAlignment;
+		regionSize = (sizeof(float4x4) * maxInstances + alignment - 1) & ~(alignment - 1);
+
+		vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
+			.setSize(regionSize * frameVersions.size())
+			.setUsage(vk::BufferUsageFlagBits::eStorageBuffer);
+		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eAuto)
+			.setFlags(vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
+		vma::AllocationInfo allocInfo;
+		vk::Result result = allocator.createBuffer(&bufferInfo, &allocCreateInfo, &buffer, &alloc, &allocInfo);
+		if (result != vk::Result::eSuccess) VMI_ERR("Instance buffer creation unsuccessful");
+		allocator.setAllocationName(alloc, std::string("Instance Matrices").c_str());
+		pMapped = reinterpret_cast<uint8_t*>(allocInfo.pMappedData);
+	}
+	void write_desc_set(DeviceWrapper& deviceWrapper)
+	{
+		vk::DescriptorBufferInfo descBufferInfo = vk::DescriptorBufferInfo()
+			.setBuffer(buffer)
+			.setOffset(0)
+			.setRange(regionSize);
+		vk::WriteDescriptorSet descBufferWrite = vk::WriteDescriptorSet()
+			.setDstSet(descSet)
+			.setDstBinding(0)
+			.setDstArrayElement(0)
+			.setDescriptorType(vk::DescriptorType::eStorageBufferDynamic)
+			.setDescriptorCount(1)
+			.setPBufferInfo(&descBufferInfo);
+		deviceWrapper.logicalDevice.updateDescriptorSets(descBufferWrite, {});
+	}
+
+	uint32_t maxInstances = 64 * 1024; // grows in powers of two, staying a multiple of the store's batch size
+
+	vk::Buffer buffer;
+	vma::Allocation alloc;
+	uint8_t* pMapped = nullptr;
+	vk::DescriptorSet descSet;
+
+	vk::DeviceSize regionSize = 0;
+	std::vector<uint64_t> frameVersions; // store version each frame's matrices were built from
+	uint32_t dynamicOffset = 0;
+	uint32_t nInstances = 0;
+};
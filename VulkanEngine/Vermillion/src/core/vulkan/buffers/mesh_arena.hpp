@@ -0,0 +1,141 @@
+#pragma once
+
+#include "utils/types.hpp"
+#include "devices/device_wrapper.hpp"
+
+// location of one mesh within the arena, in vertices and indices rather than bytes
+struct MeshAllocation
+{
+	vma::VirtualAllocation vertexAlloc, indexAlloc;
+	int32_t vertexOffset = 0;
+	uint32_t firstIndex = 0;
+	uint32_t nIndices = 0;
+};
+
+// one device local buffer holding the vertices and indices of every mesh,
+// a vertex region followed by an index region, each sub-allocated through its own VMA virtual block
+class MeshArena
+{
+public:
+	MeshArena() = default;
+	~MeshArena() = default;
+	ROF_COPY_MOVE_DELETE(MeshArena)
+
+public:
+	void init(vma::Allocator& allocator, vk::DeviceSize vertexStride, vk::DeviceSize vertexCapacity = 1024 * 1024, vk::DeviceSize indexCapacity = 4 * 1024 * 1024)
+	{
+		this->allocator = allocator;
+		this->vertexStride = vertexStride;
+		this->vertexCapacity = vertexCapacity;
+		this->indexCapacity = indexCapacity;
+		indexRegionBegin = vertexStride * vertexCapacity;
+
+		vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
+			.setSize(indexRegionBegin + sizeof(Index) * indexCapacity)
+			.setUsage(vk::BufferUsageFlagBits::eTransferDst | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer);
+		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eAutoPreferDevice);
+		vk::Result result = allocator.createBuffer(&bufferInfo, &allocCreateInfo, &buffer, &alloc, nullptr);
+		if (result != vk::Result::eSuccess) VMI_ERR("Mesh arena creation unsuccessful");
+		allocator.setAllocationName(alloc, std::string("Mesh Arena").c_str());
+
+		// blocks are sized in elements, so offsets come out as vertex offsets and first indices directly
+		vertexBlock = vma::createVirtualBlock(vma::VirtualBlockCreateInfo().setSize(vertexCapacity));
+		indexBlock = vma::createVirtualBlock(vma::VirtualBlockCreateInfo().setSize(indexCapacity));
+	}
+	void destroy(vma::Allocator& allocator)
+	{
+		// frees whatever meshes are left along with the blocks
+		vertexBlock.clearVirtualBlock();
+		indexBlock.clearVirtualBlock();
+		vertexBlock.destroy();
+		indexBlock.destroy();
+		allocator.destroyBuffer(buffer, alloc);
+	}
+
+	// fails once the arena is full, see grow()
+	bool allocate(uint32_t nVertices, uint32_t nIndices, MeshAllocation& mesh)
+	{
+		vk::DeviceSize vertexOffset, firstIndex;
+		vma::VirtualAllocationCreateInfo vertexInfo = vma::VirtualAllocationCreateInfo().setSize(nVertices);
+		vma::VirtualAllocationCreateInfo indexInfo = vma::VirtualAllocationCreateInfo().setSize(nIndices);
+		if (vertexBlock.virtualAllocate(&vertexInfo, &mesh.vertexAlloc, &vertexOffset) != vk::Result::eSuccess) return false;
+		if (indexBlock.virtualAllocate(&indexInfo, &mesh.indexAlloc, &firstIndex) != vk::Result::eSuccess) {
+			vertexBlock.virtualFree(mesh.vertexAlloc);
+			return false;
+		}
+
+		mesh.vertexOffset = (int32_t)vertexOffset;
+		mesh.firstIndex = (uint32_t)firstIndex;
+		mesh.nIndices = nIndices;
+		return true;
+	}
+	void free(MeshAllocation& mesh)
+	{
+		vertexBlock.virtualFree(mesh.vertexAlloc);
+		indexBlock.virtualFree(mesh.indexAlloc);
+		mesh = {};
+	}
+	// rebuilds the arena with room for at least the given totals, every mesh is lost and has to be uploaded again
+	void grow(DeviceWrapper& deviceWrapper, vk::DeviceSize nVertices, vk::DeviceSize nIndices)
+	{
+		vk::DeviceSize newVertexCapacity = vertexCapacity, newIndexCapacity = indexCapacity;
+		while (newVertexCapacity < nVertices) newVertexCapacity *= 2;
+		while (newIndexCapacity < nIndices) newIndexCapacity *= 2;
+		VMI_WARN("Mesh arena too small for " << nVertices << " vertices and " << nIndices << " indices, growing to "
+			<< newVertexCapacity << " vertices and " << newIndexCapacity << " indices");
+
+		// earlier frames may still draw from the old buffer
+		deviceWrapper.wait_for_submissions();
+		destroy(allocator);
+		init(allocator, vertexStride, newVertexCapacity, newIndexCapacity);
+	}
+
+	// byte offsets of a mesh's data within the buffer, for transfers
+	vk::DeviceSize get_vertex_byte_offset(const MeshAllocation& mesh)
+	{
+		return vertexStride * (vk::DeviceSize)mesh.vertexOffset;
+	}
+	vk::DeviceSize get_index_byte_offset(const MeshAllocation& mesh)
+	{
+		return indexRegionBegin + sizeof(Index) * (vk::DeviceSize)mesh.firstIndex;
+	}
+	vk::Buffer get_buffer()
+	{
+		return buffer;
+	}
+
+	// uploads are not waited on, their command buffers are freed once the timeline passed them
+	void track_upload(vk::CommandBuffer commandBuffer, uint64_t timelineValue)
+	{
+		pendingUploads.emplace_back(commandBuffer, timelineValue);
+	}
+	void release_uploads(DeviceWrapper& deviceWrapper, vk::CommandPool& commandPool)
+	{
+		uint64_t completedValue = deviceWrapper.get_completed_value();
+		auto iDone = std::partition(pendingUploads.begin(), pendingUploads.end(), [&](auto& upload) { return upload.second > completedValue; });
+		for (auto upload = iDone; upload != pendingUploads.end(); upload++) {
+			deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, upload->first);
+		}
+		pendingUploads.erase(iDone, pendingUploads.end());
+	}
+
+	// once per command buffer, every mesh is then drawn with its own vertex offset and first index
+	void bind(vk::CommandBuffer& commandBuffer)
+	{
+		vk::DeviceSize offset = 0;
+		commandBuffer.bindVertexBuffers(0, 1, &buffer, &offset);
+		commandBuffer.bindIndexBuffer(buffer, indexRegionBegin, vk::IndexType::eUint32);
+	}
+
+private:
+	vma::Allocator allocator;
+	vk::Buffer buffer;
+	vma::Allocation alloc;
+	vma::VirtualBlock vertexBlock, indexBlock;
+
+	vk::DeviceSize vertexStride = 0;
+	vk::DeviceSize vertexCapacity = 0, indexCapacity = 0;
+	vk::DeviceSize indexRegionBegin = 0;
+	std::vector<std::pair<vk::CommandBuffer, uint64_t>> pendingUploads;
+};
@@ -5,11 +5,10 @@
 class SyncFrameData
 {
 public:
-	void init(DeviceWrapper& deviceWrapper)
+	void init(DeviceWrapper& deviceWrapper, uint32_t nThreads)
 	{
 		create_semaphores(deviceWrapper);
-		create_fence(deviceWrapper);
-		create_command_pools(deviceWrapper);
+		create_command_pools(deviceWrapper, nThreads);
 		create_command_buffer(deviceWrapper);
 	}
 	void destroy(DeviceWrapper& deviceWrapper)
@@ -17,8 +16,35 @@ public:
 		vk::Device& device = deviceWrapper.logicalDevice;
 		device.destroySemaphore(imageAvailable);
 		device.destroySemaphore(renderFinished);
-		device.destroyFence(commandBufferFence);
 		device.destroyCommandPool(commandPool);
+		device.destroyCommandPool(computeCommandPool);
+		for (auto& commands : threadCommands) {
+			device.destroyCommandPool(commands.commandPool);
+		}
+		threadCommands.clear();
+	}
+	// resets the primary and all secondary command buffers, the frame's timeline value has to be reached
+	void reset_command_pools(DeviceWrapper& deviceWrapper)
+	{
+		deviceWrapper.logicalDevice.resetCommandPool(commandPool);
+		if (computeCommandPool) deviceWrapper.logicalDevice.resetCommandPool(computeCommandPool);
+		for (auto& commands : threadCommands) {
+			deviceWrapper.logicalDevice.resetCommandPool(commands.commandPool);
+			commands.nUsed = 0;
+		}
+	}
+	// only to be called from the thread with the given index, as command pools are not thread safe
+	vk::CommandBuffer get_secondary_command_buffer(DeviceWrapper& deviceWrapper, uint32_t iThread)
+	{
+		ThreadCommands& commands = threadCommands[iThread];
+		if (commands.nUsed == commands.commandBuffers.size()) {
+			vk::CommandBufferAllocateInfo commandBufferInfo = vk::CommandBufferAllocateInfo()
+				.setCommandPool(commands.commandPool)
+				.setLevel(vk::CommandBufferLevel::eSecondary)
+				.setCommandBufferCount(1);
+			commands.commandBuffers.push_back(deviceWrapper.logicalDevice.allocateCommandBuffers(commandBufferInfo)[0]);
+		}
+		return commands.commandBuffers[commands.nUsed++];
 	}
 
 private:
@@ -29,14 +55,7 @@ private:
 		imageAvailable = deviceWrapper.logicalDevice.createSemaphore(semaphoreInfo);
 		renderFinished = deviceWrapper.logicalDevice.createSemaphore(semaphoreInfo);
 	}
-	void create_fence(DeviceWrapper& deviceWrapper)
-	{
-		vk::FenceCreateInfo fenceInfo = vk::FenceCreateInfo()
-			.setFlags(vk::FenceCreateFlagBits::eSignaled);
-
-		commandBufferFence = deviceWrapper.logicalDevice.createFence(fenceInfo);
-	}
-	void create_command_pools(DeviceWrapper& deviceWrapper)
+	void create_command_pools(DeviceWrapper& deviceWrapper, uint32_t nThreads)
 	{
 		vk::CommandPoolCreateInfo commandPoolInfo;
 
@@ -45,24 +64,58 @@ private:
 
 		commandPool = deviceWrapper.logicalDevice.createCommandPool(commandPoolInfo);
 
+		// one pool per worker thread, secondary buffers are allocated from them on demand
+		threadCommands.resize(nThreads);
+		for (auto& commands : threadCommands) {
+			commands.commandPool = deviceWrapper.logicalDevice.createCommandPool(commandPoolInfo);
+		}
+
+		if (deviceWrapper.bAsyncCompute) {
+			commandPoolInfo.setQueueFamilyIndex(deviceWrapper.iComputeQueue);
+			computeCommandPool = deviceWrapper.logicalDevice.createCommandPool(commandPoolInfo);
+		}
 	}
 	void create_command_buffer(DeviceWrapper& deviceWrapper)
 	{
 		vk::CommandBufferAllocateInfo commandBufferInfo = vk::CommandBufferAllocateInfo()
 			.setCommandPool(commandPool)
 			.setLevel(vk::CommandBufferLevel::ePrimary) // secondary are used by primary command buffers for e.g. common operations
-			.setCommandBufferCount(1);
-		commandBuffer = deviceWrapper.logicalDevice.allocateCommandBuffers(commandBufferInfo)[0];
+			.setCommandBufferCount(2);
+		std::vector<vk::CommandBuffer> commandBuffers = deviceWrapper.logicalDevice.allocateCommandBuffers(commandBufferInfo);
+		commandBuffer = commandBuffers[0];
+		lateCommandBuffer = commandBuffers[1];
+
+		if (deviceWrapper.bAsyncCompute) {
+			commandBufferInfo
+				.setCommandPool(computeCommandPool)
+				.setCommandBufferCount(1);
+			computeCommandBuffer = deviceWrapper.logicalDevice.allocateCommandBuffers(commandBufferInfo)[0];
+		}
 	}
 
 public:
 	vk::Semaphore imageAvailable;
 	vk::Semaphore renderFinished;
-	vk::Fence commandBufferFence;
+	uint64_t timelineValue = 0; // signaled once the last submission using this frame finished
+	uint64_t computeTimelineValue = 0; // same for the compute timeline
 
-	// needs to be vector later (one for each thread)
+	// primary command buffer, recorded on the main thread
 	vk::CommandPool commandPool;
 	vk::CommandBuffer commandBuffer;
+	vk::CommandBuffer lateCommandBuffer; // graphics work after the frame's async compute submission
+
+	// only with async compute
+	vk::CommandPool computeCommandPool;
+	vk::CommandBuffer computeCommandBuffer;
+
+private:
+	struct ThreadCommands
+	{
+		vk::CommandPool commandPool;
+		std::vector<vk::CommandBuffer> commandBuffers;
+		size_t nUsed = 0;
+	};
+	std::vector<ThreadCommands> threadCommands;
 };
 
 template<class Data>
@@ -100,12 +153,19 @@ public:
 
 	void reset()
 	{
-		// set up linked list
+		if (frames.empty()) {
+			pCurrent = nullptr;
+			return;
+		}
+
+		// set up linked list, each frame pointing to its successor and the last one wrapping around
 		for (size_t i = 0; i < frames.size() - 1; i++) {
-			frames[i].pNext = &frames[i];
+			frames[i].pNext = &frames[i + 1];
 		}
 		frames.back().pNext = &frames.front();
 		pCurrent = &frames.front();
+
+		DEBUG_ONLY(validate());
 	}
 	void advance()
 	{
@@ -115,6 +175,10 @@ public:
 	{
 		return pCurrent->data;
 	}
+	uint32_t get_current_index()
+	{
+		return (uint32_t)(pCurrent - frames.data());
+	}
 	Data& get_next()
 	{
 		advance();
@@ -126,15 +190,32 @@ public:
 	}
 	std::vector<Data*> get_all()
 	{
-		std::vector<Data*> allData(frames.size);
+		std::vector<Data*> allData(frames.size());
 		for (size_t i = 0; i < frames.size(); i++) {
 			allData[i] = &frames[i].data;
 		}
 		return allData;
 	}
 
+private:
+#if defined(_DEBUG)
+	// walking the ring once has to visit every frame exactly once and end up back at the start
+	void validate()
+	{
+		std::vector<bool> visited(frames.size(), false);
+		RingFrame* pFrame = &frames.front();
+		for (size_t i = 0; i < frames.size(); i++) {
+			size_t index = pFrame - frames.data();
+			assert(index < frames.size() && !visited[index]);
+			visited[index] = true;
+			pFrame = pFrame->pNext;
+		}
+		assert(pFrame == &frames.front());
+	}
+#endif
+
 private:
 	struct RingFrame { RingFrame* pNext; Data data; };
 	std::vector<RingFrame> frames;
-	RingFrame* pCurrent;
+	RingFrame* pCurrent = nullptr;
 };
\ No newline at end of file
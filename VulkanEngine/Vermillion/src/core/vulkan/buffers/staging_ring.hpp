@@ -0,0 +1,156 @@
+#pragma once
+
+#include "devices/device_wrapper.hpp"
+
+// sub-allocation of the staging ring, valid until the submission it was tracked with has finished
+struct StagingAllocation
+{
+	vk::Buffer buffer;
+	vk::DeviceSize offset;
+	vk::DeviceSize size;
+	uint8_t* pMapped;
+};
+
+// one persistently mapped buffer shared by uploads and readbacks,
+// regions are handed out in ring order and reclaimed once the timeline passes the submission that used them
+class StagingRing
+{
+public:
+	StagingRing() = default;
+	~StagingRing() = default;
+	ROF_COPY_MOVE_DELETE(StagingRing)
+
+public:
+	void init(vma::Allocator& allocator, vk::DeviceSize capacity = 32 * 1024 * 1024)
+	{
+		this->allocator = allocator;
+		create_buffer(capacity);
+	}
+	void destroy(DeviceWrapper& deviceWrapper)
+	{
+		// regions may still be read by the GPU
+		if (!regions.empty()) deviceWrapper.wait_for(regions.back().timelineValue == untracked ? deviceWrapper.timelineValue : regions.back().timelineValue);
+		regions.clear();
+		allocator.destroyBuffer(buffer, alloc);
+	}
+
+	// blocks on the oldest submissions when the ring is full
+	StagingAllocation allocate(DeviceWrapper& deviceWrapper, vk::DeviceSize size)
+	{
+		vk::DeviceSize alignedSize = align(size);
+		if (alignedSize > capacity) grow(deviceWrapper, alignedSize);
+
+		reclaim(deviceWrapper);
+		vk::DeviceSize offset;
+		while (!find_space(alignedSize, offset)) {
+			if (regions.front().timelineValue == untracked) {
+				VMI_ERR("Staging ring exhausted by allocations that were never submitted");
+				assert(false);
+			}
+			deviceWrapper.wait_for(regions.front().timelineValue);
+			reclaim(deviceWrapper);
+		}
+
+		regions.push_back({ offset, offset + alignedSize, untracked });
+		head = offset + alignedSize;
+		return { buffer, offset, size, pMapped + offset };
+	}
+	// every allocation made since the last call is in use until the given timeline value is reached
+	void track(uint64_t timelineValue)
+	{
+		for (auto region = regions.rbegin(); region != regions.rend() && region->timelineValue == untracked; region++) {
+			region->timelineValue = timelineValue;
+		}
+	}
+
+	// uploads write before submission, readbacks read after waiting on it
+	void write(StagingAllocation& staging, const void* pData, vk::DeviceSize size)
+	{
+		memcpy(staging.pMapped, pData, size);
+		allocator.flushAllocation(alloc, staging.offset, size);
+	}
+	void read(StagingAllocation& staging, void* pData, vk::DeviceSize size)
+	{
+		allocator.invalidateAllocation(alloc, staging.offset, size);
+		memcpy(pData, staging.pMapped, size);
+	}
+
+private:
+	void create_buffer(vk::DeviceSize size)
+	{
+		capacity = size;
+		head = 0;
+
+		vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
+			.setSize(capacity)
+			.setUsage(vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst);
+		// random access to get cached memory, as readbacks are read on the host
+		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eAuto)
+			.setFlags(vma::AllocationCreateFlagBits::eHostAccessRandom | vma::AllocationCreateFlagBits::eMapped);
+
+		vma::AllocationInfo allocInfo;
+		vk::Result result = allocator.createBuffer(&bufferInfo, &allocCreateInfo, &buffer, &alloc, &allocInfo);
+		if (result != vk::Result::eSuccess) VMI_ERR("Staging ring creation unsuccessful");
+		allocator.setAllocationName(alloc, std::string("Staging Ring").c_str());
+		pMapped = reinterpret_cast<uint8_t*>(allocInfo.pMappedData);
+	}
+	void grow(DeviceWrapper& deviceWrapper, vk::DeviceSize size)
+	{
+		vk::DeviceSize newCapacity = capacity;
+		while (newCapacity < size) newCapacity *= 2;
+		assert(regions.empty() || regions.back().timelineValue != untracked); // pending allocations would move with the buffer
+		VMI_WARN("Staging ring too small for a " << size << " byte transfer, growing to " << newCapacity << " bytes");
+
+		destroy(deviceWrapper);
+		create_buffer(newCapacity);
+	}
+	void reclaim(DeviceWrapper& deviceWrapper)
+	{
+		uint64_t completedValue = deviceWrapper.get_completed_value();
+		while (!regions.empty() && regions.front().timelineValue <= completedValue) regions.pop_front();
+	}
+	bool find_space(vk::DeviceSize size, vk::DeviceSize& offset)
+	{
+		if (regions.empty()) {
+			offset = 0;
+			return true;
+		}
+
+		// offsets never meet the tail exactly, so head == tail always means an empty ring
+		vk::DeviceSize tail = regions.front().begin;
+		if (head >= tail) {
+			if (head + size <= capacity) offset = head;
+			else if (size < tail) offset = 0; // wrap around
+			else return false;
+		}
+		else {
+			if (head + size < tail) offset = head;
+			else return false;
+		}
+		return true;
+	}
+	vk::DeviceSize align(vk::DeviceSize size)
+	{
+		// satisfies texel and non-coherent atom alignment of every format in use
+		return std::max<vk::DeviceSize>((size + alignment - 1) & ~(alignment - 1), alignment);
+	}
+
+private:
+	static constexpr uint64_t untracked = UINT64_MAX;
+	static constexpr vk::DeviceSize alignment = 256;
+	struct Region
+	{
+		vk::DeviceSize begin, end;
+		uint64_t timelineValue;
+	};
+
+	vma::Allocator allocator;
+	vk::Buffer buffer;
+	vma::Allocation alloc;
+	uint8_t* pMapped = nullptr;
+	vk::DeviceSize capacity = 0;
+
+	vk::DeviceSize head = 0; // next free byte
+	std::deque<Region> regions; // in allocation order, oldest first
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "devices/device_wrapper.hpp"
+#include "wrappers/descriptor_allocator.hpp"
+#include "wrappers/layout_cache.hpp"
+
+// one persistently mapped buffer, split into a region per frame in flight,
+// uniform data is pushed linearly each frame and bound through dynamic offsets
+class UniformArena
+{
+public:
+	UniformArena() = default;
+	~UniformArena() = default;
+	ROF_COPY_MOVE_DELETE(UniformArena)
+
+public:
+	void init(DeviceWrapper& deviceWrapper, vma::Allocator& allocator, uint32_t nFrames, vk::DeviceSize frameCapacity = 256 * 1024)
+	{
+		alignment = deviceWrapper.deviceProperties.limits.minUniformBufferOffsetAlignment;
+		frameSize = align(frameCapacity);
+		this->nFrames = nFrames;
+
+		vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
+			.setSize(frameSize * nFrames)
+			.setUsage(vk::BufferUsageFlagBits::eUniformBuffer);
+
+		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eAuto)
+			.setFlags(vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
+
+		vma::AllocationInfo allocInfo;
+		vk::Result result = allocator.createBuffer(&bufferInfo, &allocCreateInfo, &buffer, &alloc, &allocInfo);
+		if (result != vk::Result::eSuccess) VMI_ERR("Uniform arena creation unsuccessful");
+		allocator.setAllocationName(alloc, std::string("Uniform Arena").c_str());
+		pMapped = reinterpret_cast<uint8_t*>(allocInfo.pMappedData);
+	}
+	void destroy(vma::Allocator& allocator)
+	{
+		allocator.destroyBuffer(buffer, alloc);
+		pMapped = nullptr;
+	}
+
+	// only once the frame's timeline value was reached, as this overwrites what its previous use pushed
+	void begin_frame(uint32_t iFrame)
+	{
+		assert(iFrame < nFrames);
+		frameBegin = frameSize * iFrame;
+		offset = frameBegin;
+	}
+	// copies data into the current frame's region and returns the dynamic offset to bind it with
+	template<class T>
+	uint32_t push(const T& data)
+	{
+		vk::DeviceSize size = align(sizeof(T));
+		if (offset + size > frameBegin + frameSize) {
+			VMI_ERR("Uniform arena out of space: " << frameSize << " bytes per frame");
+			assert(false);
+			return (uint32_t)frameBegin;
+		}
+
+		memcpy(pMapped + offset, &data, sizeof(T));
+		uint32_t dynamicOffset = (uint32_t)offset;
+		offset += size;
+		return dynamicOffset;
+	}
+
+	// a set only describes the binding and range, so one is enough per kind of data regardless of how often it is pushed
+	vk::DescriptorSet create_desc_set(DeviceWrapper& deviceWrapper, DescriptorAllocator& descAllocator, vk::DescriptorSetLayout layout, uint32_t binding, vk::DeviceSize range)
+	{
+		vk::DescriptorSet descSet = descAllocator.allocate(deviceWrapper, layout);
+
+		vk::DescriptorBufferInfo descBufferInfo = vk::DescriptorBufferInfo()
+			.setBuffer(buffer)
+			.setOffset(0)
+			.setRange(range);
+
+		vk::WriteDescriptorSet descBufferWrite = vk::WriteDescriptorSet()
+			.setDstSet(descSet)
+			.setDstBinding(binding)
+			.setDstArrayElement(0)
+			.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+			.setDescriptorCount(1)
+			.setPBufferInfo(&descBufferInfo);
+		deviceWrapper.logicalDevice.updateDescriptorSets(descBufferWrite, {});
+		return descSet;
+	}
+	static vk::DescriptorSetLayout get_desc_set_layout(DeviceWrapper& deviceWrapper, LayoutCache& layoutCache, uint32_t binding, vk::ShaderStageFlags stageFlags)
+	{
+		vk::DescriptorSetLayoutBinding layoutBinding = vk::DescriptorSetLayoutBinding()
+			.setBinding(binding)
+			.setStageFlags(stageFlags)
+			.setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+			.setDescriptorCount(1)
+			.setPImmutableSamplers(nullptr);
+		return layoutCache.get_desc_set_layout(deviceWrapper, { layoutBinding });
+	}
+
+	// bytes pushed during the current frame
+	vk::DeviceSize get_frame_usage()
+	{
+		return offset - frameBegin;
+	}
+	vk::DeviceSize get_frame_capacity()
+	{
+		return frameSize;
+	}
+
+private:
+	vk::DeviceSize align(vk::DeviceSize size)
+	{
+		return (size + alignment - 1) & ~(alignment - 1);
+	}
+
+private:
+	vk::Buffer buffer;
+	vma::Allocation alloc;
+	uint8_t* pMapped = nullptr;
+
+	vk::DeviceSize alignment = 256;
+	vk::DeviceSize frameSize = 0;
+	uint32_t nFrames = 0;
+
+	// linear allocation state of the current frame
+	vk::DeviceSize frameBegin = 0;
+	vk::DeviceSize offset = 0;
+};
@@ -10,7 +10,8 @@ public:
 	ROF_COPY_MOVE_DELETE(DeviceManager)
 
 public:
-	void init(vk::Instance& instance, vk::SurfaceKHR& surface)
+	// bPreferCpu favors software drivers like lavapipe, whose results are the same on every machine
+	void init(vk::Instance& instance, vk::SurfaceKHR& surface, bool bPreferCpu = false)
 	{
 		VMI_LOG("[Initializing] Device manager...");
 		std::vector<vk::PhysicalDevice> physicalDevices = instance.enumeratePhysicalDevices();
@@ -18,7 +19,7 @@ public:
 		devices.reserve(physicalDevices.size());
 		for (vk::PhysicalDevice& physicalDevice : physicalDevices) devices.emplace_back(physicalDevice, surface);
 
-		pick_best_physical_device(surface);
+		pick_best_physical_device(bPreferCpu);
 		get_device_wrapper().create_logical_device();
 	}
 	void destroy()
@@ -31,12 +32,13 @@ public:
 	inline DeviceWrapper& get_device_wrapper() { return devices[iCurrentDevice]; }
 
 private:
-	void pick_best_physical_device(vk::SurfaceKHR& surface)
+	void pick_best_physical_device(bool bPreferCpu)
 	{
 		int highscore = -1;
 		for (int i = 0; i < devices.size(); i++)
 		{
 			int score = devices[i].get_device_score();
+			if (bPreferCpu && score >= 0 && devices[i].deviceProperties.deviceType == vk::PhysicalDeviceType::eCpu) score += 1 << 20;
 			if (score > highscore) {
 				highscore = score;
 				iCurrentDevice = i;
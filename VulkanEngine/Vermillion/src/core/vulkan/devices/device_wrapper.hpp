@@ -3,14 +3,16 @@
 class DeviceWrapper
 {
 public:
+	// a null surface makes the device headless, without swapchain support
 	DeviceWrapper(vk::PhysicalDevice& physicalDevice, vk::SurfaceKHR& surface) :
-		physicalDevice(physicalDevice), iQueue(UINT32_MAX), iTransferQueue(UINT32_MAX)
+		physicalDevice(physicalDevice), iQueue(UINT32_MAX), iTransferQueue(UINT32_MAX), iComputeQueue(UINT32_MAX), bHeadless(!surface)
 	{
 		physicalDevice.getProperties(&deviceProperties);
 		physicalDevice.getFeatures(&deviceFeatures);
 		physicalDevice.getMemoryProperties(&deviceMemProperties);
+		query_vulkan11_support();
 
-		query_swapchain_support_details(surface);
+		if (!bHeadless) query_swapchain_support_details(surface);
 		assign_queue_family_index(surface);
 	}
 
@@ -25,21 +27,25 @@ public:
 		deviceScore += deviceProperties.limits.maxImageDimension2D;
 
 		if (iQueue == UINT32_MAX) return -1; // check for valid queue index
-		else if (formats.empty() || presentModes.empty()) return -1;
+		else if (!bHeadless && (formats.empty() || presentModes.empty())) return -1;
+		else if (!bTimelineSemaphore) return -1; // all queue submissions are tracked through a timeline
+		else if (!deviceFeatures.drawIndirectFirstInstance) return -1; // indirect draws pick their instance through firstInstance
 		else return deviceScore;
 	}
 	void create_logical_device()
 	{
 		std::string spacing = "    ";
 		VMI_LOG(spacing << "Required device extensions:");
-		std::vector<const char*> requiredDeviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+		std::vector<const char*> requiredDeviceExtensions = { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME };
+		if (!bHeadless) requiredDeviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 		for (const auto& extension : requiredDeviceExtensions) VMI_LOG(spacing << "- " << extension);
 		VMI_LOG("");
 
 		VMI_LOG(spacing << "Optional device extensions:");
 		std::vector<const char*> optionalDeviceExtensions = {
 			VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME,
-			VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME
+			VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME,
+			VK_EXT_MEMORY_BUDGET_EXTENSION_NAME
 		};
 		for (const auto& extension : optionalDeviceExtensions) VMI_LOG(spacing << "- " << extension);
 		VMI_LOG("");
@@ -54,74 +60,164 @@ public:
 				}
 			}
 		}
-		for (const auto& extension : requiredDeviceExtensions) VMI_LOG(spacing << "- " << extension);
+		// dynamic rendering and the extensions it builds on
+		if (bDynamicRendering) {
+			requiredDeviceExtensions.insert(requiredDeviceExtensions.end(), {
+				VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+				VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+				VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME });
+		}
+		for (const auto& extension : requiredDeviceExtensions) {
+			VMI_LOG(spacing << "- " << extension);
+			if (std::string(extension) == VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) bMemoryBudget = true;
+		}
+
+		// indirect draws are issued one by one without multi-draw
+		bMultiDrawIndirect = deviceFeatures.multiDrawIndirect;
+		vk::PhysicalDeviceFeatures enabledFeatures = vk::PhysicalDeviceFeatures()
+			.setMultiDrawIndirect(bMultiDrawIndirect)
+			.setDrawIndirectFirstInstance(VK_TRUE);
+		VMI_LOG(spacing << "Multi-draw indirect: " << (bMultiDrawIndirect ? "enabled" : "unsupported"));
 
-		vk::PhysicalDeviceFeatures deviceFeatures = vk::PhysicalDeviceFeatures();
-		// TODO: set specific features here
+		// core 1.1 features are enabled through the pNext chain
+		vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR timelineFeatures = vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR()
+			.setTimelineSemaphore(VK_TRUE);
+		vk::PhysicalDeviceMultiviewFeatures multiviewFeatures = vk::PhysicalDeviceMultiviewFeatures()
+			.setMultiview(bMultiview);
+		vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = vk::PhysicalDeviceDynamicRenderingFeaturesKHR()
+			.setDynamicRendering(bDynamicRendering);
+		void* pFeatures = &timelineFeatures;
+		if (bMultiview) pFeatures = &multiviewFeatures.setPNext(pFeatures);
+		if (bDynamicRendering) pFeatures = &dynamicRenderingFeatures.setPNext(pFeatures);
+		VMI_LOG(spacing << "Multiview: " << (bMultiview ? "enabled" : "unsupported"));
+		VMI_LOG(spacing << "Dynamic rendering: " << (bDynamicRendering ? "enabled" : "unsupported"));
 
 		// graphics and transfer share the same family
 		if (iTransferQueue == UINT32_MAX) {
 			VMI_WARN("No dedicated transfer queue family found. Falling back to graphics queue family");
 			iTransferQueue = iQueue;
-
-			std::array<vk::DeviceQueueCreateInfo, 1> queueInfos;
-			float qPriority = 1.0f;
-			queueInfos[0] = vk::DeviceQueueCreateInfo()
-				.setQueueFamilyIndex(iQueue)
-				.setQueueCount(1)
-				.setPQueuePriorities(&qPriority);
-
-			vk::DeviceCreateInfo createInfo = vk::DeviceCreateInfo()
-				// queues
-				.setQueueCreateInfoCount((uint32_t)queueInfos.size()).setPQueueCreateInfos(queueInfos.data())
-				// extensions
-				.setEnabledExtensionCount((uint32_t)requiredDeviceExtensions.size()).setPpEnabledExtensionNames(requiredDeviceExtensions.data())
-				// device features
-				.setPEnabledFeatures(&deviceFeatures);
-
-			// Create logical device
-			logicalDevice = physicalDevice.createDevice(createInfo);
-
-			// get actual handle for graphics queue
-			queue = logicalDevice.getQueue(iQueue, 0u);
-			transferQueue = queue;
 		}
-		// dedicated transfer queue
-		else {
-			std::array<vk::DeviceQueueCreateInfo, 2> queueInfos;
-			float qPriority = 1.0f;
-			queueInfos[0] = vk::DeviceQueueCreateInfo()
+		// depth estimation runs on the graphics queue as well
+		bAsyncCompute = iComputeQueue != UINT32_MAX;
+		VMI_LOG(spacing << "Async compute: " << (bAsyncCompute ? "queue family " + std::to_string(iComputeQueue) : std::string("unsupported")));
+
+		// one queue of each family in use
+		float qPriority = 1.0f, qTransferPriority = 0.9f;
+		std::vector<vk::DeviceQueueCreateInfo> queueInfos = {
+			vk::DeviceQueueCreateInfo()
 				.setQueueFamilyIndex(iQueue)
 				.setQueueCount(1)
-				.setPQueuePriorities(&qPriority);
-			float qTransferPriority = 0.9f;
-			queueInfos[1] = vk::DeviceQueueCreateInfo()
+				.setPQueuePriorities(&qPriority)
+		};
+		if (iTransferQueue != iQueue) {
+			queueInfos.push_back(vk::DeviceQueueCreateInfo()
 				.setQueueFamilyIndex(iTransferQueue)
 				.setQueueCount(1)
-				.setPQueuePriorities(&qTransferPriority);
-
-			vk::DeviceCreateInfo createInfo = vk::DeviceCreateInfo()
-				// queues
-				.setQueueCreateInfoCount((uint32_t)queueInfos.size()).setPQueueCreateInfos(queueInfos.data())
-				// extensions
-				.setEnabledExtensionCount((uint32_t)requiredDeviceExtensions.size()).setPpEnabledExtensionNames(requiredDeviceExtensions.data())
-				// device features
-				.setPEnabledFeatures(&deviceFeatures);
-
-			// Create logical device
-			logicalDevice = physicalDevice.createDevice(createInfo);
-
-			// get actual handle for graphics queue
-			queue = logicalDevice.getQueue(iQueue, 0u);
-			transferQueue = logicalDevice.getQueue(iTransferQueue, 0);
+				.setPQueuePriorities(&qTransferPriority));
+		}
+		if (bAsyncCompute) {
+			queueInfos.push_back(vk::DeviceQueueCreateInfo()
+				.setQueueFamilyIndex(iComputeQueue)
+				.setQueueCount(1)
+				.setPQueuePriorities(&qPriority));
 		}
 
+		vk::DeviceCreateInfo createInfo = vk::DeviceCreateInfo()
+			// queues
+			.setQueueCreateInfos(queueInfos)
+			// extensions
+			.setEnabledExtensionCount((uint32_t)requiredDeviceExtensions.size()).setPpEnabledExtensionNames(requiredDeviceExtensions.data())
+			// device features
+			.setPEnabledFeatures(&enabledFeatures)
+			.setPNext(pFeatures);
+
+		// Create logical device
+		logicalDevice = physicalDevice.createDevice(createInfo);
+
+		// get actual handles for the queues
+		queue = logicalDevice.getQueue(iQueue, 0u);
+		transferQueue = logicalDevice.getQueue(iTransferQueue, 0u);
+		if (bAsyncCompute) computeQueue = logicalDevice.getQueue(iComputeQueue, 0u);
+
 		VMI_LOG("[Initializing] Device-specific vulkan functions...");
 		VULKAN_HPP_DEFAULT_DISPATCHER.init(logicalDevice);
+
+		timeline = create_timeline();
+		computeTimeline = create_timeline();
+	}
+	void destroy_logical_device()
+	{
+		logicalDevice.destroySemaphore(timeline);
+		logicalDevice.destroySemaphore(computeTimeline);
+		logicalDevice.destroy();
+	}
+
+	// submits to the graphics queue, additionally signaling the timeline with a new value that is returned,
+	// waitValues only matter for timeline semaphores among the wait semaphores and default to 0 for the rest
+	uint64_t submit(vk::SubmitInfo submitInfo, std::vector<uint64_t> waitValues = {})
+	{
+		return submit(queue, timeline, timelineValue, submitInfo, waitValues);
+	}
+	// the compute queue signals its own timeline, signals from two queues could otherwise arrive out of order
+	uint64_t submit_compute(vk::SubmitInfo submitInfo, std::vector<uint64_t> waitValues = {})
+	{
+		return submit(computeQueue, computeTimeline, computeTimelineValue, submitInfo, waitValues);
+	}
+	// blocks until the submission that signals the given value (and every one before it) has finished
+	void wait_for(uint64_t value)
+	{
+		vk::SemaphoreWaitInfoKHR waitInfo = vk::SemaphoreWaitInfoKHR()
+			.setSemaphores(timeline)
+			.setValues(value);
+		vk::Result result = logicalDevice.waitSemaphoresKHR(waitInfo, UINT64_MAX);
+		if (result != vk::Result::eSuccess) assert(false);
+	}
+	// same for the compute timeline
+	void wait_for_compute(uint64_t value)
+	{
+		vk::SemaphoreWaitInfoKHR waitInfo = vk::SemaphoreWaitInfoKHR()
+			.setSemaphores(computeTimeline)
+			.setValues(value);
+		vk::Result result = logicalDevice.waitSemaphoresKHR(waitInfo, UINT64_MAX);
+		if (result != vk::Result::eSuccess) assert(false);
+	}
+	// waits on everything submitted so far, without stalling the presentation engine like waitIdle() would
+	void wait_for_submissions()
+	{
+		std::array<vk::Semaphore, 2> semaphores = { timeline, computeTimeline };
+		std::array<uint64_t, 2> values = { timelineValue, computeTimelineValue };
+		vk::SemaphoreWaitInfoKHR waitInfo = vk::SemaphoreWaitInfoKHR()
+			.setSemaphores(semaphores)
+			.setValues(values);
+		vk::Result result = logicalDevice.waitSemaphoresKHR(waitInfo, UINT64_MAX);
+		if (result != vk::Result::eSuccess) assert(false);
+	}
+	uint64_t get_completed_value()
+	{
+		return logicalDevice.getSemaphoreCounterValueKHR(timeline);
 	}
-	void destroy_logical_device() { logicalDevice.destroy(); }
 
 private:
+	uint64_t submit(vk::Queue& targetQueue, vk::Semaphore& semaphore, uint64_t& semaphoreValue, vk::SubmitInfo submitInfo, std::vector<uint64_t>& waitValues)
+	{
+		uint64_t value = ++semaphoreValue;
+
+		std::vector<vk::Semaphore> signalSemaphores(submitInfo.pSignalSemaphores, submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+		signalSemaphores.push_back(semaphore);
+		// values of binary semaphores are ignored
+		std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+		signalValues.back() = value;
+		waitValues.resize(submitInfo.waitSemaphoreCount, 0);
+
+		vk::TimelineSemaphoreSubmitInfoKHR timelineInfo = vk::TimelineSemaphoreSubmitInfoKHR()
+			.setWaitSemaphoreValues(waitValues)
+			.setSignalSemaphoreValues(signalValues);
+		submitInfo
+			.setSignalSemaphores(signalSemaphores)
+			.setPNext(&timelineInfo);
+		targetQueue.submit(submitInfo);
+		return value;
+	}
 	void assign_queue_family_index(vk::SurfaceKHR& surface)
 	{
 		// find a queue family that supports both graphics and presentation
@@ -149,7 +245,7 @@ private:
 		for (int i = 0; i < queueFamilies.size(); i++) {
 
 			if (queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics &&
-				physicalDevice.getSurfaceSupportKHR(i, surface)) {
+				(bHeadless || physicalDevice.getSurfaceSupportKHR(i, surface))) {
 
 				iQueue = i;
 				break;
@@ -166,6 +262,54 @@ private:
 				break;
 			}
 		}
+		// get compute queue that runs alongside the graphics queue
+		for (int i = 0; i < queueFamilies.size(); i++) {
+
+			if (queueFamilies[i].queueFlags & vk::QueueFlagBits::eCompute &&
+				!(queueFamilies[i].queueFlags & vk::QueueFlagBits::eGraphics)) {
+
+				iComputeQueue = i;
+				break;
+			}
+		}
+	}
+	void query_vulkan11_support()
+	{
+		if (deviceProperties.apiVersion < VK_API_VERSION_1_1) return;
+
+		auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceMultiviewFeatures>();
+		auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceMultiviewProperties>();
+
+		// the lightfield needs one view per camera
+		multiviewProperties = properties.get<vk::PhysicalDeviceMultiviewProperties>();
+		bMultiview = features.get<vk::PhysicalDeviceMultiviewFeatures>().multiview && multiviewProperties.maxMultiviewViewCount >= 9;
+
+		// the timeline feature struct may only be chained when the extension exists
+		std::vector<vk::ExtensionProperties> availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+		bool bRenderpass2 = false, bDepthStencilResolve = false;
+		for (const auto& extension : availableExtensions) {
+			std::string name = extension.extensionName.data();
+			if (name == VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME) bRenderpass2 = true;
+			else if (name == VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) bDepthStencilResolve = true;
+			else if (name == VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME) {
+				auto timelineFeatures = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR>();
+				bTimelineSemaphore = timelineFeatures.get<vk::PhysicalDeviceTimelineSemaphoreFeaturesKHR>().timelineSemaphore;
+			}
+			else if (name == VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) {
+				auto dynamicRenderingFeatures = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDynamicRenderingFeaturesKHR>();
+				bDynamicRendering = dynamicRenderingFeatures.get<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>().dynamicRendering;
+			}
+		}
+		bDynamicRendering &= bRenderpass2 && bDepthStencilResolve;
+	}
+	vk::Semaphore create_timeline()
+	{
+		vk::SemaphoreTypeCreateInfoKHR typeInfo = vk::SemaphoreTypeCreateInfoKHR()
+			.setSemaphoreType(vk::SemaphoreTypeKHR::eTimeline)
+			.setInitialValue(0);
+		vk::SemaphoreCreateInfo semaphoreInfo = vk::SemaphoreCreateInfo()
+			.setPNext(&typeInfo);
+		return logicalDevice.createSemaphore(semaphoreInfo);
 	}
 	void query_swapchain_support_details(vk::SurfaceKHR& surface)
 	{
@@ -178,8 +322,8 @@ public:
 	vk::PhysicalDevice physicalDevice;
 	vk::Device logicalDevice;
 
-	vk::Queue queue, transferQueue;
-	uint32_t iQueue, iTransferQueue;
+	vk::Queue queue, transferQueue, computeQueue;
+	uint32_t iQueue, iTransferQueue, iComputeQueue;
 
 	// some properties of the device
 	vk::SurfaceCapabilitiesKHR capabilities;
@@ -189,4 +333,22 @@ public:
 	vk::PhysicalDeviceProperties deviceProperties;
 	vk::PhysicalDeviceFeatures deviceFeatures;
 	vk::PhysicalDeviceMemoryProperties deviceMemProperties;
+	vk::PhysicalDeviceMultiviewProperties multiviewProperties;
+
+	// optional features, enabled on the logical device when supported
+	bool bMultiview = false;
+	bool bTimelineSemaphore = false;
+	bool bMemoryBudget = false; // lets VMA report the budget the driver actually grants
+	bool bMultiDrawIndirect = false;
+	bool bDynamicRendering = false; // passes without subpasses begin rendering on image views instead of framebuffers
+	bool bAsyncCompute = false; // a compute only family exists, depth estimation overlaps with graphics work there
+	bool bHeadless; // created without a surface, nothing is presented
+
+	// signaled by every submission to the graphics queue, in submission order
+	vk::Semaphore timeline;
+	uint64_t timelineValue = 0; // value signaled by the latest submission
+
+	// same for the compute queue
+	vk::Semaphore computeTimeline;
+	uint64_t computeTimelineValue = 0;
 };
\ No newline at end of file
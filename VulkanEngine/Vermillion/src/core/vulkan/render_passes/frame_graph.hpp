@@ -0,0 +1,316 @@
+#pragma once
+
+// how a pass uses an image, the graph derives barriers and layout transitions from these
+struct ImageAccess
+{
+	uint32_t iImage;
+	vk::ImageLayout layout;
+	vk::PipelineStageFlags stages;
+	vk::AccessFlags access;
+	bool bDiscard = false; // previous contents are overwritten entirely
+};
+
+class FrameGraph
+{
+public:
+	enum class Queue { eGraphics, eCompute };
+
+public:
+	FrameGraph() = default;
+	~FrameGraph() = default;
+	ROF_COPY_MOVE_DELETE(FrameGraph)
+
+public:
+	// images that live across frames, their state persists between executions
+	uint32_t import_image(const char* name, vk::Image image, vk::ImageSubresourceRange range,
+		vk::ImageLayout layout, vk::ImageLayout restingLayout = vk::ImageLayout::eUndefined,
+		vk::PipelineStageFlags restingStages = vk::PipelineStageFlagBits::eAllCommands)
+	{
+		ImageState state;
+		state.name = name;
+		state.image = image;
+		state.range = range;
+		state.layout = layout;
+		state.restingLayout = restingLayout;
+		state.restingStages = restingStages;
+		images.push_back(state);
+		nPersistentImages = (uint32_t)images.size();
+		return nPersistentImages - 1;
+	}
+	// swapchain images are only owned between acquisition and presentation, so they are imported each frame
+	uint32_t import_swapchain_image(vk::Image image, vk::PipelineStageFlags acquireWaitStages)
+	{
+		ImageState state;
+		state.name = "Swapchain";
+		state.image = image;
+		state.range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+		state.layout = vk::ImageLayout::eUndefined;
+		state.restingLayout = vk::ImageLayout::ePresentSrcKHR;
+		state.restingStages = vk::PipelineStageFlagBits::eBottomOfPipe;
+		// first access has to chain onto the stage the acquire semaphore is waited on
+		state.writeStages = acquireWaitStages;
+		images.push_back(state);
+		return (uint32_t)images.size() - 1;
+	}
+	void clear()
+	{
+		images.clear();
+		passes.clear();
+		nPersistentImages = 0;
+	}
+	// for images modified outside of the graph (e.g. uploads on their own command buffer)
+	void set_layout(uint32_t iImage, vk::ImageLayout layout)
+	{
+		ImageState& state = images[iImage];
+		state.layout = layout;
+		state.writeStages = vk::PipelineStageFlagBits::eTopOfPipe;
+		state.writeAccess = {};
+		state.readStages = {};
+		state.queue = Queue::eGraphics;
+	}
+
+	// passes on the compute queue only run there when execute() is able to switch queues
+	void add_pass(const char* name, std::vector<ImageAccess> accesses, std::function<void(vk::CommandBuffer&)> record, Queue queue = Queue::eGraphics)
+	{
+		passes.push_back({ name, std::move(accesses), std::move(record), queue });
+	}
+	// images whose contents are needed after the frame, passes not contributing to any of them are culled
+	void add_output(uint32_t iImage)
+	{
+		outputs.insert(iImage);
+	}
+
+	// consecutive passes of the same queue are recorded into one command buffer, switch_queue() is called whenever the queue changes
+	// and has to submit everything recorded so far, returning the command buffer for the passes that follow.
+	// images used on both queues are handed over through semaphores: a submission has to wait on every submission
+	// of the other queue that last used one of its images, the images start over from that wait
+	void execute(vk::CommandBuffer commandBuffer, std::function<vk::CommandBuffer(Queue)> switch_queue = nullptr)
+	{
+		cull_passes();
+		currentQueue = Queue::eGraphics;
+
+		// images that never held anything are brought into their resting layout once
+		for (uint32_t i = 0; i < nPersistentImages; i++) {
+			ImageState& state = images[i];
+			if (state.layout == vk::ImageLayout::eUndefined && state.restingLayout != vk::ImageLayout::eUndefined) {
+				ImageAccess access = { i, state.restingLayout, state.restingStages, {}, true };
+				add_barrier(state, access);
+			}
+		}
+		flush_barriers(commandBuffer);
+
+		// barriers of one pass are batched, so a pass may only access each image once
+		for (auto& pass : passes) {
+			if (pass.bCulled) continue;
+
+			// without a way to switch, compute passes simply run on the graphics queue
+			Queue queue = switch_queue ? pass.queue : Queue::eGraphics;
+			if (queue != currentQueue) {
+				// images only used on the compute queue are returned to their resting layout before it hands them over
+				if (currentQueue == Queue::eCompute) rest_images(true);
+				flush_barriers(commandBuffer);
+				commandBuffer = switch_queue(queue);
+				currentQueue = queue;
+				nQueueSwitches++;
+			}
+
+			for (auto& access : pass.accesses) {
+				add_barrier(images[access.iImage], access);
+			}
+			flush_barriers(commandBuffer);
+			pass.record(commandBuffer);
+		}
+
+		// return everything that was touched to its resting layout (presentation, descriptors)
+		rest_images(false);
+		flush_barriers(commandBuffer);
+
+		// frame-local imports and passes are done
+		images.resize(nPersistentImages);
+		passes.clear();
+		outputs.clear();
+	}
+
+	void handle_imgui()
+	{
+		ImGui::Begin("Frame Graph");
+		ImGui::Text("Passes recorded: %u, culled: %u", nPassesRecorded, nPassesCulled);
+		ImGui::Text("Barrier batches: %u, image barriers: %u", nBarrierBatches, nImageBarriers);
+		ImGui::Text("Queue switches: %u", nQueueSwitches);
+		ImGui::End();
+	}
+
+private:
+	struct ImageState
+	{
+		const char* name;
+		vk::Image image;
+		vk::ImageSubresourceRange range;
+		vk::ImageLayout layout;
+		vk::ImageLayout restingLayout;
+		vk::PipelineStageFlags restingStages;
+
+		// synchronisation state since the last write
+		vk::PipelineStageFlags writeStages = vk::PipelineStageFlagBits::eTopOfPipe;
+		vk::AccessFlags writeAccess;
+		vk::PipelineStageFlags readStages; // stages the last write is already visible to
+		Queue queue = Queue::eGraphics; // queue of the last access
+	};
+	struct Pass
+	{
+		const char* name;
+		std::vector<ImageAccess> accesses;
+		std::function<void(vk::CommandBuffer&)> record;
+		Queue queue;
+		bool bCulled = false;
+	};
+
+private:
+	static bool is_write(vk::AccessFlags access)
+	{
+		constexpr vk::AccessFlags writeMask =
+			vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+			vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite |
+			vk::AccessFlagBits::eHostWrite | vk::AccessFlagBits::eMemoryWrite;
+		return (bool)(access & writeMask);
+	}
+	void cull_passes()
+	{
+		// walk backwards, keeping passes that write something still needed later on
+		std::set<uint32_t> needed = outputs;
+		for (auto pass = passes.rbegin(); pass != passes.rend(); pass++) {
+			pass->bCulled = true;
+			for (auto& access : pass->accesses) {
+				if (is_write(access.access) && needed.count(access.iImage)) pass->bCulled = false;
+			}
+			if (pass->bCulled) continue;
+
+			for (auto& access : pass->accesses) {
+				if (!is_write(access.access)) needed.insert(access.iImage);
+			}
+		}
+
+		nPassesRecorded = 0;
+		nPassesCulled = 0;
+		for (auto& pass : passes) {
+			if (pass.bCulled) nPassesCulled++;
+			else nPassesRecorded++;
+		}
+		nBarrierBatches = 0;
+		nImageBarriers = 0;
+		nQueueSwitches = 0;
+	}
+	void rest_images(bool bComputeOnly)
+	{
+		for (uint32_t i = 0; i < images.size(); i++) {
+			ImageState& state = images[i];
+			if (state.restingLayout == vk::ImageLayout::eUndefined || state.layout == state.restingLayout) continue;
+			if (bComputeOnly && state.queue != Queue::eCompute) continue;
+			ImageAccess access = { i, state.restingLayout, state.restingStages, {}, false };
+			add_barrier(state, access);
+		}
+	}
+	void add_barrier(ImageState& state, ImageAccess& access)
+	{
+		// the semaphore of the other queue already made its accesses available and visible
+		if (state.queue != currentQueue) {
+			state.writeStages = vk::PipelineStageFlagBits::eAllCommands;
+			state.writeAccess = {};
+			state.readStages = {};
+			state.queue = currentQueue;
+		}
+
+		bool bWrite = is_write(access.access);
+		bool bLayoutChange = state.layout != access.layout;
+
+		// reads of data already visible to these stages need no barrier
+		if (!bWrite && !bLayoutChange && (state.readStages & access.stages) == access.stages) return;
+
+		// reads only wait on the last write, writes and transitions additionally on all reads since
+		vk::PipelineStageFlags srcStages = state.writeStages;
+		if (bWrite || bLayoutChange) srcStages |= state.readStages;
+
+		if (bWrite || bLayoutChange || state.writeAccess) {
+			pendingBarriers.push_back(vk::ImageMemoryBarrier()
+				.setSrcAccessMask(state.writeAccess)
+				.setDstAccessMask(access.access)
+				.setOldLayout(access.bDiscard ? vk::ImageLayout::eUndefined : state.layout)
+				.setNewLayout(access.layout)
+				.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+				.setImage(state.image)
+				.setSubresourceRange(state.range));
+		}
+		pendingSrcStages |= srcStages;
+		pendingDstStages |= access.stages;
+
+		// update tracked state
+		state.layout = access.layout;
+		if (bWrite || bLayoutChange) {
+			// transitions count as writes that are visible to the stages they were made for
+			state.writeStages = access.stages;
+			state.writeAccess = bWrite ? access.access : vk::AccessFlags();
+			state.readStages = bWrite ? vk::PipelineStageFlags() : access.stages;
+		}
+		else {
+			state.readStages |= access.stages;
+		}
+	}
+	void flush_barriers(vk::CommandBuffer& commandBuffer)
+	{
+		if (!pendingSrcStages && !pendingDstStages) return;
+
+		// a single barrier call covering every image the upcoming pass touches
+		if (!pendingSrcStages) pendingSrcStages = vk::PipelineStageFlagBits::eTopOfPipe;
+		if (currentQueue == Queue::eCompute) {
+			// graphics stages (e.g. resting stages) do not exist on the compute queue, all of its commands are a superset
+			constexpr vk::PipelineStageFlags computeStages =
+				vk::PipelineStageFlagBits::eTopOfPipe | vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eComputeShader |
+				vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eBottomOfPipe | vk::PipelineStageFlagBits::eHost |
+				vk::PipelineStageFlagBits::eAllCommands;
+			if (pendingSrcStages & ~computeStages) pendingSrcStages = vk::PipelineStageFlagBits::eAllCommands;
+			if (pendingDstStages & ~computeStages) pendingDstStages = vk::PipelineStageFlagBits::eAllCommands;
+		}
+		commandBuffer.pipelineBarrier(pendingSrcStages, pendingDstStages, {}, {}, {}, pendingBarriers);
+		nBarrierBatches++;
+		nImageBarriers += (uint32_t)pendingBarriers.size();
+
+		pendingBarriers.clear();
+		pendingSrcStages = {};
+		pendingDstStages = {};
+	}
+
+public:
+	static ImageAccess color_write(uint32_t iImage, bool bDiscard = true)
+	{
+		return { iImage, vk::ImageLayout::eColorAttachmentOptimal, vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::AccessFlagBits::eColorAttachmentWrite, bDiscard };
+	}
+	static ImageAccess sampled(uint32_t iImage, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eFragmentShader)
+	{
+		return { iImage, vk::ImageLayout::eShaderReadOnlyOptimal, stages, vk::AccessFlagBits::eShaderRead };
+	}
+	static ImageAccess storage_write(uint32_t iImage, bool bDiscard = true)
+	{
+		return { iImage, vk::ImageLayout::eGeneral, vk::PipelineStageFlagBits::eComputeShader, vk::AccessFlagBits::eShaderWrite, bDiscard };
+	}
+	static ImageAccess input_attachment(uint32_t iImage)
+	{
+		return { iImage, vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eInputAttachmentRead };
+	}
+
+private:
+	std::vector<ImageState> images;
+	uint32_t nPersistentImages = 0;
+	std::vector<Pass> passes;
+	std::set<uint32_t> outputs;
+	Queue currentQueue = Queue::eGraphics; // of the command buffer being recorded
+
+	// barriers collected for the next pass
+	std::vector<vk::ImageMemoryBarrier> pendingBarriers;
+	vk::PipelineStageFlags pendingSrcStages, pendingDstStages;
+
+	// stats of the last execution
+	uint32_t nPassesRecorded = 0, nPassesCulled = 0;
+	uint32_t nBarrierBatches = 0, nImageBarriers = 0;
+	uint32_t nQueueSwitches = 0;
+};
@@ -0,0 +1,399 @@
+#pragma once
+
+#include "utils/thread_pool.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#include <immintrin.h>
+	#define VMI_ESTIMATOR_X86
+	// kernels are compiled for their instruction set individually and only called when the CPU supports it
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		#define VMI_TARGET(isa)
+	#else
+		#define VMI_TARGET(isa) __attribute__((target(isa)))
+	#endif
+#endif
+
+// result of the CPU estimator, laid out like the outputs of the gradients pass
+struct CpuEstimate
+{
+	vk::Extent2D extent; // of the center view
+	std::vector<float4> gradients; // Lx, Ly, Lu, Lv
+	std::vector<float4> disparity; // disparity, certainty, filter index
+};
+
+// disparity of the shader compared to the CPU estimator, pixels without certainty only count for the filter share
+struct CpuDifference
+{
+	float meanAbs = 0.0f, maxAbs = 0.0f;
+	float sameFilterShare = 0.0f;
+	size_t nCompared = 0; // pixels away from the edges
+	size_t nCertain = 0; // of those, the ones with certainty on both sides
+};
+
+// CPU version of lightfield_gradients_cs, for machines without a GPU and as numerical reference of the shader.
+// the 4D filters are separable, so each one runs as weighted sums of rows: across cameras, horizontally and vertically
+class CpuEstimator
+{
+public:
+	enum class Isa { eScalar, eAVX2, eAVX512 };
+	static constexpr float minCertainty = 1e-6f; // below, disparity is not compared
+	static constexpr uint32_t halo = 4; // radius of the largest (9-tap) filter, pixels closer to the edges read past them
+
+private:
+	// pDst[i] = sum of pWeights[r] * ppRows[r][i] over all rows, the one kernel everything runs through
+	typedef void (*WeightedSum)(const float* const* ppRows, const float* pWeights, uint32_t nRows, float* pDst, uint32_t n);
+
+	// per worker, sized for the widest dataset seen so far
+	struct Scratch
+	{
+		std::vector<float> luma; // one row of every view
+		std::vector<float> planes; // camera sums of the tile rows and their halo
+		std::vector<float> filtered; // horizontally filtered planes
+		std::vector<float> sums; // Lx, Ly, Lu, Lv of one row
+	};
+	struct Filter
+	{
+		uint32_t nTaps;
+		std::array<float, 9> p, d; // smoothing and derivative taps
+	};
+
+	static constexpr uint32_t rowsPerJob = 32;
+	static constexpr uint32_t nFilters = 4;
+	static constexpr uint32_t nPlanes = 3; // plain, u derivative, v derivative
+	static constexpr uint32_t nSums = 4; // Lx, Ly, Lu, Lv
+
+	// derivative approximation filters of the shader
+	static constexpr std::array<Filter, nFilters> filters = { {
+		{ 3, {  0.229879f,  0.540242f,  0.229879f }, { -0.425287f,  0.000000f,  0.425287f } },
+		{ 5, {  0.037659f,  0.249153f,  0.426375f,  0.249153f, 0.037659f }, { -0.109604f, -0.276691f,  0.000000f,  0.276691f, 0.109604f } },
+		{ 7, {  0.004711f,  0.069321f,  0.245410f,  0.361117f, 0.245410f, 0.069321f, 0.004711f },
+			 { -0.018708f, -0.125376f, -0.193091f,  0.000000f, 0.193091f, 0.125376f, 0.018708f } },
+		{ 9, {  0.000721f,  0.015486f,  0.090341f,  0.234494f, 0.317916f, 0.234494f, 0.090341f, 0.015486f, 0.000721f },
+			 { -0.003059f, -0.035187f, -0.118739f, -0.143928f, 0.000000f, 0.143928f, 0.118739f, 0.035187f, 0.003059f } }
+	} };
+
+public:
+	// same filters, filter selection and disparity formula as the shader, iFilterMode as in the push constant
+	static CpuEstimate estimate(const LightfieldData& data, uint32_t iFilterMode, ThreadPool& threadPool, Isa isa = get_isa())
+	{
+		CpuEstimate result;
+		result.extent = data.viewExtents[Lightfield::iCenterCamera];
+		if (!data.views[Lightfield::iCenterCamera]) {
+			VMI_ERR("CPU estimation needs the center view");
+			return result;
+		}
+		result.gradients.resize((size_t)result.extent.width * result.extent.height);
+		result.disparity.resize(result.gradients.size());
+
+		WeightedSum weighted_sum = get_weighted_sum(isa);
+		uint32_t iFirstFilter = iFilterMode == 0 ? 0 : iFilterMode - 1;
+		uint32_t iLastFilter = iFilterMode == 0 ? nFilters - 1 : iFilterMode - 1;
+
+		// row tiles are independent, each worker keeps its scratch rows across tiles
+		std::vector<Scratch> scratch(std::max(1u, threadPool.get_thread_count()));
+		uint32_t nJobs = (result.extent.height + rowsPerJob - 1) / rowsPerJob;
+		threadPool.dispatch(nJobs, [&](uint32_t iJob, uint32_t iThread) {
+			uint32_t yBegin = iJob * rowsPerJob;
+			uint32_t yEnd = std::min(yBegin + rowsPerJob, result.extent.height);
+			estimate_rows(data, result, yBegin, yEnd, iFirstFilter, iLastFilter, weighted_sum, scratch[iThread]);
+		});
+		return result;
+	}
+
+	// decodes a dataset, estimates it and writes the disparity, needs neither a window nor a Vulkan device
+	static void run(const std::string& folder, uint32_t iFilterMode, const char* filename)
+	{
+		ThreadPool threadPool;
+		threadPool.init();
+
+		LightfieldData data;
+		threadPool.dispatch(Lightfield::nFiles, [&](uint32_t iFile, uint32_t iThread) { Lightfield::decode_file(folder, iFile, data); });
+
+		auto begin = std::chrono::high_resolution_clock::now();
+		CpuEstimate result = estimate(data, iFilterMode, threadPool);
+		float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+		Lightfield::free_views(data);
+		VMI_LOG("CPU estimation (" << get_isa_name(get_isa()) << ") of " << result.extent.width << "x" << result.extent.height << " took " << ms << " ms");
+
+		if (!result.disparity.empty()) {
+			std::vector<float> disparityOnly(result.disparity.size());
+			for (size_t i = 0; i < disparityOnly.size(); i++) disparityOnly[i] = result.disparity[i].x;
+			Lightfield::write_pfm(filename, disparityOnly.data(), result.extent.width, result.extent.height);
+			VMI_LOG("Wrote CPU disparity to " << filename);
+			Lightfield::log_disparity_error(data.comparison, result.disparity);
+		}
+		threadPool.destroy();
+	}
+
+	// how far the shader's disparity is from the CPU's, gpuExtent may be a crop of the CPU estimate
+	static CpuDifference compare(const CpuEstimate& cpu, const std::vector<float4>& gpu, vk::Extent2D gpuExtent)
+	{
+		// texels past the image edges are read as zero here, but are undefined for the shader
+		uint32_t width = std::min(cpu.extent.width, gpuExtent.width);
+		uint32_t height = std::min(cpu.extent.height, gpuExtent.height);
+		CpuDifference difference;
+		double sum = 0.0;
+		size_t nSameFilter = 0;
+		for (uint32_t y = halo; y + halo < height; y++) {
+			for (uint32_t x = halo; x + halo < width; x++) {
+				const float4& a = cpu.disparity[(size_t)y * cpu.extent.width + x];
+				const float4& b = gpu[(size_t)y * gpuExtent.width + x];
+				if (a.z == b.z) nSameFilter++;
+				difference.nCompared++;
+
+				// disparity is meaningless without certainty, both sides divide by (almost) zero there
+				if (a.y < minCertainty || b.y < minCertainty) continue;
+				float diff = std::abs(a.x - b.x);
+				sum += diff;
+				difference.nCertain++;
+				difference.maxAbs = std::max(difference.maxAbs, diff);
+			}
+		}
+		if (difference.nCertain > 0) difference.meanAbs = (float)(sum / difference.nCertain);
+		if (difference.nCompared > 0) difference.sameFilterShare = (float)nSameFilter / (float)difference.nCompared;
+		return difference;
+	}
+	static void log_difference(const CpuEstimate& cpu, const std::vector<float4>& gpu, vk::Extent2D gpuExtent)
+	{
+		CpuDifference difference = compare(cpu, gpu, gpuExtent);
+		if (difference.nCompared == 0) {
+			VMI_WARN("Nothing to compare between CPU and GPU disparity");
+			return;
+		}
+		VMI_LOG("GPU vs CPU disparity: mean abs difference " << difference.meanAbs << ", max " << difference.maxAbs
+			<< ", same filter chosen for " << 100.0f * difference.sameFilterShare << "% of pixels");
+	}
+
+	static Isa get_isa()
+	{
+		static const Isa isa = detect_isa();
+		return isa;
+	}
+	static const char* get_isa_name(Isa isa)
+	{
+		switch (isa) {
+			case Isa::eAVX512: return "AVX-512";
+			case Isa::eAVX2: return "AVX2";
+			default: return "scalar";
+		}
+	}
+
+private:
+	static void estimate_rows(const LightfieldData& data, CpuEstimate& result, uint32_t yBegin, uint32_t yEnd,
+		uint32_t iFirstFilter, uint32_t iLastFilter, WeightedSum weighted_sum, Scratch& scratch)
+	{
+		uint32_t width = result.extent.width;
+		uint32_t paddedWidth = width + 2 * halo;
+		uint32_t nRows = yEnd - yBegin + 2 * halo;
+		scratch.luma.resize((size_t)Lightfield::nCameras * paddedWidth);
+		scratch.planes.resize((size_t)nPlanes * nRows * paddedWidth);
+		scratch.filtered.resize((size_t)nSums * nRows * width);
+		scratch.sums.resize((size_t)nSums * width);
+		auto plane = [&](uint32_t iPlane, uint32_t iRow) { return &scratch.planes[((size_t)iPlane * nRows + iRow) * paddedWidth]; };
+		auto filtered = [&](uint32_t iSum, uint32_t iRow) { return &scratch.filtered[((size_t)iSum * nRows + iRow) * width]; };
+
+		// luma of every view, weighted across the 3x3 camera grid with the 3-tap filters
+		const auto& camWeights = get_cam_weights();
+		std::array<const float*, Lightfield::nCameras> lumaRows;
+		for (uint32_t iRow = 0; iRow < nRows; iRow++) {
+			int32_t y = (int32_t)(yBegin + iRow) - (int32_t)halo;
+			for (uint32_t iCam = 0; iCam < Lightfield::nCameras; iCam++) {
+				lumaRows[iCam] = &scratch.luma[(size_t)iCam * paddedWidth];
+				load_luma(data, iCam, y, const_cast<float*>(lumaRows[iCam]), paddedWidth);
+			}
+			for (uint32_t iPlane = 0; iPlane < nPlanes; iPlane++) {
+				weighted_sum(lumaRows.data(), camWeights[iPlane].data(), Lightfield::nCameras, plane(iPlane, iRow), paddedWidth);
+			}
+		}
+
+		// which plane and taps each of Lx, Ly, Lu, Lv uses, horizontally and then vertically
+		static constexpr std::array<uint32_t, nSums> sumPlanes = { 0, 0, 1, 2 };
+		static constexpr std::array<bool, nSums> bDerivativeX = { true, false, false, false };
+		static constexpr std::array<bool, nSums> bDerivativeY = { false, true, false, false };
+
+		std::array<const float*, 9> tapRows;
+		for (uint32_t iFilter = iFirstFilter; iFilter <= iLastFilter; iFilter++) {
+			const Filter& filter = filters[iFilter];
+			uint32_t shift = halo - filter.nTaps / 2; // smaller filters skip the outer halo
+
+			for (uint32_t iRow = shift; iRow + shift < nRows; iRow++) {
+				for (uint32_t iSum = 0; iSum < nSums; iSum++) {
+					for (uint32_t t = 0; t < filter.nTaps; t++) tapRows[t] = plane(sumPlanes[iSum], iRow) + shift + t;
+					const float* pTaps = bDerivativeX[iSum] ? filter.d.data() : filter.p.data();
+					weighted_sum(tapRows.data(), pTaps, filter.nTaps, filtered(iSum, iRow), width);
+				}
+			}
+			for (uint32_t y = yBegin; y < yEnd; y++) {
+				uint32_t iRow = y - yBegin + shift;
+				for (uint32_t iSum = 0; iSum < nSums; iSum++) {
+					for (uint32_t t = 0; t < filter.nTaps; t++) tapRows[t] = filtered(iSum, iRow + t);
+					const float* pTaps = bDerivativeY[iSum] ? filter.d.data() : filter.p.data();
+					weighted_sum(tapRows.data(), pTaps, filter.nTaps, &scratch.sums[(size_t)iSum * width], width);
+				}
+				select(scratch.sums.data(), width, iFilter, iFilter == iFirstFilter, &result.gradients[(size_t)y * width], &result.disparity[(size_t)y * width]);
+			}
+		}
+	}
+	// keeps the filter with the highest certainty, the first one wins ties like in the shader
+	static void select(const float* pSums, uint32_t width, uint32_t iFilter, bool bFirst, float4* pGradients, float4* pDisparity)
+	{
+		for (uint32_t x = 0; x < width; x++) {
+			float4 gradients = float4(pSums[x], pSums[width + x], pSums[2 * width + x], pSums[3 * width + x]);
+			float certainty = gradients.x * gradients.x + gradients.y * gradients.y;
+			if (!bFirst && !(pDisparity[x].y < certainty)) continue;
+
+			float disparity = (gradients.x * gradients.z + gradients.y * gradients.w) / certainty;
+			pGradients[x] = gradients;
+			pDisparity[x] = float4(disparity, certainty, (float)iFilter, 0.0f);
+		}
+	}
+	// texels outside of the view are zero
+	static void load_luma(const LightfieldData& data, uint32_t iCam, int32_t y, float* pDst, uint32_t paddedWidth)
+	{
+		std::fill_n(pDst, paddedWidth, 0.0f);
+		const stbi_uc* pView = data.views[iCam];
+		vk::Extent2D viewExtent = data.viewExtents[iCam];
+		if (!pView || y < 0 || y >= (int32_t)viewExtent.height) return;
+
+		// the shader samples an srgb image, which decodes to linear color
+		const auto& toLinear = get_srgb_table();
+		const stbi_uc* pRow = pView + (size_t)y * viewExtent.width * STBI_rgb_alpha;
+		uint32_t nTexels = std::min(paddedWidth - halo, viewExtent.width);
+		for (uint32_t x = 0; x < nTexels; x++) {
+			const stbi_uc* pTexel = pRow + (size_t)x * STBI_rgb_alpha;
+			pDst[halo + x] = 0.299f * toLinear[pTexel[0]] + 0.587f * toLinear[pTexel[1]] + 0.114f * toLinear[pTexel[2]];
+		}
+	}
+
+	static const std::array<float, 256>& get_srgb_table()
+	{
+		static const std::array<float, 256> table = []() {
+			std::array<float, 256> values;
+			for (uint32_t i = 0; i < values.size(); i++) {
+				float c = (float)i / 255.0f;
+				values[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			return values;
+		}();
+		return table;
+	}
+	// plain, u derivative and v derivative weight of every camera, camera index is u * 3 + v
+	static const std::array<std::array<float, Lightfield::nCameras>, nPlanes>& get_cam_weights()
+	{
+		static const std::array<std::array<float, Lightfield::nCameras>, nPlanes> weights = []() {
+			const Filter& tap3 = filters[0];
+			std::array<std::array<float, Lightfield::nCameras>, nPlanes> values;
+			for (uint32_t u = 0; u < 3; u++) {
+				for (uint32_t v = 0; v < 3; v++) {
+					values[0][u * 3 + v] = tap3.p[u] * tap3.p[v];
+					values[1][u * 3 + v] = tap3.d[u] * tap3.p[v];
+					values[2][u * 3 + v] = tap3.p[u] * tap3.d[v];
+				}
+			}
+			return values;
+		}();
+		return weights;
+	}
+
+	static WeightedSum get_weighted_sum(Isa isa)
+	{
+#ifdef VMI_ESTIMATOR_X86
+		if (isa == Isa::eAVX512 && get_isa() == Isa::eAVX512) return weighted_sum_avx512;
+		if (isa != Isa::eScalar && get_isa() != Isa::eScalar) return weighted_sum_avx2;
+#endif
+		return weighted_sum_scalar;
+	}
+	static Isa detect_isa()
+	{
+#ifdef VMI_ESTIMATOR_X86
+	#if defined(_MSC_VER) && !defined(__clang__)
+		int info[4];
+		__cpuid(info, 0);
+		int nIds = info[0];
+		__cpuid(info, 1);
+		bool bFma = info[2] & (1 << 12);
+		bool bOsAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)); // xsave enabled by the os, avx
+		if (!bOsAvx || nIds < 7) return Isa::eScalar;
+
+		// the os has to save the wider registers as well
+		unsigned long long xcr0 = _xgetbv(0);
+		__cpuidex(info, 7, 0);
+		if ((xcr0 & 0xe6) == 0xe6 && (info[1] & (1 << 16))) return Isa::eAVX512;
+		if ((xcr0 & 0x6) == 0x6 && bFma && (info[1] & (1 << 5))) return Isa::eAVX2;
+	#else
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx512f")) return Isa::eAVX512;
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return Isa::eAVX2;
+	#endif
+#endif
+		return Isa::eScalar;
+	}
+
+	static void weighted_sum_scalar(const float* const* ppRows, const float* pWeights, uint32_t nRows, float* pDst, uint32_t n)
+	{
+		for (uint32_t i = 0; i < n; i++) {
+			float sum = 0.0f;
+			for (uint32_t r = 0; r < nRows; r++) sum += pWeights[r] * ppRows[r][i];
+			pDst[i] = sum;
+		}
+	}
+#ifdef VMI_ESTIMATOR_X86
+	// four independent accumulators hide the latency of the fused multiply-adds
+	VMI_TARGET("avx2,fma") static void weighted_sum_avx2(const float* const* ppRows, const float* pWeights, uint32_t nRows, float* pDst, uint32_t n)
+	{
+		uint32_t i = 0;
+		for (; i + 32 <= n; i += 32) {
+			__m256 sum0 = _mm256_setzero_ps(), sum1 = _mm256_setzero_ps(), sum2 = _mm256_setzero_ps(), sum3 = _mm256_setzero_ps();
+			for (uint32_t r = 0; r < nRows; r++) {
+				__m256 weight = _mm256_set1_ps(pWeights[r]);
+				const float* pRow = ppRows[r] + i;
+				sum0 = _mm256_fmadd_ps(weight, _mm256_loadu_ps(pRow), sum0);
+				sum1 = _mm256_fmadd_ps(weight, _mm256_loadu_ps(pRow + 8), sum1);
+				sum2 = _mm256_fmadd_ps(weight, _mm256_loadu_ps(pRow + 16), sum2);
+				sum3 = _mm256_fmadd_ps(weight, _mm256_loadu_ps(pRow + 24), sum3);
+			}
+			_mm256_storeu_ps(pDst + i, sum0);
+			_mm256_storeu_ps(pDst + i + 8, sum1);
+			_mm256_storeu_ps(pDst + i + 16, sum2);
+			_mm256_storeu_ps(pDst + i + 24, sum3);
+		}
+		for (; i + 8 <= n; i += 8) {
+			__m256 sum = _mm256_setzero_ps();
+			for (uint32_t r = 0; r < nRows; r++) sum = _mm256_fmadd_ps(_mm256_set1_ps(pWeights[r]), _mm256_loadu_ps(ppRows[r] + i), sum);
+			_mm256_storeu_ps(pDst + i, sum);
+		}
+		for (; i < n; i++) {
+			float sum = 0.0f;
+			for (uint32_t r = 0; r < nRows; r++) sum += pWeights[r] * ppRows[r][i];
+			pDst[i] = sum;
+		}
+	}
+	// same as avx2 at twice the width, the remainder is handled with a mask instead of scalar code
+	VMI_TARGET("avx512f") static void weighted_sum_avx512(const float* const* ppRows, const float* pWeights, uint32_t nRows, float* pDst, uint32_t n)
+	{
+		uint32_t i = 0;
+		for (; i + 64 <= n; i += 64) {
+			__m512 sum0 = _mm512_setzero_ps(), sum1 = _mm512_setzero_ps(), sum2 = _mm512_setzero_ps(), sum3 = _mm512_setzero_ps();
+			for (uint32_t r = 0; r < nRows; r++) {
+				__m512 weight = _mm512_set1_ps(pWeights[r]);
+				const float* pRow = ppRows[r] + i;
+				sum0 = _mm512_fmadd_ps(weight, _mm512_loadu_ps(pRow), sum0);
+				sum1 = _mm512_fmadd_ps(weight, _mm512_loadu_ps(pRow + 16), sum1);
+				sum2 = _mm512_fmadd_ps(weight, _mm512_loadu_ps(pRow + 32), sum2);
+				sum3 = _mm512_fmadd_ps(weight, _mm512_loadu_ps(pRow + 48), sum3);
+			}
+			_mm512_storeu_ps(pDst + i, sum0);
+			_mm512_storeu_ps(pDst + i + 16, sum1);
+			_mm512_storeu_ps(pDst + i + 32, sum2);
+			_mm512_storeu_ps(pDst + i + 48, sum3);
+		}
+		for (; i < n; i += 16) {
+			__mmask16 mask = n - i >= 16 ? (__mmask16)0xffff : (__mmask16)((1u << (n - i)) - 1u);
+			__m512 sum = _mm512_setzero_ps();
+			for (uint32_t r = 0; r < nRows; r++) sum = _mm512_fmadd_ps(_mm512_set1_ps(pWeights[r]), _mm512_maskz_loadu_ps(mask, ppRows[r] + i), sum);
+			_mm512_mask_storeu_ps(pDst + i, mask, sum);
+		}
+	}
+#endif
+};
@@ -0,0 +1,320 @@
+#pragma once
+
+struct CullPassCreateInfo
+{
+	DeviceWrapper& deviceWrapper;
+	vma::Allocator& allocator;
+	DescriptorAllocator& descAllocator;
+	LayoutCache& layoutCache;
+	UniformArena& uniformArena;
+	uint32_t nFrames;
+};
+
+// layout matches VkDrawIndexedIndirectCommand, so records can be drawn from directly when nothing is culled
+struct DrawRecord
+{
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t firstInstance;
+	uint32_t padding[3];
+	float4 sphere; // bounding sphere, xyz center and w radius
+};
+static_assert(sizeof(DrawRecord) == 48, "DrawRecord has to match lightfield_cull_cs");
+
+// draw records of every entity live in a GPU buffer and are drawn through indirect multi-draws,
+// a compute pass optionally culls them against each view's frustum before the forward pass
+class CullPass
+{
+public:
+	CullPass() = default;
+	~CullPass() = default;
+	ROF_COPY_MOVE_DELETE(CullPass)
+
+public:
+	void init(CullPassCreateInfo& info)
+	{
+		allocator = info.allocator;
+		bMultiDrawIndirect = info.deviceWrapper.bMultiDrawIndirect;
+		frames.resize(info.nFrames);
+
+		create_buffers(info.deviceWrapper);
+		create_desc_sets(info);
+		create_pipeline(info);
+	}
+	void destroy(DeviceWrapper& deviceWrapper, vma::Allocator& allocator)
+	{
+		deviceWrapper.logicalDevice.destroyPipeline(pipeline);
+		deviceWrapper.logicalDevice.destroyShaderModule(cs);
+		allocator.destroyBuffer(recordBuffer, recordAlloc);
+		allocator.destroyBuffer(indirectBuffer, indirectAlloc);
+		frames.clear();
+	}
+
+	// records only change along with the entities, each frame in flight has its own copy to bring up to date
+	void invalidate()
+	{
+		version++;
+	}
+	void update_records(entt::registry& reg, DeviceWrapper& deviceWrapper, uint32_t iFrame)
+	{
+		Frame& frame = frames[iFrame];
+		if (frame.version == version) return;
+
+		// entities not uploaded yet are not drawn
+		auto view = reg.view<components::Geometry, components::Transform>();
+		uint32_t nRequired = 0;
+		view.each([&](auto& geometry, auto& transform) { if (geometry.mesh.nIndices > 0) nRequired++; });
+		if (nRequired > maxDraws) grow(deviceWrapper, nRequired);
+		frame.version = version;
+
+		DrawRecord* pRecords = reinterpret_cast<DrawRecord*>(pMappedRecords + recordRegionSize * iFrame);
+		uint32_t nDraws = 0;
+		view.each([&](auto& geometry, auto& transform) {
+			if (geometry.mesh.nIndices == 0) return;
+			DrawRecord& record = pRecords[nDraws++];
+			record.indexCount = geometry.mesh.nIndices;
+			record.instanceCount = 1;
+			record.firstIndex = geometry.mesh.firstIndex;
+			record.vertexOffset = geometry.mesh.vertexOffset;
+			record.firstInstance = transform.iInstance; // picks the model matrix in the vertex shader
+			record.sphere = geometry.bounds; // model space, the shader moves it along with the instance
+		});
+		frame.nDraws = nDraws;
+		allocator.flushAllocation(recordAlloc, recordRegionSize * iFrame, sizeof(DrawRecord) * nDraws);
+	}
+	// frustum of the unshifted camera, each view then only offsets the bounding spheres
+	void write_uniforms(UniformArena& uniformArena, Camera& camera, const std::array<float4, 9>& camOffsets)
+	{
+		if (!bCulling) return;
+
+		CullData data;
+		data.view = camera.get_view();
+		data.posOffsets = camOffsets;
+
+		// planes from the rows of the projection matrix, depth ranges from 0 to 1
+		float4x4& proj = camera.get_proj();
+		std::array<float4, 4> rows;
+		for (int i = 0; i < 4; i++) rows[i] = float4(proj[0][i], proj[1][i], proj[2][i], proj[3][i]);
+		data.planes = {
+			rows[3] + rows[0], rows[3] - rows[0], // left, right
+			rows[3] + rows[1], rows[3] - rows[1], // bottom, top
+			rows[2], rows[3] - rows[2] // near, far
+		};
+		for (auto& plane : data.planes) plane /= glm::length(float3(plane));
+
+		cullDynamicOffset = uniformArena.push(data);
+	}
+
+	// records the culling dispatch, has to happen outside of the render pass that draws
+	void execute(vk::CommandBuffer& commandBuffer, uint32_t iFrame, InstanceBuffer& instanceBuffer)
+	{
+		Frame& frame = frames[iFrame];
+		if (!bCulling || frame.nDraws == 0) return;
+
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+		std::array<vk::DescriptorSet, 3> descSets = { frame.descSet, cullDescSet, instanceBuffer.get_desc_set() };
+		std::array<uint32_t, 2> dynamicOffsets = { cullDynamicOffset, instanceBuffer.get_dynamic_offset() };
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descSets, dynamicOffsets);
+		commandBuffer.pushConstants<uint32_t>(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, frame.nDraws);
+		commandBuffer.dispatch((frame.nDraws + groupSize - 1) / groupSize, 1, 1);
+
+		vk::BufferMemoryBarrier barrier = vk::BufferMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eIndirectCommandRead)
+			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setBuffer(indirectBuffer)
+			.setOffset(commandRegionSize * iFrame)
+			.setSize(commandRegionSize);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eDrawIndirect, {}, {}, barrier, {});
+	}
+	// draws every entity visible in the given view, iView == nViews draws everything visible in any view (multiview)
+	void draw(vk::CommandBuffer& commandBuffer, uint32_t iFrame, uint32_t iView)
+	{
+		Frame& frame = frames[iFrame];
+		if (frame.nDraws == 0) return;
+
+		vk::Buffer buffer;
+		vk::DeviceSize offset;
+		uint32_t stride;
+		if (bCulling) {
+			buffer = indirectBuffer;
+			offset = commandRegionSize * iFrame + sizeof(vk::DrawIndexedIndirectCommand) * frame.nDraws * iView;
+			stride = sizeof(vk::DrawIndexedIndirectCommand);
+		}
+		else {
+			buffer = recordBuffer;
+			offset = recordRegionSize * iFrame;
+			stride = sizeof(DrawRecord);
+		}
+
+		// without multi-draw support, each draw is issued on its own
+		if (bMultiDrawIndirect) commandBuffer.drawIndexedIndirect(buffer, offset, frame.nDraws, stride);
+		else for (uint32_t i = 0; i < frame.nDraws; i++) commandBuffer.drawIndexedIndirect(buffer, offset + stride * i, 1, stride);
+	}
+
+	uint32_t get_draw_count(uint32_t iFrame)
+	{
+		return frames[iFrame].nDraws;
+	}
+
+private:
+	// rarely happens, so the buffers are simply rebuilt once no frame uses them anymore
+	void grow(DeviceWrapper& deviceWrapper, uint32_t nDraws)
+	{
+		uint32_t newMaxDraws = maxDraws;
+		while (newMaxDraws < nDraws) newMaxDraws *= 2;
+		VMI_WARN("Draw records too small for " << nDraws << " draws, growing to " << newMaxDraws << " draws");
+
+		deviceWrapper.wait_for_submissions();
+		allocator.destroyBuffer(recordBuffer, recordAlloc);
+		allocator.destroyBuffer(indirectBuffer, indirectAlloc);
+		maxDraws = newMaxDraws;
+		create_buffers(deviceWrapper);
+		write_desc_sets(deviceWrapper);
+
+		// the records of every frame were lost along with the buffers
+		for (auto& frame : frames) frame.version = UINT64_MAX;
+	}
+	void create_buffers(DeviceWrapper& deviceWrapper)
+	{
+		vk::DeviceSize alignment = deviceWrapper.deviceProperties.limits.minStorageBufferOffsetAlignment;
+		recordRegionSize = align(sizeof(DrawRecord) * maxDraws, alignment);
+		commandRegionSize = align(sizeof(vk::DrawIndexedIndirectCommand) * maxDraws * (nViews + 1), alignment);
+
+		// records are written by the host whenever entities change
+		vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
+			.setSize(recordRegionSize * frames.size())
+			.setUsage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer);
+		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eAuto)
+			.setFlags(vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
+		vma::AllocationInfo allocInfo;
+		vk::Result result = allocator.createBuffer(&bufferInfo, &allocCreateInfo, &recordBuffer, &recordAlloc, &allocInfo);
+		if (result != vk::Result::eSuccess) VMI_ERR("Draw record buffer creation unsuccessful");
+		allocator.setAllocationName(recordAlloc, std::string("Draw Records").c_str());
+		pMappedRecords = reinterpret_cast<uint8_t*>(allocInfo.pMappedData);
+
+		// culled draws, one list per view followed by one for all views
+		bufferInfo = vk::BufferCreateInfo()
+			.setSize(commandRegionSize * frames.size())
+			.setUsage(vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer);
+		allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eAutoPreferDevice);
+		result = allocator.createBuffer(&bufferInfo, &allocCreateInfo, &indirectBuffer, &indirectAlloc, nullptr);
+		if (result != vk::Result::eSuccess) VMI_ERR("Indirect command buffer creation unsuccessful");
+		allocator.setAllocationName(indirectAlloc, std::string("Indirect Draws").c_str());
+	}
+	void create_desc_sets(CullPassCreateInfo& info)
+	{
+		std::vector<vk::DescriptorSetLayoutBinding> bindings(2);
+		for (uint32_t i = 0; i < bindings.size(); i++) {
+			bindings[i]
+				.setBinding(i)
+				.setDescriptorCount(1)
+				.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+				.setStageFlags(vk::ShaderStageFlagBits::eCompute);
+		}
+		descSetLayout = info.layoutCache.get_desc_set_layout(info.deviceWrapper, bindings);
+
+		// one set per frame in flight, pointing at that frame's regions
+		for (auto& frame : frames) frame.descSet = info.descAllocator.allocate(info.deviceWrapper, descSetLayout);
+		write_desc_sets(info.deviceWrapper);
+
+		// frustum and camera offsets are pushed into the arena each frame
+		vk::DescriptorSetLayout cullLayout = UniformArena::get_desc_set_layout(info.deviceWrapper, info.layoutCache, 0, vk::ShaderStageFlagBits::eCompute);
+		cullDescSet = info.uniformArena.create_desc_set(info.deviceWrapper, info.descAllocator, cullLayout, 0, sizeof(CullData));
+	}
+	void write_desc_sets(DeviceWrapper& deviceWrapper)
+	{
+		for (uint32_t i = 0; i < frames.size(); i++) {
+			std::array<vk::DescriptorBufferInfo, 2> bufferInfos = {
+				vk::DescriptorBufferInfo(recordBuffer, recordRegionSize * i, recordRegionSize),
+				vk::DescriptorBufferInfo(indirectBuffer, commandRegionSize * i, commandRegionSize)
+			};
+			std::array<vk::WriteDescriptorSet, 2> writes;
+			for (uint32_t iBinding = 0; iBinding < writes.size(); iBinding++) {
+				writes[iBinding] = vk::WriteDescriptorSet()
+					.setDstSet(frames[i].descSet)
+					.setDstBinding(iBinding)
+					.setDstArrayElement(0)
+					.setDescriptorType(vk::DescriptorType::eStorageBuffer)
+					.setBufferInfo(bufferInfos[iBinding]);
+			}
+			deviceWrapper.logicalDevice.updateDescriptorSets(writes, {});
+		}
+	}
+	void create_pipeline(CullPassCreateInfo& info)
+	{
+		cs = create_shader_module(info.deviceWrapper, lightfieldCull);
+
+		vk::PushConstantRange pcr(vk::ShaderStageFlagBits::eCompute, 0, sizeof(uint32_t));
+		std::vector<vk::DescriptorSetLayout> layouts = {
+			descSetLayout,
+			UniformArena::get_desc_set_layout(info.deviceWrapper, info.layoutCache, 0, vk::ShaderStageFlagBits::eCompute),
+			InstanceBuffer::get_desc_set_layout(info.deviceWrapper, info.layoutCache)
+		};
+		pipelineLayout = info.layoutCache.get_pipeline_layout(info.deviceWrapper, layouts, { pcr });
+
+		vk::ComputePipelineCreateInfo pipelineInfo = vk::ComputePipelineCreateInfo()
+			.setStage(vk::PipelineShaderStageCreateInfo()
+				.setStage(vk::ShaderStageFlagBits::eCompute)
+				.setModule(cs)
+				.setPName("main"))
+			.setLayout(pipelineLayout);
+
+		auto result = info.deviceWrapper.logicalDevice.createComputePipeline(pipelineCache, pipelineInfo);
+		switch (result.result)
+		{
+			case vk::Result::eSuccess: break;
+			case vk::Result::ePipelineCompileRequiredEXT:
+				VMI_LOG("Compute pipeline creation: PipelineCompileRequiredEXT");
+				break;
+			default: assert(false);
+		}
+		pipeline = result.value;
+	}
+	static vk::DeviceSize align(vk::DeviceSize size, vk::DeviceSize alignment)
+	{
+		return (size + alignment - 1) & ~(alignment - 1);
+	}
+
+public:
+	bool bCulling = true;
+
+private:
+	static constexpr uint32_t nViews = 9;
+	static constexpr uint32_t groupSize = 64; // matches numthreads of lightfield_cull_cs
+	struct CullData
+	{
+		float4x4 view;
+		std::array<float4, nViews> posOffsets;
+		std::array<float4, 6> planes;
+	};
+	struct Frame
+	{
+		vk::DescriptorSet descSet;
+		uint32_t nDraws = 0;
+		uint64_t version = UINT64_MAX; // never matches before the first update
+	};
+
+	vma::Allocator allocator;
+	uint32_t maxDraws = 4096; // grows along with the scene
+	vk::Buffer recordBuffer, indirectBuffer;
+	vma::Allocation recordAlloc, indirectAlloc;
+	uint8_t* pMappedRecords = nullptr;
+	vk::DeviceSize recordRegionSize = 0, commandRegionSize = 0;
+	std::vector<Frame> frames; // regions of both buffers are split by frame in flight
+	uint64_t version = 0;
+
+	vk::ShaderModule cs;
+	vk::Pipeline pipeline;
+	vk::PipelineLayout pipelineLayout;
+	vk::PipelineCache pipelineCache; // TODO
+	vk::DescriptorSetLayout descSetLayout;
+	vk::DescriptorSet cullDescSet;
+	uint32_t cullDynamicOffset = 0;
+	bool bMultiDrawIndirect = false;
+};
@@ -5,8 +5,9 @@ struct DisparityRenderpassCreateInfo
 	DeviceWrapper& deviceWrapper;
 	SwapchainWrapper& swapchainWrapper;
 	vma::Allocator& allocator;
-	vk::DescriptorPool& descPool;
+	LayoutCache& layoutCache;
 	Lightfield& lightfield;
+	vk::RenderPass& renderPass; // subpass 0 of the swapchain write
 };
 
 class DisparityRenderpass
@@ -20,16 +21,14 @@ public:
 	void init(DisparityRenderpassCreateInfo& info)
 	{
 		create_shader_modules(info);
-		create_render_pass(info);
-		create_framebuffer(info);
 
-		descSet = info.lightfield.descSetGradients;
-		descSetLayout = info.lightfield.descSetLayoutDouble;
+		for (auto& frame : info.lightfield.frames) {
+			descSets.push_back(frame.descSetOutputs);
+		}
+		descSetLayout = info.lightfield.descSetLayoutOutputs;
 
 		create_pipeline_layout(info);
 		create_pipeline(info);
-
-		fullscreenRect = vk::Rect2D({ 0, 0 }, info.swapchainWrapper.extent);
 	}
 	void destroy(DeviceWrapper& deviceWrapper)
 	{
@@ -39,33 +38,36 @@ public:
 		device.destroyShaderModule(vs);
 		device.destroyShaderModule(ps);
 
-		// Framebuffer
-		device.destroyFramebuffer(framebuffer);
-
-		// Render Pass
-		deviceWrapper.logicalDevice.destroyRenderPass(renderPass);
-
 		// Stages
-		deviceWrapper.logicalDevice.destroyPipelineLayout(pipelineLayout);
 		deviceWrapper.logicalDevice.destroyPipeline(graphicsPipeline);
+
+		// descriptors are owned by the lightfield
+		descSets.clear();
 	}
 
-	void execute(vk::CommandBuffer& commandBuffer, PC pushConstant)
+	// records into the first subpass of the swapchain write, which has to be begun already
+	void execute(vk::CommandBuffer& commandBuffer, PC pushConstant, uint32_t iFrame)
 	{
-		vk::RenderPassBeginInfo renderPassBeginInfo = vk::RenderPassBeginInfo()
-			.setRenderPass(renderPass)
-			.setFramebuffer(framebuffer)
-			.setRenderArea(fullscreenRect);
-
-		commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
 		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
 
 		// draw fullscreen triangle
 		commandBuffer.pushConstants<PC>(pipelineLayout, vk::ShaderStageFlagBits::eFragment, 0, pushConstant);
-		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descSet, {});
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descSets[iFrame], {});
 		commandBuffer.draw(3, 1, 0, 0);
+	}
 
-		commandBuffer.endRenderPass();
+	// images sampled in the given render mode, mirrors the branches in lightfield_disparity_ps
+	static std::vector<ImageAccess> get_reads(Lightfield& lightfield, uint32_t iFrame, uint32_t iRenderMode)
+	{
+		LightfieldFrame& frame = lightfield.frames[iFrame];
+		switch (iRenderMode) {
+			case 0: return { FrameGraph::sampled(frame.iLightfieldImage) };
+			case 1:
+			case 2: return { FrameGraph::sampled(frame.iGradientsImage) };
+			case 6: return { FrameGraph::sampled(frame.iComparisonImage) };
+			case 7: return { FrameGraph::sampled(frame.iDisparityImage), FrameGraph::sampled(frame.iComparisonImage) };
+			default: return { FrameGraph::sampled(frame.iDisparityImage) };
+		}
 	}
 
 private:
@@ -74,69 +76,10 @@ private:
 		vs = create_shader_module(info.deviceWrapper, lightfieldDisparity.vs);
 		ps = create_shader_module(info.deviceWrapper, lightfieldDisparity.ps);
 	}
-	void create_render_pass(DisparityRenderpassCreateInfo& info)
-	{
-		std::array<vk::AttachmentDescription, 1> attachments = {
-			// Output
-			vk::AttachmentDescription()
-				.setFormat(colorFormat)
-				.setSamples(vk::SampleCountFlagBits::e1)
-				.setLoadOp(vk::AttachmentLoadOp::eDontCare)
-				.setStoreOp(vk::AttachmentStoreOp::eStore)
-				.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
-				.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-				.setInitialLayout(vk::ImageLayout::eUndefined)
-				.setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal)
-		};
-
-		// Subpass Descriptions
-		vk::AttachmentReference output = vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal);
-		vk::SubpassDescription subpass = vk::SubpassDescription()
-			.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
-			.setPDepthStencilAttachment(nullptr)
-			.setColorAttachments(output);
-
-		// Subpass dependency
-		vk::SubpassDependency dependency = vk::SubpassDependency()
-			// src (when/what to wait on)
-			.setSrcSubpass(VK_SUBPASS_EXTERNAL)
-			.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-			.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentRead)
-			// dst (when/what to write to)
-			.setDstSubpass(0)
-			.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-			.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
-
-		vk::RenderPassCreateInfo renderPassInfo = vk::RenderPassCreateInfo()
-			.setAttachments(attachments)
-			.setDependencies(dependency)
-			.setSubpasses(subpass);
-
-		renderPass = info.deviceWrapper.logicalDevice.createRenderPass(renderPassInfo);
-	}
-	void create_framebuffer(DisparityRenderpassCreateInfo& info)
-	{
-		std::array<vk::ImageView, 1> attachments = {
-			info.lightfield.disparityImageView
-		};
-
-		vk::FramebufferCreateInfo framebufferInfo = vk::FramebufferCreateInfo()
-			.setRenderPass(renderPass)
-			.setWidth(info.swapchainWrapper.extent.width)
-			.setHeight(info.swapchainWrapper.extent.height)
-			.setAttachments(attachments)
-			.setLayers(1);
-
-		framebuffer = info.deviceWrapper.logicalDevice.createFramebuffer(framebufferInfo);
-	}
-
 	void create_pipeline_layout(DisparityRenderpassCreateInfo& info)
 	{
 		vk::PushConstantRange pcr(vk::ShaderStageFlagBits::eFragment, 0, sizeof(PC));
-		vk::PipelineLayoutCreateInfo pipelineLayoutInfo = vk::PipelineLayoutCreateInfo()
-			.setSetLayouts(descSetLayout)
-			.setPushConstantRanges(pcr);
-		pipelineLayout = info.deviceWrapper.logicalDevice.createPipelineLayout(pipelineLayoutInfo);
+		pipelineLayout = info.layoutCache.get_pipeline_layout(info.deviceWrapper, { descSetLayout }, { pcr });
 	}
 	void create_pipeline(DisparityRenderpassCreateInfo& info)
 	{
@@ -277,7 +220,7 @@ private:
 			// pipeline layout
 			.setLayout(pipelineLayout)
 			// render pass
-			.setRenderPass(renderPass)
+			.setRenderPass(info.renderPass)
 			.setSubpass(0);
 
 		auto result = info.deviceWrapper.logicalDevice.createGraphicsPipeline(pipelineCache, graphicsPipelineInfo);
@@ -293,9 +236,7 @@ private:
 	}
 
 private:
-	static constexpr vk::Format colorFormat = vk::Format::eR8G8B8A8Srgb;
 	static constexpr uint32_t nCams = 9;
-	vk::RenderPass renderPass;
 
 	// subpasses
 	vk::Pipeline graphicsPipeline;
@@ -304,14 +245,8 @@ private:
 
 	// descriptor
 	vk::DescriptorSetLayout descSetLayout;
-	vk::DescriptorSet descSet;
+	std::vector<vk::DescriptorSet> descSets; // one per lightfield frame
 
 	// shaders for the subpasses
 	vk::ShaderModule vs, ps;
-
-	// render resources
-	vk::Framebuffer framebuffer;
-
-	// misc
-	vk::Rect2D fullscreenRect;
 };
\ No newline at end of file
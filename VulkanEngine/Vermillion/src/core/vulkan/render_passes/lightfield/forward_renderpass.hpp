@@ -5,8 +5,10 @@ struct ForwardRenderpassCreateInfo
 	DeviceWrapper& deviceWrapper;
 	SwapchainWrapper& swapchainWrapper;
 	vma::Allocator& allocator;
-	vk::DescriptorPool& descPool;
+	DescriptorAllocator& descAllocator;
+	LayoutCache& layoutCache;
 	Lightfield& lightfield;
+	UniformArena& uniformArena;
 };
 
 class ForwardRenderpass
@@ -19,10 +21,16 @@ public:
 public:
 	void init(ForwardRenderpassCreateInfo& info)
 	{
+		bMultiview = info.deviceWrapper.bMultiview;
+		bDynamicRendering = info.deviceWrapper.bDynamicRendering;
 		create_offset_buffers(info);
 		create_shader_modules(info);
-		create_render_pass(info);
-		create_framebuffers(info);
+		create_depth_image(info);
+		create_targets(info);
+		if (!bDynamicRendering) {
+			create_render_pass(info);
+			create_framebuffers(info);
+		}
 
 		create_pipeline_layout(info);
 		create_pipeline(info);
@@ -41,72 +49,153 @@ public:
 		deviceWrapper.logicalDevice.destroyRenderPass(renderPass);
 		for (size_t i = 0; i < framebuffers.size(); i++) {
 			deviceWrapper.logicalDevice.destroyFramebuffer(framebuffers[i]);
-			camOffsetBuffers[i].destroy(deviceWrapper, allocator);
 		}
+		framebuffers.clear();
+		targets.clear();
+
+		// Depth
+		device.destroyImageView(depthArrayView);
+		for (size_t i = 0; i < depthSingleImageViews.size(); i++) {
+			device.destroyImageView(depthSingleImageViews[i]);
+		}
+		depthSingleImageViews.clear();
+		allocator.destroyImage(depthImage, depthAlloc);
 
 		// Stages
-		deviceWrapper.logicalDevice.destroyPipelineLayout(pipelineLayout);
 		deviceWrapper.logicalDevice.destroyPipeline(pipeline);
-
-
 	}
 	void update_cam_offsets(float offset = 0.01f)
 	{
-		float d = offset;
-		float z = 0.0f;
-		std::array<float2, nCams> offsets = {
-			float2(d,  d),
-			float2(d,  z),
-			float2(d, -d),
-
-			float2(z,  d),
-			float2(z,  z),
-			float2(z, -d),
-
-			float2(-d,  d),
-			float2(-d,  z),
-			float2(-d, -d),
-		};
+		write_cam_offsets(offset);
+	}
+	// pushes the offsets for this frame, before any view gets recorded and after the camera was updated
+	void write_uniforms(UniformArena& uniformArena, Camera& camera)
+	{
+		// disparity in pixels per unit of depth between neighbouring views: focal length (px) * baseline
+		float focalLength = camera.get_proj()[0][0] * 0.5f * (float)fullscreenRect.extent.width;
+		offsetData.disparityScale = float4(focalLength * camOffset, 0.0f, 0.0f, 0.0f);
+		camOffsetsDynamicOffset = uniformArena.push(offsetData);
+	}
+	const std::array<float4, 9>& get_cam_offsets()
+	{
+		return offsetData.posOffsets;
+	}
+	// all views are written by a single render pass instance, iCam is only relevant without multiview
+	inline bool is_multiview()
+	{
+		return bMultiview;
+	}
 
-		for (auto i = 0; i < nCams; i++) {
-			camOffsetBuffers[i].data = float4(offsets[i].x, offsets[i].y, 0.0f, 0.0f);
-			camOffsetBuffers[i].write_buffer();
+	// with secondary contents, draws are recorded via begin_secondary() and executed within this render pass,
+	// iFrame picks the lightfield frame that is written
+	void begin(vk::CommandBuffer& commandBuffer, uint32_t iFrame, uint32_t iCam = 0, vk::SubpassContents contents = vk::SubpassContents::eInline)
+	{
+		if (bDynamicRendering) begin_rendering(commandBuffer, iFrame, iCam, contents);
+		else {
+			vk::RenderPassBeginInfo renderPassBeginInfo = vk::RenderPassBeginInfo()
+				.setRenderPass(renderPass)
+				.setFramebuffer(framebuffers[get_target_index(iFrame, iCam)])
+				.setRenderArea(fullscreenRect)
+				.setClearValues(clearValues);
+			commandBuffer.beginRenderPass(renderPassBeginInfo, contents);
+		}
+		if (contents == vk::SubpassContents::eInline) {
+			commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
 		}
 	}
-
-	void begin(vk::CommandBuffer& commandBuffer, uint32_t iCam)
+	// starts a secondary command buffer that continues the render pass of the given camera
+	void begin_secondary(vk::CommandBuffer& commandBuffer, uint32_t iFrame, uint32_t iCam)
 	{
-		vk::RenderPassBeginInfo renderPassBeginInfo = vk::RenderPassBeginInfo()
+		// without a render pass, the secondary only learns about the attachment formats
+		vk::CommandBufferInheritanceRenderingInfoKHR renderingInheritanceInfo = vk::CommandBufferInheritanceRenderingInfoKHR()
+			.setViewMask(bMultiview ? viewMask : 0)
+			.setColorAttachmentFormats(colorFormats)
+			.setDepthAttachmentFormat(depthFormat)
+			.setRasterizationSamples(vk::SampleCountFlagBits::e1);
+		vk::CommandBufferInheritanceInfo inheritanceInfo = vk::CommandBufferInheritanceInfo()
 			.setRenderPass(renderPass)
-			.setFramebuffer(framebuffers[iCam])
-			.setRenderArea(fullscreenRect)
-			.setClearValues(clearValues);
-
-		commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+			.setSubpass(0)
+			.setFramebuffer(bDynamicRendering ? nullptr : framebuffers[get_target_index(iFrame, iCam)])
+			.setPNext(bDynamicRendering ? &renderingInheritanceInfo : nullptr);
+		vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+			.setPInheritanceInfo(&inheritanceInfo);
+
+		commandBuffer.begin(beginInfo);
 		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
 	}
 	void end(vk::CommandBuffer& commandBuffer)
 	{
-		commandBuffer.endRenderPass();
+		if (bDynamicRendering) commandBuffer.endRenderingKHR();
+		else commandBuffer.endRenderPass();
 	}
-	void bind_desc_sets(vk::CommandBuffer& commandBuffer, vk::DescriptorSet& camDescSet, uint32_t iLightfieldCam)
+	void bind_desc_sets(vk::CommandBuffer& commandBuffer, Camera& camera, InstanceBuffer& instanceBuffer, uint32_t iLightfieldCam = 0)
 	{
-		auto& offsetDescSet = camOffsetBuffers[iLightfieldCam].get_desc_set();
-		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, { camDescSet, offsetDescSet }, {});
+		std::array<vk::DescriptorSet, 3> descSets = { camera.get_desc_set(), camOffsetDescSet, instanceBuffer.get_desc_set() };
+		std::array<uint32_t, 3> dynamicOffsets = { camera.get_dynamic_offset(), camOffsetsDynamicOffset, instanceBuffer.get_dynamic_offset() };
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, descSets, dynamicOffsets);
+
+		// without multiview, the shader picks its offset using the pushed view index
+		if (!bMultiview) commandBuffer.pushConstants<uint32_t>(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, iLightfieldCam);
 	}
 
 private:
+	inline uint32_t get_target_index(uint32_t iFrame, uint32_t iCam)
+	{
+		return bMultiview ? iFrame : iFrame * nCams + iCam;
+	}
+	void begin_rendering(vk::CommandBuffer& commandBuffer, uint32_t iFrame, uint32_t iCam, vk::SubpassContents contents)
+	{
+		// depth is not tracked by the frame graph, the previous writes are waited on and their contents discarded
+		vk::ImageMemoryBarrier depthBarrier = vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+			.setOldLayout(vk::ImageLayout::eUndefined)
+			.setNewLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+			.setImage(depthImage)
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, bMultiview ? 0 : iCam, bMultiview ? nCams : 1));
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eLateFragmentTests, vk::PipelineStageFlagBits::eEarlyFragmentTests, {}, {}, {}, depthBarrier);
+
+		// same load and store ops as the render pass path
+		std::array<vk::ImageView, 3>& target = targets[get_target_index(iFrame, iCam)];
+		std::array<vk::RenderingAttachmentInfoKHR, 2> colorAttachments;
+		for (uint32_t i = 0; i < colorAttachments.size(); i++) {
+			colorAttachments[i] = vk::RenderingAttachmentInfoKHR()
+				.setImageView(target[i])
+				.setImageLayout(vk::ImageLayout::eColorAttachmentOptimal)
+				.setLoadOp(vk::AttachmentLoadOp::eClear)
+				.setStoreOp(vk::AttachmentStoreOp::eStore)
+				.setClearValue(clearValues[i]);
+		}
+		vk::RenderingAttachmentInfoKHR depthAttachment = vk::RenderingAttachmentInfoKHR()
+			.setImageView(target[2])
+			.setImageLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
+			.setLoadOp(vk::AttachmentLoadOp::eClear)
+			.setStoreOp(vk::AttachmentStoreOp::eDontCare)
+			.setClearValue(clearValues[2]);
+
+		vk::RenderingInfoKHR renderingInfo = vk::RenderingInfoKHR()
+			.setFlags(contents == vk::SubpassContents::eSecondaryCommandBuffers ? vk::RenderingFlagBitsKHR::eContentsSecondaryCommandBuffers : vk::RenderingFlagsKHR())
+			.setRenderArea(fullscreenRect)
+			.setLayerCount(1)
+			.setViewMask(bMultiview ? viewMask : 0)
+			.setColorAttachments(colorAttachments)
+			.setPDepthAttachment(&depthAttachment);
+		commandBuffer.beginRenderingKHR(renderingInfo);
+	}
+
 	void create_offset_buffers(ForwardRenderpassCreateInfo& info)
 	{
-		BufferInfo bufferInfo = { 
-			info.deviceWrapper, 
-			info.allocator, 
-			info.descPool, 
-			vk::ShaderStageFlagBits::eVertex, 
-			iOffsetBindSlot
-		};
+		// offsets are pushed into the arena every frame, so changing them never touches data earlier frames still read
+		vk::DescriptorSetLayout layout = UniformArena::get_desc_set_layout(info.deviceWrapper, info.layoutCache, iOffsetBindSlot, offsetStages);
+		camOffsetDescSet = info.uniformArena.create_desc_set(info.deviceWrapper, info.descAllocator, layout, iOffsetBindSlot, sizeof(OffsetData));
 
-		float d = 0.01f;
+		write_cam_offsets(0.01f);
+	}
+	void write_cam_offsets(float offset)
+	{
+		camOffset = offset;
+		float d = offset;
 		float z = 0.0f;
 		std::array<float2, nCams> offsets = {
 			float2(d,  d),
@@ -123,19 +212,51 @@ private:
 		};
 
 		for (auto i = 0; i < nCams; i++) {
-			camOffsetBuffers[i].data = float4(offsets[i].x, offsets[i].y, 0.0f, 0.0f);
-			camOffsetBuffers[i].init(bufferInfo);
-			camOffsetBuffers[i].write_buffer();
+			offsetData.posOffsets[i] = float4(offsets[i].x, offsets[i].y, 0.0f, 0.0f);
 		}
 	}
 	void create_shader_modules(ForwardRenderpassCreateInfo& info)
 	{
-		vs = create_shader_module(info.deviceWrapper, lightfieldWrite.vs);
-		ps = create_shader_module(info.deviceWrapper, lightfieldWrite.ps);
+		const ShaderPack& shaders = bMultiview ? lightfieldWriteMultiview : lightfieldWrite;
+		vs = create_shader_module(info.deviceWrapper, shaders.vs);
+		ps = create_shader_module(info.deviceWrapper, shaders.ps);
+	}
+	void create_depth_image(ForwardRenderpassCreateInfo& info)
+	{
+		// one layer per camera, multiview requires every attachment to cover all views
+		vk::ImageCreateInfo imageCreateInfo = vk::ImageCreateInfo()
+			.setImageType(vk::ImageType::e2D)
+			.setExtent(vk::Extent3D(info.swapchainWrapper.extent, 1))
+			.setMipLevels(1).setArrayLayers(nCams)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setUsage(vk::ImageUsageFlagBits::eDepthStencilAttachment)
+			.setFormat(depthFormat);
+		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eAutoPreferDevice);
+
+		vk::Result result = info.allocator.createImage(&imageCreateInfo, &allocCreateInfo, &depthImage, &depthAlloc, nullptr);
+		if (result != vk::Result::eSuccess) VMI_ERR("Lightfield depth image creation unsuccessful");
+		info.allocator.setAllocationName(depthAlloc, std::string("Lightfield Depth").c_str());
+
+		vk::ImageViewCreateInfo imageViewInfo = vk::ImageViewCreateInfo()
+			.setViewType(vk::ImageViewType::e2DArray)
+			.setFormat(depthFormat)
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eDepth, 0, 1, 0, nCams))
+			.setImage(depthImage);
+		depthArrayView = info.deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+
+		imageViewInfo.setViewType(vk::ImageViewType::e2D);
+		imageViewInfo.subresourceRange.layerCount = 1;
+		depthSingleImageViews.resize(nCams);
+		for (auto i = 0u; i < nCams; i++) {
+			imageViewInfo.subresourceRange.baseArrayLayer = i;
+			depthSingleImageViews[i] = info.deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+		}
 	}
 	void create_render_pass(ForwardRenderpassCreateInfo& info)
 	{
-		std::array<vk::AttachmentDescription, 1> attachments = {
+		std::array<vk::AttachmentDescription, 3> attachments = {
 			// Output
 			vk::AttachmentDescription()
 				.setFormat(colorFormat)
@@ -144,49 +265,86 @@ private:
 				.setStoreOp(vk::AttachmentStoreOp::eStore)
 				.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 				.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+				.setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
+				.setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal),
+			// Ground truth disparity
+			vk::AttachmentDescription()
+				.setFormat(Lightfield::comparisonFormat)
+				.setSamples(vk::SampleCountFlagBits::e1)
+				.setLoadOp(vk::AttachmentLoadOp::eClear)
+				.setStoreOp(vk::AttachmentStoreOp::eStore)
+				.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+				.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
+				.setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
+				.setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal),
+			// Depth, only needed while the pass runs
+			vk::AttachmentDescription()
+				.setFormat(depthFormat)
+				.setSamples(vk::SampleCountFlagBits::e1)
+				.setLoadOp(vk::AttachmentLoadOp::eClear)
+				.setStoreOp(vk::AttachmentStoreOp::eDontCare)
+				.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
+				.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
 				.setInitialLayout(vk::ImageLayout::eUndefined)
-				.setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal)
+				.setFinalLayout(vk::ImageLayout::eDepthStencilAttachmentOptimal)
 		};
 
 		// Subpass Descriptions
-		vk::AttachmentReference output = vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal);
+		std::array<vk::AttachmentReference, 2> outputs = {
+			vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal),
+			vk::AttachmentReference(1, vk::ImageLayout::eColorAttachmentOptimal)
+		};
+		vk::AttachmentReference depth = vk::AttachmentReference(2, vk::ImageLayout::eDepthStencilAttachmentOptimal);
 		vk::SubpassDescription subpass = vk::SubpassDescription()
 			.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
-			.setPDepthStencilAttachment(nullptr)
-			.setInputAttachments({}).setColorAttachments(output);
-
-		// Subpass dependency
-		vk::SubpassDependency dependency = vk::SubpassDependency()
-			.setDependencyFlags(vk::DependencyFlagBits::eByRegion)
-			// src (when/what to wait on)
-			.setSrcSubpass(VK_SUBPASS_EXTERNAL)
-			.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-			.setSrcAccessMask(vk::AccessFlagBits::eNoneKHR)
-			// dst (when/what to write to)
-			.setDstSubpass(0)
-			.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-			.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
-
+			.setPDepthStencilAttachment(&depth)
+			.setInputAttachments({}).setColorAttachments(outputs);
+
+		// depth is not tracked by the frame graph, so the previous instance's writes are waited on here
+		vk::SubpassDependency depthDependency = vk::SubpassDependency()
+			.setSrcSubpass(VK_SUBPASS_EXTERNAL).setDstSubpass(0)
+			.setSrcStageMask(vk::PipelineStageFlagBits::eLateFragmentTests)
+			.setDstStageMask(vk::PipelineStageFlagBits::eEarlyFragmentTests)
+			.setSrcAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite);
+
+		// broadcast the subpass to every layer of the lightfield array, the views are spatially close
+		vk::RenderPassMultiviewCreateInfo multiviewInfo = vk::RenderPassMultiviewCreateInfo()
+			.setViewMasks(viewMask)
+			.setCorrelationMasks(viewMask);
+
+		// synchronisation and layout transitions of the color attachments are handled by the frame graph
 		vk::RenderPassCreateInfo renderPassInfo = vk::RenderPassCreateInfo()
 			.setAttachments(attachments)
-			.setDependencies(dependency)
-			.setSubpasses(subpass);
+			.setSubpasses(subpass)
+			.setDependencies(depthDependency)
+			.setPNext(bMultiview ? &multiviewInfo : nullptr);
 
 		renderPass = info.deviceWrapper.logicalDevice.createRenderPass(renderPassInfo);
 	}
+	void create_targets(ForwardRenderpassCreateInfo& info)
+	{
+		// multiview writes all layers through the array views, otherwise each camera gets its own target,
+		// either way there is a set per lightfield frame while the depth buffer is shared
+		for (auto& frame : info.lightfield.frames) {
+			if (bMultiview) {
+				targets.push_back({ frame.lightfieldImageView, frame.comparisonArrayView, depthArrayView });
+				continue;
+			}
+			for (auto i = 0u; i < nCams; i++) {
+				targets.push_back({ frame.lightfieldSingleImageViews[i], frame.comparisonSingleImageViews[i], depthSingleImageViews[i] });
+			}
+		}
+	}
 	void create_framebuffers(ForwardRenderpassCreateInfo& info)
 	{
-		auto& lightfieldViews = info.lightfield.lightfieldSingleImageViews;
-		framebuffers.resize(lightfieldViews.size());
-		for (auto i = 0u; i < lightfieldViews.size(); i++) {
-
-			std::array<vk::ImageView, 1> attachments = { lightfieldViews[i]};
-
+		framebuffers.resize(targets.size());
+		for (auto i = 0u; i < targets.size(); i++) {
 			vk::FramebufferCreateInfo framebufferInfo = vk::FramebufferCreateInfo()
 				.setRenderPass(renderPass)
 				.setWidth(info.swapchainWrapper.extent.width)
 				.setHeight(info.swapchainWrapper.extent.height)
-				.setAttachments(attachments)
+				.setAttachments(targets[i])
 				.setLayers(1);
 
 			framebuffers[i] = info.deviceWrapper.logicalDevice.createFramebuffer(framebufferInfo);
@@ -195,17 +353,15 @@ private:
 
 	void create_pipeline_layout(ForwardRenderpassCreateInfo& info)
 	{
-		std::array<vk::DescriptorSetLayout, 2> layouts = {
-			Camera::get_temp_desc_set_layout(info.deviceWrapper),
-			UniformBufferDynamic<float4>::get_temp_desc_set_layout(info.deviceWrapper, iOffsetBindSlot, vk::ShaderStageFlagBits::eVertex),
+		std::vector<vk::DescriptorSetLayout> layouts = {
+			Camera::get_desc_set_layout(info.deviceWrapper, info.layoutCache),
+			UniformArena::get_desc_set_layout(info.deviceWrapper, info.layoutCache, iOffsetBindSlot, offsetStages),
+			InstanceBuffer::get_desc_set_layout(info.deviceWrapper, info.layoutCache)
 		};
 
-		vk::PipelineLayoutCreateInfo pipelineLayoutInfo = vk::PipelineLayoutCreateInfo()
-			.setSetLayouts(layouts);
-		pipelineLayout = info.deviceWrapper.logicalDevice.createPipelineLayout(pipelineLayoutInfo);
-
-		info.deviceWrapper.logicalDevice.destroyDescriptorSetLayout(layouts[0]);
-		info.deviceWrapper.logicalDevice.destroyDescriptorSetLayout(layouts[1]);
+		std::vector<vk::PushConstantRange> pcrs;
+		if (!bMultiview) pcrs.emplace_back(vk::ShaderStageFlagBits::eVertex, 0, (uint32_t)sizeof(uint32_t));
+		pipelineLayout = info.layoutCache.get_pipeline_layout(info.deviceWrapper, layouts, pcrs);
 	}
 	void create_pipeline(ForwardRenderpassCreateInfo& info)
 	{
@@ -292,11 +448,11 @@ private:
 		}
 
 		// Color Blending
-		vk::PipelineColorBlendAttachmentState colorBlendAttachment;
+		std::array<vk::PipelineColorBlendAttachmentState, 2> colorBlendAttachments;
 		vk::PipelineColorBlendStateCreateInfo colorBlendInfo;
 		{
 			// final output image
-			colorBlendAttachment = vk::PipelineColorBlendAttachmentState()
+			colorBlendAttachments[0] = vk::PipelineColorBlendAttachmentState()
 				.setColorWriteMask(
 					vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
 					vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA) // theoretically no need to write transparency
@@ -310,10 +466,14 @@ private:
 				.setDstAlphaBlendFactor(vk::BlendFactor::eZero)
 				.setAlphaBlendOp(vk::BlendOp::eAdd);
 
+			// ground truth disparity, single channel
+			colorBlendAttachments[1] = colorBlendAttachments[0];
+			colorBlendAttachments[1].setColorWriteMask(vk::ColorComponentFlagBits::eR);
+
 			// -> global
 			colorBlendInfo = vk::PipelineColorBlendStateCreateInfo()
 				.setLogicOpEnable(VK_FALSE).setLogicOp(vk::LogicOp::eCopy)
-				.setAttachments(colorBlendAttachment)
+				.setAttachments(colorBlendAttachments)
 				.setBlendConstants({ 0.0f, 0.0f, 0.0f, 0.0f });
 		}
 
@@ -321,9 +481,9 @@ private:
 		vk::PipelineDepthStencilStateCreateInfo depthStencilInfo;
 		{
 			depthStencilInfo = vk::PipelineDepthStencilStateCreateInfo()
-				.setDepthTestEnable(VK_FALSE)
-				.setDepthWriteEnable(VK_FALSE)
-				.setDepthCompareOp(vk::CompareOp::eLessOrEqual)
+				.setDepthTestEnable(VK_TRUE)
+				.setDepthWriteEnable(VK_TRUE)
+				.setDepthCompareOp(vk::CompareOp::eLess)
 				// Depth bounds
 				.setDepthBoundsTestEnable(VK_FALSE)
 				.setMinDepthBounds(0.0f).setMaxDepthBounds(1.0f)
@@ -331,8 +491,15 @@ private:
 				.setStencilTestEnable(VK_FALSE);
 		}
 
+		// without a render pass, the attachments are only described by their formats
+		vk::PipelineRenderingCreateInfoKHR renderingInfo = vk::PipelineRenderingCreateInfoKHR()
+			.setViewMask(bMultiview ? viewMask : 0)
+			.setColorAttachmentFormats(colorFormats)
+			.setDepthAttachmentFormat(depthFormat);
+
 		// Finally, create actual render pipeline
 		vk::GraphicsPipelineCreateInfo graphicsPipelineInfo = vk::GraphicsPipelineCreateInfo()
+			.setPNext(bDynamicRendering ? &renderingInfo : nullptr)
 			.setStageCount((uint32_t)shaderStages.size())
 			.setPStages(shaderStages.data())
 			// fixed-function stages
@@ -366,7 +533,9 @@ private:
 	{
 		fullscreenRect = vk::Rect2D({ 0, 0 }, info.swapchainWrapper.extent);
 		clearValues = {
-			vk::ClearValue(vk::ClearColorValue().setFloat32({ 0.0f, 0.0f, 0.0f, 0.0f }))
+			vk::ClearValue(vk::ClearColorValue().setFloat32({ 0.0f, 0.0f, 0.0f, 0.0f })),
+			vk::ClearValue(vk::ClearColorValue().setFloat32({ 0.0f, 0.0f, 0.0f, 0.0f })),
+			vk::ClearValue(vk::ClearDepthStencilValue().setDepth(1.0f).setStencil(0))
 		};
 	}
 
@@ -374,6 +543,15 @@ private:
 	static constexpr vk::Format colorFormat = vk::Format::eR8G8B8A8Srgb;
 	static constexpr uint32_t nCams = 9;
 	static constexpr uint32_t iOffsetBindSlot = 2;
+	static constexpr vk::Format depthFormat = vk::Format::eD32Sfloat;
+	static constexpr std::array<vk::Format, 2> colorFormats = { colorFormat, Lightfield::comparisonFormat };
+	static constexpr uint32_t viewMask = (1u << nCams) - 1u;
+	static constexpr vk::ShaderStageFlags offsetStages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+	struct OffsetData
+	{
+		std::array<float4, nCams> posOffsets; // float4 elements keep the std140 array stride
+		float4 disparityScale; // x: focal length (px) * cam offset
+	};
 	vk::RenderPass renderPass;
 
 	// subpasses
@@ -385,10 +563,20 @@ private:
 	vk::ShaderModule vs, ps;
 
 	// render resources
-	std::vector<vk::Framebuffer> framebuffers;
-	std::array<UniformBufferDynamic<float4>, nCams> camOffsetBuffers;
+	std::vector<std::array<vk::ImageView, 3>> targets; // color, ground truth and depth of each framebuffer, grouped by lightfield frame
+	std::vector<vk::Framebuffer> framebuffers; // only without dynamic rendering
+	vma::Allocation depthAlloc;
+	vk::Image depthImage;
+	vk::ImageView depthArrayView;
+	std::vector<vk::ImageView> depthSingleImageViews;
+	OffsetData offsetData;
+	float camOffset = 0.01f;
+	vk::DescriptorSet camOffsetDescSet;
+	uint32_t camOffsetsDynamicOffset = 0;
+	bool bMultiview = false;
+	bool bDynamicRendering = false;
 
 	// misc
 	vk::Rect2D fullscreenRect;
-	std::array<vk::ClearValue, 1> clearValues;
+	std::array<vk::ClearValue, 3> clearValues;
 };
\ No newline at end of file
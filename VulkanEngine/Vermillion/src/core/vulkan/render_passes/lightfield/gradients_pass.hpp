@@ -0,0 +1,87 @@
+#pragma once
+
+struct GradientsPassCreateInfo
+{
+	DeviceWrapper& deviceWrapper;
+	LayoutCache& layoutCache;
+	Lightfield& lightfield;
+};
+
+// estimates gradients and disparity of a lightfield frame in a compute dispatch,
+// which runs on the async compute queue when the device has one
+class GradientsPass
+{
+public:
+	GradientsPass() = default;
+	~GradientsPass() = default;
+	ROF_COPY_MOVE_DELETE(GradientsPass)
+
+public:
+	void init(GradientsPassCreateInfo& info)
+	{
+		for (auto& frame : info.lightfield.frames) {
+			descSets.push_back(frame.descSetGradients);
+		}
+		extent = info.lightfield.extent;
+
+		create_pipeline(info);
+	}
+	void destroy(DeviceWrapper& deviceWrapper)
+	{
+		deviceWrapper.logicalDevice.destroyPipeline(pipeline);
+		deviceWrapper.logicalDevice.destroyShaderModule(cs);
+
+		// descriptors are owned by the lightfield
+		descSets.clear();
+	}
+
+	void execute(vk::CommandBuffer& commandBuffer, PC pushConstant, uint32_t iFrame)
+	{
+		dispatch(commandBuffer, pushConstant, descSets[iFrame], extent);
+	}
+	// any set of the lightfield's gradients layout, e.g. one pointing at tiles of a larger lightfield
+	void dispatch(vk::CommandBuffer& commandBuffer, PC pushConstant, vk::DescriptorSet descSet, vk::Extent2D dispatchExtent)
+	{
+		commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descSet, {});
+		commandBuffer.pushConstants<PC>(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, pushConstant);
+		commandBuffer.dispatch((dispatchExtent.width + groupSize - 1) / groupSize, (dispatchExtent.height + groupSize - 1) / groupSize, 1);
+	}
+
+private:
+	void create_pipeline(GradientsPassCreateInfo& info)
+	{
+		cs = create_shader_module(info.deviceWrapper, lightfieldGradients);
+
+		vk::PushConstantRange pcr(vk::ShaderStageFlagBits::eCompute, 0, sizeof(PC));
+		pipelineLayout = info.layoutCache.get_pipeline_layout(info.deviceWrapper, { info.lightfield.descSetLayoutGradients }, { pcr });
+
+		vk::ComputePipelineCreateInfo pipelineInfo = vk::ComputePipelineCreateInfo()
+			.setStage(vk::PipelineShaderStageCreateInfo()
+				.setStage(vk::ShaderStageFlagBits::eCompute)
+				.setModule(cs)
+				.setPName("main"))
+			.setLayout(pipelineLayout);
+
+		auto result = info.deviceWrapper.logicalDevice.createComputePipeline(pipelineCache, pipelineInfo);
+		switch (result.result)
+		{
+			case vk::Result::eSuccess: break;
+			case vk::Result::ePipelineCompileRequiredEXT:
+				VMI_LOG("Compute pipeline creation: PipelineCompileRequiredEXT");
+				break;
+			default: assert(false);
+		}
+		pipeline = result.value;
+	}
+
+private:
+	static constexpr uint32_t groupSize = 8; // matches numthreads of lightfield_gradients_cs in both dimensions
+
+	vk::ShaderModule cs;
+	vk::Pipeline pipeline;
+	vk::PipelineLayout pipelineLayout;
+	vk::PipelineCache pipelineCache; // TODO
+	std::vector<vk::DescriptorSet> descSets; // one per lightfield frame
+	vk::Extent2D extent;
+};
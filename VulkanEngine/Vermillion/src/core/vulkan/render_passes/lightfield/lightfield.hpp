@@ -5,11 +5,39 @@
 struct LightfieldCreateInfo
 {
 	DeviceWrapper& deviceWrapper;
-	SwapchainWrapper& swapchainWrapper;
+	vk::Extent2D extent; // of every image, the swapchain's when rendering
 	vma::Allocator& allocator;
-	vk::DescriptorPool& descPool;
-	vk::CommandPool& commandPool;
+	DescriptorAllocator& descAllocator;
+	LayoutCache& layoutCache;
 	std::string srcFolder;
+	uint32_t nFrames;
+	bool bPerFrameViews; // simulated views are rendered anew each frame, loaded ones are shared by all frames
+};
+// dataset files decoded on the CPU and waiting for upload, views as rgba8 and the ground truth disparity as floats
+struct LightfieldData
+{
+	std::array<stbi_uc*, 9> views = {};
+	std::array<vk::Extent2D, 9> viewExtents;
+	std::vector<float> comparison;
+	vk::Extent2D comparisonExtent;
+};
+// captured views along with everything estimated from them,
+// with async compute the next frame renders into another set while depth is still estimated for this one
+struct LightfieldFrame
+{
+	// views (simulated or loaded) and the ground truth disparity of each
+	vma::Allocation lightfieldAlloc, comparisonAlloc;
+	vk::Image lightfieldImage, comparisonImage;
+	vk::ImageView lightfieldImageView, comparisonImageView, comparisonArrayView;
+	std::vector<vk::ImageView> lightfieldSingleImageViews, comparisonSingleImageViews; // one view for each cam to render into
+
+	// estimated from the views, bound to the lightfield's shared estimates allocation
+	vk::Image gradientsImage, disparityImage;
+	vk::ImageView gradientsImageView, disparityImageView;
+	vk::DescriptorSet descSetGradients, descSetOutputs;
+
+	// frame graph handles
+	uint32_t iLightfieldImage, iComparisonImage, iGradientsImage, iDisparityImage;
 };
 class Lightfield
 {
@@ -21,696 +49,635 @@ public:
 public:
 	void init(LightfieldCreateInfo& info)
 	{
-		create_images(info.allocator, info.swapchainWrapper);
+		// the dataset is loaded separately, so it can be decoded while other passes are built
+		srcFolderCache = info.srcFolder;
+		frames.resize(info.nFrames);
+		nViewSets = info.bPerFrameViews ? info.nFrames : 1;
+		create_images(info.deviceWrapper, info.allocator, info.extent);
 		create_image_views(info.deviceWrapper);
-		load_images(info.deviceWrapper, info.allocator, info.commandPool, info.srcFolder);
-		create_desc_set_layout(info.deviceWrapper);
-		create_desc_set(info.deviceWrapper, info.descPool);
+		create_desc_set_layout(info.deviceWrapper, info.layoutCache);
+		create_desc_set(info.deviceWrapper, info.descAllocator, info.layoutCache);
 	}
 	void destroy(DeviceWrapper& deviceWrapper, vma::Allocator& allocator)
 	{
-		allocator.destroyImage(lightfieldImage, lightfieldAlloc);
-		allocator.destroyImage(gradientsImage, gradientsAlloc);
-		allocator.destroyImage(disparityImage, disparityAlloc);
-		allocator.destroyImage(comparisonImage, comparisonAlloc);
-
-		deviceWrapper.logicalDevice.destroyImageView(lightfieldImageView);
-		deviceWrapper.logicalDevice.destroyImageView(gradientsImageView);
-		deviceWrapper.logicalDevice.destroyImageView(disparityImageView);
-		deviceWrapper.logicalDevice.destroyImageView(comparisonImageView);
-		deviceWrapper.logicalDevice.destroySampler(samplerLightfields);
-		deviceWrapper.logicalDevice.destroySampler(samplerGradients);
-
-		for (auto i = 0u; i < nCameras; i++) {
-			deviceWrapper.logicalDevice.destroyImageView(lightfieldSingleImageViews[i]);
+		for (size_t i = 0; i < frames.size(); i++) {
+			LightfieldFrame& frame = frames[i];
+			deviceWrapper.logicalDevice.destroyImage(frame.gradientsImage);
+			deviceWrapper.logicalDevice.destroyImage(frame.disparityImage);
+			deviceWrapper.logicalDevice.destroyImageView(frame.gradientsImageView);
+			deviceWrapper.logicalDevice.destroyImageView(frame.disparityImageView);
+
+			// shared views belong to the first frame
+			if (i >= nViewSets) continue;
+			allocator.destroyImage(frame.lightfieldImage, frame.lightfieldAlloc);
+			allocator.destroyImage(frame.comparisonImage, frame.comparisonAlloc);
+			deviceWrapper.logicalDevice.destroyImageView(frame.lightfieldImageView);
+			deviceWrapper.logicalDevice.destroyImageView(frame.comparisonImageView);
+			deviceWrapper.logicalDevice.destroyImageView(frame.comparisonArrayView);
+			for (auto iCam = 0u; iCam < nCameras; iCam++) {
+				deviceWrapper.logicalDevice.destroyImageView(frame.lightfieldSingleImageViews[iCam]);
+				deviceWrapper.logicalDevice.destroyImageView(frame.comparisonSingleImageViews[iCam]);
+			}
 		}
-
-		deviceWrapper.logicalDevice.destroyDescriptorSetLayout(descSetLayoutSingle);
-		deviceWrapper.logicalDevice.destroyDescriptorSetLayout(descSetLayoutDouble);
+		allocator.freeMemory(estimatesAlloc);
+		frames.clear();
 	}
-	void load_images(DeviceWrapper& deviceWrapper, vma::Allocator& allocator, vk::CommandPool& commandPool, std::string srcFolder = "")
+	// CPU only and independent of other files, the views come first and the ground truth last
+	void decode_file(uint32_t iFile, LightfieldData& data)
 	{
-		if (srcFolder == "") srcFolder = srcFolderCache;
-		else srcFolderCache = srcFolder;
-		
-		std::string folder;
-		load_image_data(folder.assign(srcFolder).append("input_Cam039.png").c_str(), 0, deviceWrapper, allocator, commandPool);
-		load_image_data(folder.assign(srcFolder).append("input_Cam048.png").c_str(), 1, deviceWrapper, allocator, commandPool);
-		load_image_data(folder.assign(srcFolder).append("input_Cam057.png").c_str(), 2, deviceWrapper, allocator, commandPool);
-		load_image_data(folder.assign(srcFolder).append("input_Cam040.png").c_str(), 3, deviceWrapper, allocator, commandPool);
-		load_image_data(folder.assign(srcFolder).append("input_Cam049.png").c_str(), 4, deviceWrapper, allocator, commandPool);
-		load_image_data(folder.assign(srcFolder).append("input_Cam058.png").c_str(), 5, deviceWrapper, allocator, commandPool);
-		load_image_data(folder.assign(srcFolder).append("input_Cam041.png").c_str(), 6, deviceWrapper, allocator, commandPool);
-		load_image_data(folder.assign(srcFolder).append("input_Cam050.png").c_str(), 7, deviceWrapper, allocator, commandPool);
-		load_image_data(folder.assign(srcFolder).append("input_Cam059.png").c_str(), 8, deviceWrapper, allocator, commandPool);
-
-		load_comparison_image_data(folder.assign(srcFolder).append("gt_disp_lowres.pfm").c_str(), deviceWrapper, allocator, commandPool);
-		//load_comparison_image_data(folder.assign(srcFolder).append("gt_depth_lowres.pfm").c_str(), deviceWrapper, allocator, commandPool);
+		decode_file(srcFolderCache, iFile, data);
 	}
-	void layout_transition_lightfields(vk::CommandBuffer& commandBuffer, vk::ImageLayout from, vk::ImageLayout to)
+	// same, for any dataset folder and without a device
+	static void decode_file(const std::string& folder, uint32_t iFile, LightfieldData& data)
 	{
-		// change all 9 images
-		for (int i = 0; i < 9; i++) {
-			vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
-				.setOldLayout(from)
-				.setNewLayout(to)
-				.setImage(lightfieldImage)
-				.setSubresourceRange(vk::ImageSubresourceRange()
-					.setAspectMask(vk::ImageAspectFlagBits::eColor)
-					.setBaseArrayLayer(i).setLayerCount(1)
-					.setBaseMipLevel(0).setLevelCount(1));
-			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+		if (iFile == nCameras) {
+			decode_comparison(std::string(folder).append("gt_disp_lowres.pfm"), data);
+			//decode_comparison(std::string(folder).append("gt_depth_lowres.pfm"), data);
+			return;
+		}
+
+		int x, y, n;
+		std::string filename = std::string(folder).append(camFiles[iFile]);
+		stbi_uc* img = stbi_load(filename.c_str(), &x, &y, &n, STBI_rgb_alpha);
+		if (!img) {
+			VMI_ERR("Error on img load: Camera " << iFile << " with path: " << filename);
+			img = stbi_load(std::string("lightfields/training/cotton/").append(camFiles[iFile]).c_str(), &x, &y, &n, STBI_rgb_alpha);
 		}
+		data.views[iFile] = img;
+		data.viewExtents[iFile] = vk::Extent2D((uint32_t)x, (uint32_t)y);
 	}
-	void layout_transition_gradients(vk::CommandBuffer& commandBuffer, vk::ImageLayout from, vk::ImageLayout to)
+	// for decoded files that are not uploaded
+	static void free_views(LightfieldData& data)
 	{
-		vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
-			.setOldLayout(from)
-			.setNewLayout(to)
-			.setImage(gradientsImage)
-			.setSubresourceRange(vk::ImageSubresourceRange()
-				.setAspectMask(vk::ImageAspectFlagBits::eColor)
-				.setBaseArrayLayer(0).setLayerCount(1)
-				.setBaseMipLevel(0).setLevelCount(1));
-		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+		for (auto& view : data.views) {
+			if (view) stbi_image_free(view);
+			view = nullptr;
+		}
 	}
-
-	void save_pfm(const char* filename, DeviceWrapper& deviceWrapper, vma::Allocator& allocator, vk::CommandPool& commandPool)
+	// uploads decoded files into every set of views and frees their CPU copies, except for the ground truth kept for comparisons
+	void upload(DeviceWrapper& deviceWrapper, StagingRing& stagingRing, vk::CommandPool& commandPool, LightfieldData& data)
 	{
-		int x = 512, y = 512;
-		uint size = x * y * sizeof(float);
-		// staging buffer
-		vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
-			.setSize(size)
-			.setUsage(vk::BufferUsageFlagBits::eTransferDst);
-		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
-			.setUsage(vma::MemoryUsage::eAuto)
-			.setFlags(vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
-		vma::AllocationInfo allocInfo;
-		auto stagingBuffer = allocator.createBuffer(bufferInfo, allocCreateInfo, allocInfo);
+		// every file shares one staging allocation and one submission
+		vk::DeviceSize stagingSize = data.comparison.size() * sizeof(float);
+		for (uint32_t i = 0; i < nCameras; i++) {
+			if (data.views[i]) stagingSize += (vk::DeviceSize)data.viewExtents[i].width * data.viewExtents[i].height * STBI_rgb_alpha;
+		}
+		StagingAllocation staging = stagingRing.allocate(deviceWrapper, std::max(stagingSize, (vk::DeviceSize)sizeof(float)));
+
+		vk::DeviceSize stagingOffset = 0;
+		auto stage = [&](const void* pData, vk::Extent2D srcExtent, vk::DeviceSize texelSize, uint32_t iLayer) {
+			vk::DeviceSize size = (vk::DeviceSize)srcExtent.width * srcExtent.height * texelSize;
+			StagingAllocation region = { staging.buffer, staging.offset + stagingOffset, size, staging.pMapped + stagingOffset };
+			stagingRing.write(region, pData, size);
+			stagingOffset += size;
+
+			// files of another resolution than the images are cropped
+			return vk::BufferImageCopy()
+				.setBufferOffset(region.offset)
+				.setBufferRowLength(srcExtent.width)
+				.setBufferImageHeight(srcExtent.height)
+				.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, iLayer, 1))
+				.setImageOffset({ 0, 0, 0 })
+				.setImageExtent(vk::Extent3D(std::min(srcExtent.width, extent.width), std::min(srcExtent.height, extent.height), 1));
+		};
+		std::vector<vk::BufferImageCopy> viewRegions, comparisonRegions;
+		for (uint32_t i = 0; i < nCameras; i++) {
+			if (!data.views[i]) continue;
+			viewRegions.push_back(stage(data.views[i], data.viewExtents[i], STBI_rgb_alpha, i));
+			stbi_image_free(data.views[i]);
+			data.views[i] = nullptr;
+		}
+		if (!data.comparison.empty()) comparisonRegions.push_back(stage(data.comparison.data(), data.comparisonExtent, sizeof(float), iCenterCamera));
+		comparisonImageData = std::move(data.comparison);
+
+		vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+			.setLevel(vk::CommandBufferLevel::ePrimary)
+			.setCommandPool(commandPool)
+			.setCommandBufferCount(1);
+
+		vk::CommandBuffer commandBuffer;
+		auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&allocInfo, &commandBuffer);
+
+		// begin recording to temporary command buffer
+		vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		commandBuffer.begin(beginInfo);
+
+		// all layers of both images end up in read only layout, including those without a file
+		vk::ImageSubresourceRange arrayRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, nCameras);
+		std::vector<vk::ImageMemoryBarrier> barriers;
+		for (uint32_t i = 0; i < nViewSets; i++) {
+			for (vk::Image image : { frames[i].lightfieldImage, frames[i].comparisonImage }) {
+				barriers.push_back(vk::ImageMemoryBarrier()
+					.setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+					.setOldLayout(vk::ImageLayout::eUndefined)
+					.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+					.setImage(image)
+					.setSubresourceRange(arrayRange));
+			}
+		}
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barriers);
 
-		// copy image to staging buffer
-		{
-			vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
-				.setLevel(vk::CommandBufferLevel::ePrimary)
-				.setCommandPool(commandPool)
-				.setCommandBufferCount(1);
-
-			vk::CommandBuffer commandBuffer;
-			auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&allocInfo, &commandBuffer);
-
-			// begin recording to temporary command buffer
-			vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
-				.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-			commandBuffer.begin(beginInfo);
-
-			// TODO: describe subresource here, need to select each image in lightfield array individually
-			vk::BufferImageCopy region = vk::BufferImageCopy()
-				// buffer
-				.setBufferRowLength(512)
-				.setBufferImageHeight(512)
-				.setBufferOffset(0)
-				// img
-				.setImageExtent(vk::Extent3D(512, 512, 1))
-				.setImageOffset(0)
-				.setImageSubresource(vk::ImageSubresourceLayers()
-					.setAspectMask(vk::ImageAspectFlagBits::eColor)
-					.setBaseArrayLayer(0)
-					.setLayerCount(1)
-					.setMipLevel(0));
-
-			vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
-				.setOldLayout(vk::ImageLayout::eUndefined)
-				.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
-				.setImage(comparisonImage)
-				.setSubresourceRange(vk::ImageSubresourceRange()
-					.setAspectMask(vk::ImageAspectFlagBits::eColor)
-					.setBaseArrayLayer(0)
-					.setLayerCount(1)
-					.setBaseMipLevel(0)
-					.setLevelCount(1));
-			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-			commandBuffer.copyImageToBuffer(comparisonImage, vk::ImageLayout::eTransferSrcOptimal, stagingBuffer.first, region);
-			barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-			barrier.newLayout = vk::ImageLayout::eReadOnlyOptimal;
-			//barrier.newLayout = vk::ImageLayout::eColorAttachmentOptimal;
-			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-			commandBuffer.end();
-
-			vk::SubmitInfo submitInfo = vk::SubmitInfo()
-				.setCommandBufferCount(1)
-				.setPCommandBuffers(&commandBuffer);
-			deviceWrapper.queue.submit(submitInfo);
-			deviceWrapper.queue.waitIdle(); // TODO: change this to wait on a fence instead (upon queue submit) so multiple memory transfers would be possible
-
-			// free command buffer directly after use
-			deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, commandBuffer);
+		// each set copies from the same staged files
+		for (uint32_t i = 0; i < nViewSets; i++) {
+			if (!viewRegions.empty()) commandBuffer.copyBufferToImage(staging.buffer, frames[i].lightfieldImage, vk::ImageLayout::eTransferDstOptimal, viewRegions);
+			if (!comparisonRegions.empty()) commandBuffer.copyBufferToImage(staging.buffer, frames[i].comparisonImage, vk::ImageLayout::eTransferDstOptimal, comparisonRegions);
 		}
 
-		std::ofstream myfile(filename, std::ios::binary);
-		char header[] = { 0x50, 0x66, 0x0A, 0x35, 0x31, 0x32, 0x20, 0x35, 0x31, 0x32, 0x0A, 0x2D, 0x31, 0x0A }; // lazy header
-		myfile.write(header, std::size(header));
+		for (auto& barrier : barriers) {
+			barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+			barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+			barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+			barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		}
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, barriers);
+		commandBuffer.end();
+
+		vk::SubmitInfo submitInfo = vk::SubmitInfo()
+			.setCommandBufferCount(1)
+			.setPCommandBuffers(&commandBuffer);
+		uint64_t timelineValue = deviceWrapper.submit(submitInfo);
+		stagingRing.track(timelineValue);
+		deviceWrapper.wait_for(timelineValue);
+
+		// free command buffer directly after use
+		deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, commandBuffer);
+	}
+	// hand all images over to the frame graph, which tracks their layouts from here on
+	void register_images(FrameGraph& frameGraph)
+	{
+		vk::ImageSubresourceRange range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+		vk::ImageSubresourceRange arrayRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, nCameras);
+		vk::ImageLayout readOnly = vk::ImageLayout::eShaderReadOnlyOptimal;
+		vk::PipelineStageFlags fragment = vk::PipelineStageFlagBits::eFragmentShader;
+
+		// sampled images always rest in read only layout, as the final pass descriptors reference all of them
+		for (size_t i = 0; i < frames.size(); i++) {
+			LightfieldFrame& frame = frames[i];
+			if (i < nViewSets) {
+				frame.iLightfieldImage = frameGraph.import_image("Lightfield Array", frame.lightfieldImage, arrayRange, readOnly, readOnly, fragment);
+				frame.iComparisonImage = frameGraph.import_image("Comparison", frame.comparisonImage, arrayRange, readOnly, readOnly, fragment);
+			}
+			else {
+				frame.iLightfieldImage = frames[0].iLightfieldImage;
+				frame.iComparisonImage = frames[0].iComparisonImage;
+			}
+			frame.iGradientsImage = frameGraph.import_image("Gradients", frame.gradientsImage, range, vk::ImageLayout::eUndefined, readOnly, fragment);
+			frame.iDisparityImage = frameGraph.import_image("Disparity Map", frame.disparityImage, range, vk::ImageLayout::eUndefined, readOnly, fragment);
+		}
+	}
 
+	// writes the center layer of the comparison image, e.g. the simulated ground truth, in the layout of the dataset files
+	void save_pfm(const char* filename, DeviceWrapper& deviceWrapper, StagingRing& stagingRing, vk::CommandPool& commandPool, uint32_t iFrame)
+	{
+		uint32_t x = extent.width, y = extent.height;
+		std::vector<float> readback(x * y);
+		read_image(deviceWrapper, stagingRing, commandPool, frames[iFrame].comparisonImage, iCenterCamera, readback.data(), sizeof(float));
+		write_pfm(filename, readback.data(), x, y);
+	}
+	// greyscale pfm, negative scale marks little endian
+	static void write_pfm(const char* filename, const float* pData, uint32_t x, uint32_t y)
+	{
+		std::ofstream myfile(filename, std::ios::binary);
+		std::string header = std::string("Pf\n").append(std::to_string(x)).append(" ").append(std::to_string(y)).append("\n-1\n");
+		myfile.write(header.data(), header.size());
 
-		comparisonImageData.resize(x * y);
 		// mirror in y axis
-		float* curWrite = comparisonImageData.data();
-		float* curRead = reinterpret_cast<float*>(allocInfo.pMappedData);
+		std::vector<float> mirrored((size_t)x * y);
+		for (uint32_t j = 0; j < y; j++) {
+			memcpy(&mirrored[(size_t)j * x], &pData[(size_t)(y - 1 - j) * x], x * sizeof(float));
+		}
+		myfile.write(reinterpret_cast<char*>(mirrored.data()), mirrored.size() * sizeof(float));
+	}
+	// counterpart of write_pfm, returns false when the file is missing or no greyscale pfm
+	static bool read_pfm(const char* filename, std::vector<float>& data, vk::Extent2D& pfmExtent)
+	{
+		// rows are stored bottom to top
+		std::ifstream file(filename, std::ios::binary);
+		std::string format;
+		int x = 0, y = 0;
+		float scale = 0.0f;
+		file >> format >> x >> y >> scale;
+		file.get(); // single whitespace ends the header
+		if (!file || format != "Pf" || x <= 0 || y <= 0) return false;
+
+		std::vector<float> rows((size_t)x * y);
+		file.read(reinterpret_cast<char*>(rows.data()), rows.size() * sizeof(float));
+		data.resize(rows.size());
 		for (int j = 0; j < y; j++) {
-			int yIndex = (x * y - y - j * y);
-			for (int i = 0; i < x; i++) {
-				curWrite[i + j * y] = curRead[i + yIndex];
-			}
+			std::copy_n(rows.data() + (size_t)(y - 1 - j) * x, x, data.data() + (size_t)j * x);
 		}
-
-		myfile.write(reinterpret_cast<char*>(comparisonImageData.data()), comparisonImageData.size() * sizeof(float));
-
-		// clean up
-		allocator.destroyBuffer(stagingBuffer.first, stagingBuffer.second);
-
+		pfmExtent = vk::Extent2D((uint32_t)x, (uint32_t)y);
+		return true;
 	}
-	void compare_disparity(DeviceWrapper& deviceWrapper, vma::Allocator& allocator, vk::CommandPool& commandPool)
+	// logs how far the frame's disparity is from the ground truth, which the forward pass renders itself when simulating
+	void compare_disparity(DeviceWrapper& deviceWrapper, StagingRing& stagingRing, vk::CommandPool& commandPool, uint32_t iFrame, bool bSimulated)
 	{
-		std::vector<float> approxImagData(512*512);
+		std::vector<float4> approxImagData;
+		read_disparity(deviceWrapper, stagingRing, commandPool, iFrame, approxImagData);
+		if (bSimulated) {
+			comparisonImageData.resize(approxImagData.size());
+			read_image(deviceWrapper, stagingRing, commandPool, frames[iFrame].comparisonImage, iCenterCamera, comparisonImageData.data(), sizeof(float));
+		}
 
-		{
-			// staging buffer
-			vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
-				.setSize(512 * 512 * 4)
-				.setUsage(vk::BufferUsageFlagBits::eTransferDst);
-			vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
-				.setUsage(vma::MemoryUsage::eAuto)
-				.setFlags(vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
-			vma::AllocationInfo allocInfo;
-			auto stagingBuffer = allocator.createBuffer(bufferInfo, allocCreateInfo, allocInfo);
-
-			vk::CommandBufferAllocateInfo buffAllocInfo = vk::CommandBufferAllocateInfo()
-				.setLevel(vk::CommandBufferLevel::ePrimary)
-				.setCommandPool(commandPool)
-				.setCommandBufferCount(1);
-
-			vk::CommandBuffer commandBuffer;
-			auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&buffAllocInfo, &commandBuffer);
-
-			// begin recording to temporary command buffer
-			vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
-				.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-			commandBuffer.begin(beginInfo);
-
-			vk::ImageSubresourceLayers subres = vk::ImageSubresourceLayers()
-				.setMipLevel(0)
-				.setBaseArrayLayer(0)
-				.setLayerCount(1)
-				.setAspectMask(vk::ImageAspectFlagBits::eColor);
-
-			vk::BufferImageCopy imgCopyBuffer = vk::BufferImageCopy()
-				.setBufferImageHeight(512)
-				.setBufferRowLength(512)
-				.setBufferOffset(0)
-				.setImageExtent(vk::Extent3D(512, 512, 1))
-				.setImageOffset(0)
-				.setImageSubresource(subres);
-
-			vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
-				.setOldLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-				.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
-				.setImage(disparityImage)
-				.setSubresourceRange(vk::ImageSubresourceRange()
-					.setAspectMask(vk::ImageAspectFlagBits::eColor)
-					.setBaseArrayLayer(0)
-					.setLayerCount(1)
-					.setBaseMipLevel(0)
-					.setLevelCount(1));
-
-			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-			commandBuffer.copyImageToBuffer(disparityImage, vk::ImageLayout::eTransferSrcOptimal, stagingBuffer.first, imgCopyBuffer);
-			barrier.setOldLayout(vk::ImageLayout::eTransferSrcOptimal);
-			barrier.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
-			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-			commandBuffer.end();
-
-			vk::SubmitInfo submitInfo = vk::SubmitInfo()
-				.setCommandBufferCount(1)
-				.setPCommandBuffers(&commandBuffer);
-			deviceWrapper.queue.submit(submitInfo);
-			deviceWrapper.queue.waitIdle(); // TODO: change this to wait on a fence instead (upon queue submit) so multiple memory transfers would be possible
-
-			// free command buffer directly after use
-			deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, commandBuffer);
-
-			memcpy(approxImagData.data(), allocInfo.pMappedData, approxImagData.size() * 4);
-			allocator.destroyBuffer(stagingBuffer.first, stagingBuffer.second);
+		log_disparity_error(comparisonImageData, approxImagData);
+	}
+	// disparity image holds disparity, confidence and filter index per pixel
+	void read_disparity(DeviceWrapper& deviceWrapper, StagingRing& stagingRing, vk::CommandPool& commandPool, uint32_t iFrame, std::vector<float4>& disparity)
+	{
+		disparity.resize(extent.width * extent.height);
+		read_image(deviceWrapper, stagingRing, commandPool, frames[iFrame].disparityImage, 0, disparity.data(), sizeof(float4));
+	}
+	// estimates hold disparity, confidence and filter index per pixel, like the disparity image
+	static void log_disparity_error(const std::vector<float>& groundTruth, const std::vector<float4>& estimate)
+	{
+		// comparison data is only available for loaded datasets of the same resolution
+		if (groundTruth.size() != estimate.size()) {
+			VMI_WARN("No ground truth disparity available for comparison");
+			return;
 		}
 
-		float sum = 0.0f;
-		for (int i = 0; i < 512 * 512; i++) {
-			struct ColStr{
-				uint8_t r, g, b, a;
-			};
-			ColStr col = *reinterpret_cast<ColStr*>(&approxImagData[i]);
-			float magn = (float)col.r / 255.0f;
-			sum += magn;
+		// mean squared error and the share of pixels off by more than 0.07 (BadPix, as in the HCI benchmark)
+		double sum = 0.0;
+		size_t nBadPixels = 0;
+		for (size_t i = 0; i < estimate.size(); i++) {
+			float diff = groundTruth[i] - estimate[i].x;
+			sum += diff * diff;
+			if (std::abs(diff) > 0.07f) nBadPixels++;
 		}
-		sum /= 512 * 512;
-		VMI_LOG("MSE compared to ground truth disparity: " << sum);
+		sum /= (double)estimate.size();
+		VMI_LOG("MSE compared to ground truth disparity: " << sum << ", BadPix(0.07): " << 100.0 * nBadPixels / estimate.size() << "%");
 		// TODO: show min, max!
 	}
 
 private:
-	void create_images(vma::Allocator& allocator, SwapchainWrapper& swapchainWrapper)
+	void create_images(DeviceWrapper& deviceWrapper, vma::Allocator& allocator, vk::Extent2D imageExtent)
 	{
+		extent = imageExtent;
 		vk::ImageCreateInfo imageCreateInfo = vk::ImageCreateInfo()
 			.setImageType(vk::ImageType::e2D)
-			.setExtent(vk::Extent3D(swapchainWrapper.extent, 1))
+			.setExtent(vk::Extent3D(extent, 1))
 			//
-			.setMipLevels(1).setArrayLayers(nCameras)
+			.setMipLevels(1)
 			.setSamples(vk::SampleCountFlagBits::e1)
-			.setTiling(vk::ImageTiling::eOptimal)
-			.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst)
-			.setFormat(colorFormat);
+			.setTiling(vk::ImageTiling::eOptimal);
 
-		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
-			.setUsage(vma::MemoryUsage::eAutoPreferDevice)
-			.setFlags(vma::AllocationCreateFlagBits::eDedicatedMemory);
-
-		// color
-		vk::Result result = allocator.createImage(&imageCreateInfo, &allocCreateInfo, &lightfieldImage, &lightfieldAlloc, nullptr);
-		if (result != vk::Result::eSuccess) VMI_ERR("Lightfield image creation unsuccessful");
-		allocator.setAllocationName(lightfieldAlloc, std::string("Lightfield Array").c_str());
-
-		// gradients
-		imageCreateInfo.setArrayLayers(1);
-		imageCreateInfo.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled);
-		result = allocator.createImage(&imageCreateInfo, &allocCreateInfo, &gradientsImage, &gradientsAlloc, nullptr);
-		if (result != vk::Result::eSuccess) VMI_ERR("Gradients image creation unsuccessful");
-		allocator.setAllocationName(gradientsAlloc, std::string("Gradients").c_str());
-
-		// comparison
-		imageCreateInfo.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc);
-		imageCreateInfo.setFormat(vk::Format::eR32Sfloat);
-		result = allocator.createImage(&imageCreateInfo, &allocCreateInfo, &comparisonImage, &comparisonAlloc, nullptr);
-		if (result != vk::Result::eSuccess) VMI_ERR("Gradients image creation unsuccessful");
-		allocator.setAllocationName(comparisonAlloc, std::string("Comparison").c_str());
-
-		// disparity
-		imageCreateInfo.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment | vk::ImageUsageFlagBits::eTransferSrc);
-		imageCreateInfo.setFormat(colorFormat);
-		result = allocator.createImage(&imageCreateInfo, &allocCreateInfo, &disparityImage, &disparityAlloc, nullptr);
-		if (result != vk::Result::eSuccess) VMI_ERR("Disparity image creation unsuccessful");
-		allocator.setAllocationName(disparityAlloc, std::string("Disparity Map").c_str());
-	}
-	void create_image_views(DeviceWrapper& deviceWrapper)
-	{
-		vk::ImageSubresourceRange subresourceRange = vk::ImageSubresourceRange()
-			.setAspectMask(vk::ImageAspectFlagBits::eColor)
-			.setBaseMipLevel(0).setLevelCount(1)
-			.setBaseArrayLayer(0).setLayerCount(nCameras);
+		// images the compute queue touches are shared by both families, which spares ownership transfers
+		std::array<uint32_t, 2> queueFamilies = { deviceWrapper.iQueue, deviceWrapper.iComputeQueue };
+		vk::ImageCreateInfo sharedCreateInfo = imageCreateInfo;
+		if (deviceWrapper.bAsyncCompute) sharedCreateInfo.setSharingMode(vk::SharingMode::eConcurrent).setQueueFamilyIndices(queueFamilies);
 
-		vk::ImageViewCreateInfo imageViewInfo = vk::ImageViewCreateInfo()
-			.setPNext(nullptr)
-			.setViewType(vk::ImageViewType::e2DArray)
-			.setFormat(colorFormat)
-			.setSubresourceRange(subresourceRange)
-			.setImage(lightfieldImage);
-
-		// colors view
-		lightfieldImageView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
-
-		// single image view for writing each image individually
-		imageViewInfo.subresourceRange.layerCount = 1;
-		imageViewInfo.setViewType(vk::ImageViewType::e2D);
-		lightfieldSingleImageViews.resize(nCameras);
-		for (auto i = 0u; i < nCameras; i++) {
-			imageViewInfo.subresourceRange.baseArrayLayer = i;
-			lightfieldSingleImageViews[i] = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
-		}
+		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eAutoPreferDevice);
+
+		for (size_t i = 0; i < frames.size(); i++) {
+			LightfieldFrame& frame = frames[i];
+			std::string suffix = std::string(" ").append(std::to_string(i));
+			// loaded views never change, so every frame samples the first one's
+			if (i >= nViewSets) {
+				frame.lightfieldImage = frames[0].lightfieldImage;
+				frame.comparisonImage = frames[0].comparisonImage;
+			}
+			else {
+				// color
+				sharedCreateInfo.setArrayLayers(nCameras);
+				sharedCreateInfo.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst);
+				sharedCreateInfo.setFormat(colorFormat);
+				allocCreateInfo.setFlags(vma::AllocationCreateFlagBits::eDedicatedMemory);
+				vk::Result result = allocator.createImage(&sharedCreateInfo, &allocCreateInfo, &frame.lightfieldImage, &frame.lightfieldAlloc, nullptr);
+				if (result != vk::Result::eSuccess) VMI_ERR("Lightfield image creation unsuccessful");
+				allocator.setAllocationName(frame.lightfieldAlloc, std::string("Lightfield Array").append(suffix).c_str());
+
+				// the remaining images are small enough to share memory blocks
+				allocCreateInfo.setFlags({});
+
+				// comparison, one layer per camera so the forward pass can write it alongside the colors,
+				// only the center layer is compared against (and filled by loaded datasets)
+				imageCreateInfo.setArrayLayers(nCameras);
+				imageCreateInfo.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc);
+				imageCreateInfo.setFormat(comparisonFormat);
+				result = allocator.createImage(&imageCreateInfo, &allocCreateInfo, &frame.comparisonImage, &frame.comparisonAlloc, nullptr);
+				if (result != vk::Result::eSuccess) VMI_ERR("Comparison image creation unsuccessful");
+				allocator.setAllocationName(frame.comparisonAlloc, std::string("Comparison").append(suffix).c_str());
+			}
 
-		// gradients view
-		imageViewInfo.subresourceRange.baseArrayLayer = 0;
-		imageViewInfo.setImage(gradientsImage);
-		gradientsImageView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+			sharedCreateInfo.setArrayLayers(1);
 
-		// comparison view
-		imageViewInfo.setImage(comparisonImage);
-		imageViewInfo.setFormat(vk::Format::eR32Sfloat);
-		comparisonImageView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+			// gradients (Lx, Ly, Lu, Lv of the selected filter)
+			sharedCreateInfo.setUsage(vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled);
+			sharedCreateInfo.setFormat(gradientsFormat);
+			frame.gradientsImage = deviceWrapper.logicalDevice.createImage(sharedCreateInfo);
 
-		// disparity view
-		imageViewInfo.setImage(disparityImage);
-		imageViewInfo.setFormat(colorFormat);
-		disparityImageView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+			// disparity (disparity, confidence, filter index)
+			sharedCreateInfo.setUsage(vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferSrc);
+			sharedCreateInfo.setFormat(disparityFormat);
+			frame.disparityImage = deviceWrapper.logicalDevice.createImage(sharedCreateInfo);
+		}
+		bind_estimates(deviceWrapper, allocator);
 	}
-	void load_image_data(const char* filename, uint32_t iCam, DeviceWrapper& deviceWrapper, vma::Allocator& allocator, vk::CommandPool& commandPool)
+	// the gradients pass writes gradients and disparity in the same dispatch, and the display (or the next frames,
+	// until the lightfield or filter changes) samples them afterwards, so in the frame graph's pass order
+	// no two of them are ever dead at once and none may alias; they still share one allocation, placed side by side
+	void bind_estimates(DeviceWrapper& deviceWrapper, vma::Allocator& allocator)
 	{
-		int x, y, n;
-		auto* img = stbi_load(filename, &x, &y, &n, STBI_rgb_alpha);
-		if (!img) {
-			VMI_ERR("Error on img load: Camera " << iCam << " with path: " << filename);
-			switch (iCam) {
-			case 0: img = stbi_load("lightfields/training/cotton/input_Cam039.png", &x, &y, &n, STBI_rgb_alpha); break;
-			case 1: img = stbi_load("lightfields/training/cotton/input_Cam048.png", &x, &y, &n, STBI_rgb_alpha); break;
-			case 2: img = stbi_load("lightfields/training/cotton/input_Cam057.png", &x, &y, &n, STBI_rgb_alpha); break;
-			case 3: img = stbi_load("lightfields/training/cotton/input_Cam040.png", &x, &y, &n, STBI_rgb_alpha); break;
-			case 4: img = stbi_load("lightfields/training/cotton/input_Cam049.png", &x, &y, &n, STBI_rgb_alpha); break;
-			case 5: img = stbi_load("lightfields/training/cotton/input_Cam058.png", &x, &y, &n, STBI_rgb_alpha); break;
-			case 6: img = stbi_load("lightfields/training/cotton/input_Cam041.png", &x, &y, &n, STBI_rgb_alpha); break;
-			case 7: img = stbi_load("lightfields/training/cotton/input_Cam050.png", &x, &y, &n, STBI_rgb_alpha); break;
-			case 8: img = stbi_load("lightfields/training/cotton/input_Cam059.png", &x, &y, &n, STBI_rgb_alpha); break;
+		vk::MemoryRequirements combined = vk::MemoryRequirements().setAlignment(1).setMemoryTypeBits(UINT32_MAX);
+		vk::DeviceSize separateSize = 0;
+		std::vector<vk::DeviceSize> offsets;
+		for (auto& frame : frames) {
+			for (vk::Image image : { frame.gradientsImage, frame.disparityImage }) {
+				vk::MemoryRequirements requirements = deviceWrapper.logicalDevice.getImageMemoryRequirements(image);
+				combined.size = (combined.size + requirements.alignment - 1) & ~(requirements.alignment - 1);
+				offsets.push_back(combined.size);
+				combined.size += requirements.size;
+				combined.alignment = std::max(combined.alignment, requirements.alignment);
+				combined.memoryTypeBits &= requirements.memoryTypeBits;
+				separateSize += requirements.size;
 			}
 		}
-		vk::DeviceSize fileSize = x * y * STBI_rgb_alpha;
 
-		// staging buffer
-		vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
-			.setSize(fileSize)
-			.setUsage(vk::BufferUsageFlagBits::eTransferSrc);
 		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
-			.setUsage(vma::MemoryUsage::eAuto)
-			.setFlags(vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
-		vma::AllocationInfo allocInfo;
-		auto stagingBuffer = allocator.createBuffer(bufferInfo, allocCreateInfo, allocInfo);
-
-		// already mapped, so just copy over
-		memcpy(allocInfo.pMappedData, img, fileSize);
-
-		// copy from staging buffer to image
-		// memory transfer
-		{
-			vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
-				.setLevel(vk::CommandBufferLevel::ePrimary)
-				.setCommandPool(commandPool)
-				.setCommandBufferCount(1);
-
-			vk::CommandBuffer commandBuffer;
-			auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&allocInfo, &commandBuffer);
-
-			// begin recording to temporary command buffer
-			vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
-				.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-			commandBuffer.begin(beginInfo);
-
-			// TODO: describe subresource here, need to select each image in lightfield array individually
-			vk::BufferImageCopy region = vk::BufferImageCopy()
-				// buffer
-				.setBufferRowLength(x)
-				.setBufferImageHeight(y)
-				.setBufferOffset(0)
-				// img
-				.setImageExtent(vk::Extent3D(x, y, 1))
-				.setImageOffset(0)
-				.setImageSubresource(vk::ImageSubresourceLayers()
-					.setAspectMask(vk::ImageAspectFlagBits::eColor)
-					.setBaseArrayLayer(iCam)
-					.setLayerCount(1)
-					.setMipLevel(0));
-
-			vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
-				.setOldLayout(vk::ImageLayout::eUndefined)
-				.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
-				.setImage(lightfieldImage)
-				.setSubresourceRange(vk::ImageSubresourceRange()
-					.setAspectMask(vk::ImageAspectFlagBits::eColor)
-					.setBaseArrayLayer(iCam)
-					.setLayerCount(1)
-					.setBaseMipLevel(0)
-					.setLevelCount(1));
-			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-			commandBuffer.copyBufferToImage(stagingBuffer.first, lightfieldImage, vk::ImageLayout::eTransferDstOptimal, region);
-			barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-			barrier.newLayout = vk::ImageLayout::eReadOnlyOptimal;
-			//barrier.newLayout = vk::ImageLayout::eColorAttachmentOptimal;
-			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-			commandBuffer.end();
-
-			vk::SubmitInfo submitInfo = vk::SubmitInfo()
-				.setCommandBufferCount(1)
-				.setPCommandBuffers(&commandBuffer);
-			deviceWrapper.queue.submit(submitInfo);
-			deviceWrapper.queue.waitIdle(); // TODO: change this to wait on a fence instead (upon queue submit) so multiple memory transfers would be possible
-
-			// free command buffer directly after use
-			deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, commandBuffer);
+			.setUsage(vma::MemoryUsage::eAutoPreferDevice);
+		vk::Result result = allocator.allocateMemory(&combined, &allocCreateInfo, &estimatesAlloc, nullptr);
+		if (result != vk::Result::eSuccess) VMI_ERR("Estimates allocation unsuccessful");
+		allocator.setAllocationName(estimatesAlloc, std::string("Estimates").c_str());
+
+		for (size_t i = 0; i < frames.size(); i++) {
+			allocator.bindImageMemory2(estimatesAlloc, offsets[i * 2 + 0], frames[i].gradientsImage, nullptr);
+			allocator.bindImageMemory2(estimatesAlloc, offsets[i * 2 + 1], frames[i].disparityImage, nullptr);
 		}
-
-		// clean up
-		allocator.destroyBuffer(stagingBuffer.first, stagingBuffer.second);
-		stbi_image_free(img);
+		VMI_LOG("Estimates of " << frames.size() << " frames: " << (combined.size >> 10) << " KiB in one allocation, "
+			<< (separateSize >> 10) << " KiB of images");
 	}
-	void load_comparison_image_data(const char* filename, DeviceWrapper& deviceWrapper, vma::Allocator& allocator, vk::CommandPool& commandPool)
+	void create_image_views(DeviceWrapper& deviceWrapper)
 	{
-		// reading grayscale .pfm file
-		std::ifstream myfile(filename, std::ios::binary);
-		std::streampos begin = myfile.tellg();
-		myfile.seekg(0, std::ios::end);
-		std::streampos end = myfile.tellg();
-		myfile.seekg(0, std::ios::beg);
-
-		// read header
-		// TODO
-
-
-		myfile.seekg(14); // header is 14 bytes
-		std::vector<char> imgData(end - begin);
-		myfile.read(imgData.data(), end - begin);
-		myfile.close();
+		vk::ImageSubresourceRange subresourceRange = vk::ImageSubresourceRange()
+			.setAspectMask(vk::ImageAspectFlagBits::eColor)
+			.setBaseMipLevel(0).setLevelCount(1)
+			.setBaseArrayLayer(0).setLayerCount(nCameras);
 
-		int x = 512; // TODO: read from header
-		int y = 512;
-		comparisonImageData.resize(x * y);
-		// mirror in y axis
-		float* curWrite = comparisonImageData.data();
-		float* curRead = reinterpret_cast<float*>(imgData.data());
-		for (int j = 0; j < y; j++) {
-			int yIndex = (x * y - y - j * y);
-			for (int i = 0; i < x; i++) {
-				curWrite[i + j * y] = curRead[i + yIndex];
+		for (size_t iFrame = 0; iFrame < frames.size(); iFrame++) {
+			LightfieldFrame& frame = frames[iFrame];
+			vk::ImageViewCreateInfo imageViewInfo = vk::ImageViewCreateInfo()
+				.setPNext(nullptr)
+				.setViewType(vk::ImageViewType::e2DArray)
+				.setFormat(colorFormat)
+				.setSubresourceRange(subresourceRange)
+				.setImage(frame.lightfieldImage);
+
+			if (iFrame >= nViewSets) {
+				// shared views, along with the images
+				frame.lightfieldImageView = frames[0].lightfieldImageView;
+				frame.lightfieldSingleImageViews = frames[0].lightfieldSingleImageViews;
+				frame.comparisonSingleImageViews = frames[0].comparisonSingleImageViews;
+				frame.comparisonImageView = frames[0].comparisonImageView;
+				frame.comparisonArrayView = frames[0].comparisonArrayView;
+			}
+			else {
+				// colors view
+				frame.lightfieldImageView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+
+				// single image view for writing each image individually
+				imageViewInfo.subresourceRange.layerCount = 1;
+				imageViewInfo.setViewType(vk::ImageViewType::e2D);
+				frame.lightfieldSingleImageViews.resize(nCameras);
+				for (auto i = 0u; i < nCameras; i++) {
+					imageViewInfo.subresourceRange.baseArrayLayer = i;
+					frame.lightfieldSingleImageViews[i] = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+				}
+
+				// comparison views, the same split as the lightfield for the forward pass plus the center layer for reading
+				imageViewInfo.setImage(frame.comparisonImage);
+				imageViewInfo.setFormat(comparisonFormat);
+				frame.comparisonSingleImageViews.resize(nCameras);
+				for (auto i = 0u; i < nCameras; i++) {
+					imageViewInfo.subresourceRange.baseArrayLayer = i;
+					frame.comparisonSingleImageViews[i] = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+				}
+				imageViewInfo.subresourceRange.baseArrayLayer = iCenterCamera;
+				frame.comparisonImageView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+
+				imageViewInfo.subresourceRange.baseArrayLayer = 0;
+				imageViewInfo.subresourceRange.layerCount = nCameras;
+				imageViewInfo.setViewType(vk::ImageViewType::e2DArray);
+				frame.comparisonArrayView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
 			}
-		}
-
-		if (!comparisonImageData.data()) {
-			VMI_ERR("Error on img load: Comparison image with path: " << filename);
-		}
-		vk::DeviceSize fileSize = x * y * sizeof(float);
 
-		// staging buffer
-		vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
-			.setSize(fileSize)
-			.setUsage(vk::BufferUsageFlagBits::eTransferSrc);
-		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
-			.setUsage(vma::MemoryUsage::eAuto)
-			.setFlags(vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
-		vma::AllocationInfo allocInfo;
-		auto stagingBuffer = allocator.createBuffer(bufferInfo, allocCreateInfo, allocInfo);
+			imageViewInfo.subresourceRange.baseArrayLayer = 0;
+			imageViewInfo.subresourceRange.layerCount = 1;
+			imageViewInfo.setViewType(vk::ImageViewType::e2D);
 
-		// already mapped, so just copy over
-		memcpy(allocInfo.pMappedData, comparisonImageData.data(), fileSize);
+			// gradients view
+			imageViewInfo.setImage(frame.gradientsImage);
+			imageViewInfo.setFormat(gradientsFormat);
+			frame.gradientsImageView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
 
-		// copy from staging buffer to image
-		// memory transfer
-		{
-			vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
-				.setLevel(vk::CommandBufferLevel::ePrimary)
-				.setCommandPool(commandPool)
-				.setCommandBufferCount(1);
-
-			vk::CommandBuffer commandBuffer;
-			auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&allocInfo, &commandBuffer);
-
-			// begin recording to temporary command buffer
-			vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
-				.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-			commandBuffer.begin(beginInfo);
-
-			// TODO: describe subresource here, need to select each image in lightfield array individually
-			vk::BufferImageCopy region = vk::BufferImageCopy()
-				// buffer
-				.setBufferRowLength(x)
-				.setBufferImageHeight(y)
-				.setBufferOffset(0)
-				// img
-				.setImageExtent(vk::Extent3D(x, y, 1))
-				.setImageOffset(0)
-				.setImageSubresource(vk::ImageSubresourceLayers()
-					.setAspectMask(vk::ImageAspectFlagBits::eColor)
-					.setBaseArrayLayer(0)
-					.setLayerCount(1)
-					.setMipLevel(0));
-
-			vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
-				.setOldLayout(vk::ImageLayout::eUndefined)
-				.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
-				.setImage(comparisonImage)
-				.setSubresourceRange(vk::ImageSubresourceRange()
-					.setAspectMask(vk::ImageAspectFlagBits::eColor)
-					.setBaseArrayLayer(0)
-					.setLayerCount(1)
-					.setBaseMipLevel(0)
-					.setLevelCount(1));
-			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-			commandBuffer.copyBufferToImage(stagingBuffer.first, comparisonImage, vk::ImageLayout::eTransferDstOptimal, region);
-			barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-			barrier.newLayout = vk::ImageLayout::eReadOnlyOptimal;
-			//barrier.newLayout = vk::ImageLayout::eColorAttachmentOptimal;
-			commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
-			commandBuffer.end();
-
-			vk::SubmitInfo submitInfo = vk::SubmitInfo()
-				.setCommandBufferCount(1)
-				.setPCommandBuffers(&commandBuffer);
-			deviceWrapper.queue.submit(submitInfo);
-			deviceWrapper.queue.waitIdle(); // TODO: change this to wait on a fence instead (upon queue submit) so multiple memory transfers would be possible
-
-			// free command buffer directly after use
-			deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, commandBuffer);
+			// disparity view
+			imageViewInfo.setImage(frame.disparityImage);
+			imageViewInfo.setFormat(disparityFormat);
+			frame.disparityImageView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
 		}
-
-		// clean up
-		allocator.destroyBuffer(stagingBuffer.first, stagingBuffer.second);
 	}
+	// copies one layer of an image that rests in shader read only layout back to the host
+	void read_image(DeviceWrapper& deviceWrapper, StagingRing& stagingRing, vk::CommandPool& commandPool, vk::Image image, uint32_t iLayer, void* pDst, vk::DeviceSize texelSize)
+	{
+		vk::DeviceSize size = extent.width * extent.height * texelSize;
+		StagingAllocation staging = stagingRing.allocate(deviceWrapper, size);
+
+		vk::CommandBufferAllocateInfo buffAllocInfo = vk::CommandBufferAllocateInfo()
+			.setLevel(vk::CommandBufferLevel::ePrimary)
+			.setCommandPool(commandPool)
+			.setCommandBufferCount(1);
+
+		vk::CommandBuffer commandBuffer;
+		auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&buffAllocInfo, &commandBuffer);
+
+		// begin recording to temporary command buffer
+		vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		commandBuffer.begin(beginInfo);
+
+		vk::ImageSubresourceLayers subres = vk::ImageSubresourceLayers()
+			.setMipLevel(0)
+			.setBaseArrayLayer(iLayer)
+			.setLayerCount(1)
+			.setAspectMask(vk::ImageAspectFlagBits::eColor);
+
+		vk::BufferImageCopy imgCopyBuffer = vk::BufferImageCopy()
+			.setBufferImageHeight(extent.height)
+			.setBufferRowLength(extent.width)
+			.setBufferOffset(staging.offset)
+			.setImageExtent(vk::Extent3D(extent, 1))
+			.setImageOffset(0)
+			.setImageSubresource(subres);
 
-	void create_desc_set_layout(DeviceWrapper& deviceWrapper)
+		vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderRead)
+			.setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+			.setOldLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+			.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+			.setImage(image)
+			.setSubresourceRange(vk::ImageSubresourceRange()
+				.setAspectMask(vk::ImageAspectFlagBits::eColor)
+				.setBaseArrayLayer(iLayer)
+				.setLayerCount(1)
+				.setBaseMipLevel(0)
+				.setLevelCount(1));
+
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+		commandBuffer.copyImageToBuffer(image, vk::ImageLayout::eTransferSrcOptimal, staging.buffer, imgCopyBuffer);
+		barrier.setOldLayout(vk::ImageLayout::eTransferSrcOptimal);
+		barrier.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+		barrier.setSrcAccessMask({});
+		barrier.setDstAccessMask(vk::AccessFlagBits::eShaderRead);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader, {}, {}, {}, barrier);
+		commandBuffer.end();
+
+		vk::SubmitInfo submitInfo = vk::SubmitInfo()
+			.setCommandBufferCount(1)
+			.setPCommandBuffers(&commandBuffer);
+		uint64_t timelineValue = deviceWrapper.submit(submitInfo);
+		stagingRing.track(timelineValue);
+		deviceWrapper.wait_for(timelineValue);
+
+		// free command buffer directly after use
+		deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, commandBuffer);
+
+		stagingRing.read(staging, pDst, size);
+	}
+	static void decode_comparison(const std::string& filename, LightfieldData& data)
 	{
-		// one binding for each image in gbuffer
-		std::array<vk::DescriptorSetLayoutBinding, 2> setLayoutBindings;
-		setLayoutBindings[0]
-			.setBinding(0)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
-		setLayoutBindings[1]
-			.setBinding(1)
-			.setDescriptorCount(1)
-			.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
-
-
-		// create descriptor set layout from the bindings
-		vk::DescriptorSetLayoutCreateInfo createInfo = vk::DescriptorSetLayoutCreateInfo()
-			.setBindingCount((uint32_t)setLayoutBindings.size())
-			.setPBindings(setLayoutBindings.data());
-		descSetLayoutDouble = deviceWrapper.logicalDevice.createDescriptorSetLayout(createInfo);
-
-		createInfo = vk::DescriptorSetLayoutCreateInfo()
-			.setBindingCount(1u)
-			.setPBindings(setLayoutBindings.data());
-		descSetLayoutSingle = deviceWrapper.logicalDevice.createDescriptorSetLayout(createInfo);
+		if (!read_pfm(filename.c_str(), data.comparison, data.comparisonExtent)) {
+			VMI_ERR("Error on img load: Comparison image with path: " << filename);
+		}
 	}
-	void create_desc_set(DeviceWrapper& deviceWrapper, vk::DescriptorPool& descPool)
+	void create_desc_set_layout(DeviceWrapper& deviceWrapper, LayoutCache& layoutCache)
 	{
-		// lightfield images
-		{
-			// allocate the descriptor sets using descriptor pool
-			vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo()
-				.setDescriptorPool(descPool)
-				.setDescriptorSetCount(1).setPSetLayouts(&descSetLayoutSingle);
-			descSetLightfield = deviceWrapper.logicalDevice.allocateDescriptorSets(allocInfo)[0];
-
-			// create sampler for images
-			vk::SamplerCreateInfo samplerInfo = vk::SamplerCreateInfo()
-				.setMagFilter(vk::Filter::eNearest)
-				.setMinFilter(vk::Filter::eNearest)
-				.setAnisotropyEnable(VK_FALSE) // not needed for now
-				.setMaxAnisotropy(0.0f)
-				.setUnnormalizedCoordinates(VK_FALSE)
-				.setBorderColor(vk::BorderColor::eIntOpaqueBlack)
-				.setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
-				.setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
-				.setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
-				.setCompareEnable(VK_FALSE)
-				.setCompareOp(vk::CompareOp::eAlways)
-				.setMipmapMode(vk::SamplerMipmapMode::eNearest)
-				.setMipLodBias(0.0f)
-				.setMinLod(0.0f)
-				.setMaxLod(0.0f);
-			samplerLightfields = deviceWrapper.logicalDevice.createSampler(samplerInfo);
-
-			std::array<vk::DescriptorImageInfo, 1> descriptors;
-			descriptors[0]
-				.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-				.setImageView(lightfieldImageView)
-				.setSampler(samplerLightfields);
-
-			// desc set
-			vk::WriteDescriptorSet descBufferWrites = vk::WriteDescriptorSet()
-				.setDstSet(descSetLightfield)
-				.setDstBinding(0)
-				.setDstArrayElement(0)
+		// gradients, disparity, comparison and lightfield array for the final pass
+		std::vector<vk::DescriptorSetLayoutBinding> setLayoutBindings(4);
+		for (uint32_t i = 0; i < setLayoutBindings.size(); i++) {
+			setLayoutBindings[i]
+				.setBinding(i)
+				.setDescriptorCount(1)
 				.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-				.setDescriptorCount((uint32_t)descriptors.size())
-				//
-				.setPBufferInfo(nullptr)
-				.setPImageInfo(descriptors.data())
-				.setPTexelBufferView(nullptr);
+				.setStageFlags(vk::ShaderStageFlagBits::eFragment);
+		}
+
+		descSetLayoutOutputs = layoutCache.get_desc_set_layout(deviceWrapper, setLayoutBindings);
 
-			deviceWrapper.logicalDevice.updateDescriptorSets(descBufferWrites, {});
+		// lightfield array in, gradients and disparity out for the gradients pass
+		std::vector<vk::DescriptorSetLayoutBinding> gradientsBindings(3);
+		for (uint32_t i = 0; i < gradientsBindings.size(); i++) {
+			gradientsBindings[i]
+				.setBinding(i)
+				.setDescriptorCount(1)
+				.setDescriptorType(i == 0 ? vk::DescriptorType::eCombinedImageSampler : vk::DescriptorType::eStorageImage)
+				.setStageFlags(vk::ShaderStageFlagBits::eCompute);
 		}
+		descSetLayoutGradients = layoutCache.get_desc_set_layout(deviceWrapper, gradientsBindings);
+	}
+	void create_desc_set(DeviceWrapper& deviceWrapper, DescriptorAllocator& descAllocator, LayoutCache& layoutCache)
+	{
+		// every image is read texel by texel, so one cached sampler serves all of them
+		sampler = layoutCache.get_nearest_sampler(deviceWrapper);
 
-		// gradient image
+		// inputs and outputs of the gradients pass (one set per frame)
 		{
-			// allocate the descriptor sets using descriptor pool
-			vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo()
-				.setDescriptorPool(descPool)
-				.setDescriptorSetCount(1).setPSetLayouts(&descSetLayoutDouble);
-			descSetGradients = deviceWrapper.logicalDevice.allocateDescriptorSets(allocInfo)[0];
-
-			// create sampler for images
-			vk::SamplerCreateInfo samplerInfo = vk::SamplerCreateInfo()
-				.setMagFilter(vk::Filter::eNearest)
-				.setMinFilter(vk::Filter::eNearest)
-				.setAnisotropyEnable(VK_FALSE) // not needed for now
-				.setMaxAnisotropy(0.0f)
-				.setUnnormalizedCoordinates(VK_FALSE)
-				.setBorderColor(vk::BorderColor::eIntOpaqueBlack)
-				.setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
-				.setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
-				.setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
-				.setCompareEnable(VK_FALSE)
-				.setCompareOp(vk::CompareOp::eAlways)
-				.setMipmapMode(vk::SamplerMipmapMode::eNearest)
-				.setMipLodBias(0.0f)
-				.setMinLod(0.0f)
-				.setMaxLod(0.0f);
-			samplerGradients = deviceWrapper.logicalDevice.createSampler(samplerInfo);
-
-			std::array<vk::DescriptorImageInfo, 2> descriptors;
-			descriptors[0]
-				.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-				.setImageView(gradientsImageView)
-				.setSampler(samplerGradients);
-			descriptors[1]
-				.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-				.setImageView(comparisonImageView)
-				.setSampler(samplerGradients);
-
-			// desc set
-			vk::WriteDescriptorSet descBufferWrites = vk::WriteDescriptorSet()
-				.setDstSet(descSetGradients)
-				.setDstBinding(0)
-				.setDstArrayElement(0)
-				.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
-				.setDescriptorCount((uint32_t)descriptors.size())
-				//
-				.setPBufferInfo(nullptr)
-				.setPImageInfo(descriptors.data())
-				.setPTexelBufferView(nullptr);
+			std::vector<vk::DescriptorSet> descSets = descAllocator.allocate(deviceWrapper, descSetLayoutGradients, (uint32_t)frames.size());
+
+			for (size_t i = 0; i < frames.size(); i++) {
+				frames[i].descSetGradients = descSets[i];
+
+				// storage images are written in general layout
+				std::array<vk::DescriptorImageInfo, 3> descriptors;
+				descriptors[0]
+					.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+					.setImageView(frames[i].lightfieldImageView)
+					.setSampler(sampler);
+				descriptors[1]
+					.setImageLayout(vk::ImageLayout::eGeneral)
+					.setImageView(frames[i].gradientsImageView);
+				descriptors[2]
+					.setImageLayout(vk::ImageLayout::eGeneral)
+					.setImageView(frames[i].disparityImageView);
+
+				std::array<vk::WriteDescriptorSet, 3> writes;
+				for (uint32_t iBinding = 0; iBinding < writes.size(); iBinding++) {
+					writes[iBinding] = vk::WriteDescriptorSet()
+						.setDstSet(frames[i].descSetGradients)
+						.setDstBinding(iBinding)
+						.setDstArrayElement(0)
+						.setDescriptorType(iBinding == 0 ? vk::DescriptorType::eCombinedImageSampler : vk::DescriptorType::eStorageImage)
+						.setImageInfo(descriptors[iBinding]);
+				}
+				deviceWrapper.logicalDevice.updateDescriptorSets(writes, {});
+			}
+		}
 
-			deviceWrapper.logicalDevice.updateDescriptorSets(descBufferWrites, {});
+		// outputs of the gradients pass (one set per frame)
+		{
+			std::vector<vk::DescriptorSet> descSets = descAllocator.allocate(deviceWrapper, descSetLayoutOutputs, (uint32_t)frames.size());
+
+			for (size_t i = 0; i < frames.size(); i++) {
+				frames[i].descSetOutputs = descSets[i];
+
+				std::array<vk::DescriptorImageInfo, 4> descriptors;
+				descriptors[0]
+					.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+					.setImageView(frames[i].gradientsImageView)
+					.setSampler(sampler);
+				descriptors[1]
+					.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+					.setImageView(frames[i].disparityImageView)
+					.setSampler(sampler);
+				descriptors[2]
+					.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+					.setImageView(frames[i].comparisonImageView)
+					.setSampler(sampler);
+				descriptors[3]
+					.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+					.setImageView(frames[i].lightfieldImageView)
+					.setSampler(sampler);
+
+				// desc set
+				vk::WriteDescriptorSet descBufferWrites = vk::WriteDescriptorSet()
+					.setDstSet(frames[i].descSetOutputs)
+					.setDstBinding(0)
+					.setDstArrayElement(0)
+					.setDescriptorType(vk::DescriptorType::eCombinedImageSampler)
+					.setDescriptorCount((uint32_t)descriptors.size())
+					//
+					.setPBufferInfo(nullptr)
+					.setPImageInfo(descriptors.data())
+					.setPTexelBufferView(nullptr);
+
+				deviceWrapper.logicalDevice.updateDescriptorSets(descBufferWrites, {});
+			}
 		}
 	}
 
 public:
 	static constexpr size_t nCameras = 9;
 	static constexpr vk::Format colorFormat = vk::Format::eR8G8B8A8Srgb;
-
-	vma::Allocation lightfieldAlloc, gradientsAlloc, disparityAlloc, comparisonAlloc;
-	vk::Image lightfieldImage, gradientsImage, disparityImage, comparisonImage;
-	vk::ImageView lightfieldImageView, gradientsImageView, disparityImageView, comparisonImageView;
-	std::vector<vk::ImageView> lightfieldSingleImageViews; // one view for each cam to render into
-
-	vk::DescriptorSetLayout descSetLayoutSingle;
-	vk::DescriptorSetLayout descSetLayoutDouble;
-	vk::DescriptorSet descSetLightfield, descSetGradients;
-	vk::Sampler samplerLightfields, samplerGradients;
+	static constexpr vk::Format gradientsFormat = vk::Format::eR16G16B16A16Sfloat;
+	static constexpr vk::Format disparityFormat = vk::Format::eR32G32B32A32Sfloat;
+	static constexpr vk::Format comparisonFormat = vk::Format::eR32Sfloat;
+	static constexpr uint32_t iCenterCamera = 4; // view without offset, the one disparity is estimated for
+	static constexpr uint32_t nFiles = nCameras + 1; // views plus ground truth
+	static constexpr std::array<const char*, nCameras> camFiles = {
+		"input_Cam039.png", "input_Cam048.png", "input_Cam057.png",
+		"input_Cam040.png", "input_Cam049.png", "input_Cam058.png",
+		"input_Cam041.png", "input_Cam050.png", "input_Cam059.png"
+	};
+
+	vk::Extent2D extent;
+	std::vector<LightfieldFrame> frames; // one per frame in flight, plus one when depth is estimated on the async compute queue
+	uint32_t nViewSets = 1; // leading frames with their own views, the others share the first frame's
+	vma::Allocation estimatesAlloc; // gradients and disparity of every frame
+
+	// layouts and sampler are owned by the layout cache, sets by the descriptor allocator
+	vk::DescriptorSetLayout descSetLayoutGradients;
+	vk::DescriptorSetLayout descSetLayoutOutputs;
+	vk::Sampler sampler;
 	std::string srcFolderCache;
 	std::vector<float> comparisonImageData;
 };
\ No newline at end of file
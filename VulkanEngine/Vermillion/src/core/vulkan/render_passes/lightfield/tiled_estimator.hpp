@@ -0,0 +1,346 @@
+#pragma once
+
+struct TiledEstimatorCreateInfo
+{
+	DeviceWrapper& deviceWrapper;
+	vma::Allocator& allocator;
+	DescriptorAllocator& descAllocator;
+	Lightfield& lightfield;
+};
+
+// estimates disparity of a dataset at its full resolution, which may be far larger than the lightfield images,
+// by streaming overlapping tiles of all views through a fixed set of GPU images and stitching the results on the host
+class TiledEstimator
+{
+public:
+	TiledEstimator() = default;
+	~TiledEstimator() = default;
+	ROF_COPY_MOVE_DELETE(TiledEstimator)
+
+private:
+	static constexpr uint32_t tileSize = 512; // pixels of the stitched result per tile and dimension
+	static constexpr uint32_t halo = 4; // radius of the largest (9-tap) filter
+	static constexpr uint32_t inputSize = tileSize + 2 * halo;
+	static constexpr uint32_t nSlots = 2; // one tile is uploaded while the previous one is estimated
+
+	// GPU resources of one tile in flight
+	struct Slot
+	{
+		vma::Allocation inputAlloc, gradientsAlloc, disparityAlloc, readbackAlloc;
+		vk::Image inputImage, gradientsImage, disparityImage;
+		vk::ImageView inputImageView, gradientsImageView, disparityImageView;
+		vk::Buffer readbackBuffer;
+		float4* pReadback = nullptr;
+		vk::DescriptorSet descSet;
+
+		// tile currently in flight
+		vk::CommandBuffer commandBuffer;
+		uint64_t timelineValue = 0;
+		vk::Offset2D offset;
+		vk::Extent2D core;
+	};
+
+public:
+	void init(TiledEstimatorCreateInfo& info)
+	{
+		create_slots(info);
+		create_desc_sets(info);
+	}
+	void destroy(DeviceWrapper& deviceWrapper, vma::Allocator& allocator)
+	{
+		for (auto& slot : slots) {
+			allocator.destroyImage(slot.inputImage, slot.inputAlloc);
+			allocator.destroyImage(slot.gradientsImage, slot.gradientsAlloc);
+			allocator.destroyImage(slot.disparityImage, slot.disparityAlloc);
+			allocator.destroyBuffer(slot.readbackBuffer, slot.readbackAlloc);
+
+			deviceWrapper.logicalDevice.destroyImageView(slot.inputImageView);
+			deviceWrapper.logicalDevice.destroyImageView(slot.gradientsImageView);
+			deviceWrapper.logicalDevice.destroyImageView(slot.disparityImageView);
+		}
+	}
+
+	// decodes the dataset uncropped, estimates it tile by tile and writes the stitched disparity to the given file,
+	// blocks until done and expects the queue to be idle
+	void run(DeviceWrapper& deviceWrapper, StagingRing& stagingRing, vk::CommandPool& commandPool, ThreadPool& threadPool,
+		Lightfield& lightfield, GradientsPass& gradientsPass, PC pushConstant, const char* filename)
+	{
+		LightfieldData data;
+		threadPool.dispatch(Lightfield::nFiles, [&](uint32_t iFile, uint32_t iThread) { lightfield.decode_file(iFile, data); });
+		extent = data.viewExtents[Lightfield::iCenterCamera];
+		if (!data.views[Lightfield::iCenterCamera]) {
+			VMI_ERR("Tiled estimation needs the center view");
+			Lightfield::free_views(data);
+			return;
+		}
+
+		uint32_t nTilesX = (extent.width + tileSize - 1) / tileSize;
+		uint32_t nTilesY = (extent.height + tileSize - 1) / tileSize;
+		VMI_LOG("Tiled estimation: " << extent.width << "x" << extent.height << " in " << nTilesX * nTilesY << " tiles of " << tileSize
+			<< " pixels, " << (get_slot_size() * nSlots >> 20) << " MiB of GPU memory");
+		auto begin = std::chrono::high_resolution_clock::now();
+
+		disparity.assign((size_t)extent.width * extent.height, float4(0.0f));
+		for (uint32_t iTile = 0; iTile < nTilesX * nTilesY; iTile++) {
+			// the previous tile of this slot is stitched before the slot is written again
+			Slot& slot = slots[iTile % nSlots];
+			finish(deviceWrapper, commandPool, slot);
+
+			slot.offset = vk::Offset2D((int32_t)((iTile % nTilesX) * tileSize), (int32_t)((iTile / nTilesX) * tileSize));
+			slot.core = vk::Extent2D(std::min(tileSize, extent.width - slot.offset.x), std::min(tileSize, extent.height - slot.offset.y));
+			submit(deviceWrapper, stagingRing, commandPool, threadPool, gradientsPass, pushConstant, data, slot);
+		}
+		for (auto& slot : slots) finish(deviceWrapper, commandPool, slot);
+		Lightfield::free_views(data);
+
+		float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+		VMI_LOG("Tiled estimation took " << ms << " ms");
+
+		std::vector<float> disparityOnly(disparity.size());
+		for (size_t i = 0; i < disparity.size(); i++) disparityOnly[i] = disparity[i].x;
+		Lightfield::write_pfm(filename, disparityOnly.data(), extent.width, extent.height);
+		VMI_LOG("Wrote tiled disparity to " << filename);
+		Lightfield::log_disparity_error(data.comparison, disparity);
+
+		// the stitched result can be as large as the dataset
+		disparity = std::vector<float4>();
+		tileData = std::vector<uint8_t>();
+	}
+
+private:
+	// copies the tile and its halo out of every view, records the pass and submits it
+	void submit(DeviceWrapper& deviceWrapper, StagingRing& stagingRing, vk::CommandPool& commandPool, ThreadPool& threadPool,
+		GradientsPass& gradientsPass, PC pushConstant, LightfieldData& data, Slot& slot)
+	{
+		// texels outside of a view are zero, the halo covers every tap of the filters at the tile borders
+		vk::DeviceSize layerSize = (vk::DeviceSize)inputSize * inputSize * STBI_rgb_alpha;
+		tileData.resize(layerSize * Lightfield::nCameras);
+		threadPool.dispatch((uint32_t)Lightfield::nCameras, [&](uint32_t iCam, uint32_t iThread) {
+			uint8_t* pLayer = tileData.data() + layerSize * iCam;
+			memset(pLayer, 0, layerSize);
+			if (!data.views[iCam]) return;
+
+			vk::Extent2D viewExtent = data.viewExtents[iCam];
+			int32_t x0 = slot.offset.x - (int32_t)halo, y0 = slot.offset.y - (int32_t)halo;
+			int32_t xBegin = std::max(x0, 0), xEnd = std::min(x0 + (int32_t)inputSize, (int32_t)viewExtent.width);
+			int32_t yBegin = std::max(y0, 0), yEnd = std::min(y0 + (int32_t)inputSize, (int32_t)viewExtent.height);
+			for (int32_t y = yBegin; y < yEnd; y++) {
+				const stbi_uc* pSrc = data.views[iCam] + ((size_t)y * viewExtent.width + xBegin) * STBI_rgb_alpha;
+				uint8_t* pDst = pLayer + ((size_t)(y - y0) * inputSize + (xBegin - x0)) * STBI_rgb_alpha;
+				if (xEnd > xBegin) memcpy(pDst, pSrc, (size_t)(xEnd - xBegin) * STBI_rgb_alpha);
+			}
+		});
+		StagingAllocation staging = stagingRing.allocate(deviceWrapper, tileData.size());
+		stagingRing.write(staging, tileData.data(), tileData.size());
+
+		vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+			.setLevel(vk::CommandBufferLevel::ePrimary)
+			.setCommandPool(commandPool)
+			.setCommandBufferCount(1);
+		auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&allocInfo, &slot.commandBuffer);
+
+		vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
+			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+		slot.commandBuffer.begin(beginInfo);
+		vk::CommandBuffer& commandBuffer = slot.commandBuffer;
+
+		// the host waited on the slot's previous tile, so its contents are simply discarded
+		vk::ImageSubresourceRange range = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+		vk::ImageSubresourceRange arrayRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, Lightfield::nCameras);
+		vk::ImageMemoryBarrier barrier = vk::ImageMemoryBarrier()
+			.setDstAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setOldLayout(vk::ImageLayout::eUndefined)
+			.setNewLayout(vk::ImageLayout::eTransferDstOptimal)
+			.setImage(slot.inputImage)
+			.setSubresourceRange(arrayRange);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+
+		// all layers are laid out one after another in the staging allocation
+		vk::BufferImageCopy upload = vk::BufferImageCopy()
+			.setBufferOffset(staging.offset)
+			.setBufferRowLength(inputSize)
+			.setBufferImageHeight(inputSize)
+			.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, Lightfield::nCameras))
+			.setImageOffset({ 0, 0, 0 })
+			.setImageExtent(vk::Extent3D(inputSize, inputSize, 1));
+		commandBuffer.copyBufferToImage(staging.buffer, slot.inputImage, vk::ImageLayout::eTransferDstOptimal, upload);
+
+		std::array<vk::ImageMemoryBarrier, 3> barriers;
+		barriers[0] = vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eShaderRead)
+			.setOldLayout(vk::ImageLayout::eTransferDstOptimal)
+			.setNewLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+			.setImage(slot.inputImage)
+			.setSubresourceRange(arrayRange);
+		barriers[1] = vk::ImageMemoryBarrier()
+			.setDstAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setOldLayout(vk::ImageLayout::eUndefined)
+			.setNewLayout(vk::ImageLayout::eGeneral)
+			.setImage(slot.gradientsImage)
+			.setSubresourceRange(range);
+		barriers[2] = barriers[1];
+		barriers[2].setImage(slot.disparityImage);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader, {}, {}, {}, barriers);
+
+		// halo pixels are estimated as well, but only the core is read back
+		gradientsPass.dispatch(commandBuffer, pushConstant, slot.descSet, vk::Extent2D(inputSize, inputSize));
+
+		barrier = vk::ImageMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eShaderWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eTransferRead)
+			.setOldLayout(vk::ImageLayout::eGeneral)
+			.setNewLayout(vk::ImageLayout::eTransferSrcOptimal)
+			.setImage(slot.disparityImage)
+			.setSubresourceRange(range);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eTransfer, {}, {}, {}, barrier);
+
+		vk::BufferImageCopy readback = vk::BufferImageCopy()
+			.setBufferOffset(0)
+			.setBufferRowLength(slot.core.width)
+			.setBufferImageHeight(slot.core.height)
+			.setImageSubresource(vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1))
+			.setImageOffset({ (int32_t)halo, (int32_t)halo, 0 })
+			.setImageExtent(vk::Extent3D(slot.core, 1));
+		commandBuffer.copyImageToBuffer(slot.disparityImage, vk::ImageLayout::eTransferSrcOptimal, slot.readbackBuffer, readback);
+
+		vk::BufferMemoryBarrier hostBarrier = vk::BufferMemoryBarrier()
+			.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+			.setDstAccessMask(vk::AccessFlagBits::eHostRead)
+			.setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+			.setBuffer(slot.readbackBuffer)
+			.setOffset(0)
+			.setSize(VK_WHOLE_SIZE);
+		commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost, {}, {}, hostBarrier, {});
+		commandBuffer.end();
+
+		vk::SubmitInfo submitInfo = vk::SubmitInfo()
+			.setCommandBufferCount(1)
+			.setPCommandBuffers(&commandBuffer);
+		slot.timelineValue = deviceWrapper.submit(submitInfo);
+		stagingRing.track(slot.timelineValue);
+	}
+	// waits on the slot's tile and copies its core into the stitched result
+	void finish(DeviceWrapper& deviceWrapper, vk::CommandPool& commandPool, Slot& slot)
+	{
+		if (!slot.commandBuffer) return;
+		deviceWrapper.wait_for(slot.timelineValue);
+		deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, slot.commandBuffer);
+		slot.commandBuffer = nullptr;
+
+		allocator.invalidateAllocation(slot.readbackAlloc, 0, VK_WHOLE_SIZE);
+		for (uint32_t y = 0; y < slot.core.height; y++) {
+			float4* pDst = disparity.data() + (size_t)(slot.offset.y + y) * extent.width + slot.offset.x;
+			memcpy(pDst, slot.pReadback + (size_t)y * slot.core.width, slot.core.width * sizeof(float4));
+		}
+	}
+
+	void create_slots(TiledEstimatorCreateInfo& info)
+	{
+		allocator = info.allocator;
+
+		// same formats and usages as the lightfield images, at the size of a tile and its halo
+		vk::ImageCreateInfo imageCreateInfo = vk::ImageCreateInfo()
+			.setImageType(vk::ImageType::e2D)
+			.setExtent(vk::Extent3D(inputSize, inputSize, 1))
+			.setMipLevels(1)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setTiling(vk::ImageTiling::eOptimal);
+		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eAutoPreferDevice);
+
+		vk::ImageViewCreateInfo imageViewInfo = vk::ImageViewCreateInfo()
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1));
+
+		for (uint32_t i = 0; i < slots.size(); i++) {
+			Slot& slot = slots[i];
+			std::string suffix = std::string(" ").append(std::to_string(i));
+
+			imageCreateInfo.setArrayLayers(Lightfield::nCameras);
+			imageCreateInfo.setUsage(vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst);
+			imageCreateInfo.setFormat(Lightfield::colorFormat);
+			vk::Result result = info.allocator.createImage(&imageCreateInfo, &allocCreateInfo, &slot.inputImage, &slot.inputAlloc, nullptr);
+			if (result != vk::Result::eSuccess) VMI_ERR("Tile input image creation unsuccessful");
+			info.allocator.setAllocationName(slot.inputAlloc, std::string("Tile Input").append(suffix).c_str());
+
+			imageCreateInfo.setArrayLayers(1);
+			imageCreateInfo.setUsage(vk::ImageUsageFlagBits::eStorage);
+			imageCreateInfo.setFormat(Lightfield::gradientsFormat);
+			result = info.allocator.createImage(&imageCreateInfo, &allocCreateInfo, &slot.gradientsImage, &slot.gradientsAlloc, nullptr);
+			if (result != vk::Result::eSuccess) VMI_ERR("Tile gradients image creation unsuccessful");
+			info.allocator.setAllocationName(slot.gradientsAlloc, std::string("Tile Gradients").append(suffix).c_str());
+
+			imageCreateInfo.setUsage(vk::ImageUsageFlagBits::eStorage | vk::ImageUsageFlagBits::eTransferSrc);
+			imageCreateInfo.setFormat(Lightfield::disparityFormat);
+			result = info.allocator.createImage(&imageCreateInfo, &allocCreateInfo, &slot.disparityImage, &slot.disparityAlloc, nullptr);
+			if (result != vk::Result::eSuccess) VMI_ERR("Tile disparity image creation unsuccessful");
+			info.allocator.setAllocationName(slot.disparityAlloc, std::string("Tile Disparity").append(suffix).c_str());
+
+			// views
+			imageViewInfo.subresourceRange.layerCount = Lightfield::nCameras;
+			imageViewInfo.setViewType(vk::ImageViewType::e2DArray).setFormat(Lightfield::colorFormat).setImage(slot.inputImage);
+			slot.inputImageView = info.deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+			imageViewInfo.subresourceRange.layerCount = 1;
+			imageViewInfo.setViewType(vk::ImageViewType::e2D).setFormat(Lightfield::gradientsFormat).setImage(slot.gradientsImage);
+			slot.gradientsImageView = info.deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+			imageViewInfo.setFormat(Lightfield::disparityFormat).setImage(slot.disparityImage);
+			slot.disparityImageView = info.deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+
+			// the core of each tile is read back into its own buffer, the staging ring might hand it out again before it is read
+			vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
+				.setSize((vk::DeviceSize)tileSize * tileSize * sizeof(float4))
+				.setUsage(vk::BufferUsageFlagBits::eTransferDst);
+			vma::AllocationCreateInfo bufferAllocCreateInfo = vma::AllocationCreateInfo()
+				.setUsage(vma::MemoryUsage::eAuto)
+				.setFlags(vma::AllocationCreateFlagBits::eHostAccessRandom | vma::AllocationCreateFlagBits::eMapped);
+			vma::AllocationInfo allocInfo;
+			result = info.allocator.createBuffer(&bufferInfo, &bufferAllocCreateInfo, &slot.readbackBuffer, &slot.readbackAlloc, &allocInfo);
+			if (result != vk::Result::eSuccess) VMI_ERR("Tile readback buffer creation unsuccessful");
+			info.allocator.setAllocationName(slot.readbackAlloc, std::string("Tile Readback").append(suffix).c_str());
+			slot.pReadback = reinterpret_cast<float4*>(allocInfo.pMappedData);
+		}
+	}
+	void create_desc_sets(TiledEstimatorCreateInfo& info)
+	{
+		// same layout as the gradients pass uses for whole lightfield frames
+		for (auto& slot : slots) {
+			slot.descSet = info.descAllocator.allocate(info.deviceWrapper, info.lightfield.descSetLayoutGradients);
+
+			std::array<vk::DescriptorImageInfo, 3> descriptors;
+			descriptors[0]
+				.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
+				.setImageView(slot.inputImageView)
+				.setSampler(info.lightfield.sampler);
+			descriptors[1]
+				.setImageLayout(vk::ImageLayout::eGeneral)
+				.setImageView(slot.gradientsImageView);
+			descriptors[2]
+				.setImageLayout(vk::ImageLayout::eGeneral)
+				.setImageView(slot.disparityImageView);
+
+			std::array<vk::WriteDescriptorSet, 3> writes;
+			for (uint32_t iBinding = 0; iBinding < writes.size(); iBinding++) {
+				writes[iBinding] = vk::WriteDescriptorSet()
+					.setDstSet(slot.descSet)
+					.setDstBinding(iBinding)
+					.setDstArrayElement(0)
+					.setDescriptorType(iBinding == 0 ? vk::DescriptorType::eCombinedImageSampler : vk::DescriptorType::eStorageImage)
+					.setImageInfo(descriptors[iBinding]);
+			}
+			info.deviceWrapper.logicalDevice.updateDescriptorSets(writes, {});
+		}
+	}
+	static vk::DeviceSize get_slot_size()
+	{
+		vk::DeviceSize texels = (vk::DeviceSize)inputSize * inputSize;
+		return texels * (STBI_rgb_alpha * Lightfield::nCameras + 8 + 16); // rgba8 views, rgba16f gradients, rgba32f disparity
+	}
+
+private:
+	vma::Allocator allocator;
+	std::array<Slot, nSlots> slots;
+	vk::Extent2D extent; // of the dataset
+	std::vector<float4> disparity; // stitched, only alive during run()
+	std::vector<uint8_t> tileData; // views of the tile being staged, only alive during run()
+};
@@ -8,24 +8,31 @@ public:
 	ROF_COPY_MOVE_DELETE(SwapchainWrite)
 
 public:
-	void init(DeviceWrapper& deviceWrapper, SwapchainWrapper& swapchainWrapper, vk::DescriptorPool& descPool, vk::ImageView& input)
+	// subpass 0 renders into the display image (pipelines created by other passes),
+	// subpass 1 writes it to the swapchain image along with the ui
+	void init(DeviceWrapper& deviceWrapper, SwapchainWrapper& swapchainWrapper, vma::Allocator& allocator, DescriptorAllocator& descAllocator, LayoutCache& layoutCache)
 	{
 		create_shader_modules(deviceWrapper);
+		create_display_image(deviceWrapper, swapchainWrapper, allocator);
 		create_render_pass(deviceWrapper, swapchainWrapper);
-		create_framebuffer(deviceWrapper, swapchainWrapper, input);
+		create_framebuffer(deviceWrapper, swapchainWrapper);
 
-		create_desc_set_layout(deviceWrapper);
-		create_desc_set(deviceWrapper, descPool, input);
+		create_desc_set_layout(deviceWrapper, layoutCache);
+		create_desc_set(deviceWrapper, descAllocator);
 
-		create_pipeline_layout(deviceWrapper);
+		create_pipeline_layout(deviceWrapper, layoutCache);
 		create_pipeline(deviceWrapper, swapchainWrapper);
 
 		fullscreenRect = vk::Rect2D({ 0, 0 }, swapchainWrapper.extent);
 	}
-	void destroy(DeviceWrapper& deviceWrapper)
+	void destroy(DeviceWrapper& deviceWrapper, vma::Allocator& allocator)
 	{
 		auto& device = deviceWrapper.logicalDevice;
 
+		// Display
+		device.destroyImageView(displayImageView);
+		allocator.destroyImage(displayImage, displayAlloc);
+
 		// Shaders
 		device.destroyShaderModule(vs);
 		device.destroyShaderModule(ps);
@@ -37,14 +44,10 @@ public:
 		}
 
 		// Stages
-		deviceWrapper.logicalDevice.destroyPipelineLayout(pipelineLayout);
 		deviceWrapper.logicalDevice.destroyPipeline(graphicsPipeline);
-
-		// descriptors
-		deviceWrapper.logicalDevice.destroyDescriptorSetLayout(descSetLayout);
 	}
 
-	void execute(vk::CommandBuffer& commandBuffer, uint32_t iFrame)
+	void begin(vk::CommandBuffer& commandBuffer, uint32_t iFrame)
 	{
 		vk::RenderPassBeginInfo renderPassBeginInfo = vk::RenderPassBeginInfo()
 			.setRenderPass(renderPass)
@@ -52,6 +55,11 @@ public:
 			.setRenderArea(fullscreenRect);
 
 		commandBuffer.beginRenderPass(renderPassBeginInfo, vk::SubpassContents::eInline);
+	}
+	// to be called once subpass 0 was recorded, ends the render pass
+	void execute(vk::CommandBuffer& commandBuffer)
+	{
+		commandBuffer.nextSubpass(vk::SubpassContents::eInline);
 		commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
 
 		// draw fullscreen triangle
@@ -76,18 +84,49 @@ private:
 		vs = create_shader_module(deviceWrapper, swapchainWrite.vs);
 		ps = create_shader_module(deviceWrapper, swapchainWrite.ps);
 	}
+	void create_display_image(DeviceWrapper& deviceWrapper, SwapchainWrapper& swapchainWrapper, vma::Allocator& allocator)
+	{
+		// never leaves the render pass, so tiled gpus can keep it in tile memory entirely
+		vk::ImageCreateInfo imageCreateInfo = vk::ImageCreateInfo()
+			.setImageType(vk::ImageType::e2D)
+			.setExtent(vk::Extent3D(swapchainWrapper.extent, 1))
+			.setMipLevels(1).setArrayLayers(1)
+			.setSamples(vk::SampleCountFlagBits::e1)
+			.setTiling(vk::ImageTiling::eOptimal)
+			.setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eInputAttachment | vk::ImageUsageFlagBits::eTransientAttachment)
+			.setFormat(displayFormat);
+
+		vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
+			.setUsage(vma::MemoryUsage::eGpuLazilyAllocated);
+
+		vk::Result result = allocator.createImage(&imageCreateInfo, &allocCreateInfo, &displayImage, &displayAlloc, nullptr);
+		if (result != vk::Result::eSuccess) {
+			// desktop gpus usually lack lazily allocated memory
+			allocCreateInfo.setUsage(vma::MemoryUsage::eAutoPreferDevice);
+			result = allocator.createImage(&imageCreateInfo, &allocCreateInfo, &displayImage, &displayAlloc, nullptr);
+			if (result != vk::Result::eSuccess) VMI_ERR("Display image creation unsuccessful");
+		}
+		allocator.setAllocationName(displayAlloc, std::string("Display").c_str());
+
+		vk::ImageViewCreateInfo imageViewInfo = vk::ImageViewCreateInfo()
+			.setViewType(vk::ImageViewType::e2D)
+			.setFormat(displayFormat)
+			.setSubresourceRange(vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1))
+			.setImage(displayImage);
+		displayImageView = deviceWrapper.logicalDevice.createImageView(imageViewInfo);
+	}
 	void create_render_pass(DeviceWrapper& deviceWrapper, SwapchainWrapper& swapchainWrapper)
 	{
 		std::array<vk::AttachmentDescription, 2> attachments = {
-			// Input
+			// Display, contents only live between the two subpasses
 			vk::AttachmentDescription()
-				.setFormat(vk::Format::eR8G8B8A8Srgb)
+				.setFormat(displayFormat)
 				.setSamples(vk::SampleCountFlagBits::e1)
-				.setLoadOp(vk::AttachmentLoadOp::eLoad)
+				.setLoadOp(vk::AttachmentLoadOp::eDontCare)
 				.setStoreOp(vk::AttachmentStoreOp::eDontCare)
 				.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 				.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-				.setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
+				.setInitialLayout(vk::ImageLayout::eUndefined)
 				.setFinalLayout(vk::ImageLayout::eShaderReadOnlyOptimal),
 			// Output
 			vk::AttachmentDescription()
@@ -97,47 +136,62 @@ private:
 				.setStoreOp(vk::AttachmentStoreOp::eStore)
 				.setStencilLoadOp(vk::AttachmentLoadOp::eDontCare)
 				.setStencilStoreOp(vk::AttachmentStoreOp::eDontCare)
-				.setInitialLayout(vk::ImageLayout::eUndefined)
-				.setFinalLayout(vk::ImageLayout::ePresentSrcKHR)
+				.setInitialLayout(vk::ImageLayout::eColorAttachmentOptimal)
+				.setFinalLayout(vk::ImageLayout::eColorAttachmentOptimal)
 		};
 
 		// Subpass Descriptions
+		vk::AttachmentReference display = vk::AttachmentReference(0, vk::ImageLayout::eColorAttachmentOptimal);
 		vk::AttachmentReference input = vk::AttachmentReference(0, vk::ImageLayout::eShaderReadOnlyOptimal);
 		vk::AttachmentReference output = vk::AttachmentReference(1, vk::ImageLayout::eColorAttachmentOptimal);
-		vk::SubpassDescription subpass = vk::SubpassDescription()
-			.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
-			.setPDepthStencilAttachment(nullptr)
-			.setInputAttachments(input).setColorAttachments(output)
-			// misc other:
-			.setPreserveAttachmentCount(0).setPPreserveAttachments(nullptr).setPResolveAttachments(nullptr);
-
-		// Subpass dependency
-		vk::SubpassDependency dependency = vk::SubpassDependency()
-			.setDependencyFlags(vk::DependencyFlagBits::eByRegion)
-			// src (when/what to wait on)
-			.setSrcSubpass(VK_SUBPASS_EXTERNAL)
-			.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-			.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentRead)
-			// dst (when/what to write to)
-			.setDstSubpass(0)
-			.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-			.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
+		std::array<vk::SubpassDescription, 2> subpasses = {
+			vk::SubpassDescription()
+				.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+				.setPDepthStencilAttachment(nullptr)
+				.setColorAttachments(display),
+			vk::SubpassDescription()
+				.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+				.setPDepthStencilAttachment(nullptr)
+				.setInputAttachments(input).setColorAttachments(output)
+				// misc other:
+				.setPreserveAttachmentCount(0).setPPreserveAttachments(nullptr).setPResolveAttachments(nullptr)
+		};
+
+		// the swapchain image is synchronised by the frame graph, the display image is shared by all frames
+		std::array<vk::SubpassDependency, 2> dependencies = {
+			// previous frame has to be done reading the display image before it is overwritten
+			vk::SubpassDependency()
+				.setSrcSubpass(VK_SUBPASS_EXTERNAL).setDstSubpass(0)
+				.setSrcStageMask(vk::PipelineStageFlagBits::eFragmentShader)
+				.setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+				.setSrcAccessMask({})
+				.setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite),
+			// display image written in subpass 0 is read per pixel in subpass 1
+			vk::SubpassDependency()
+				.setSrcSubpass(0).setDstSubpass(1)
+				.setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
+				.setDstStageMask(vk::PipelineStageFlagBits::eFragmentShader)
+				.setSrcAccessMask(vk::AccessFlagBits::eColorAttachmentWrite)
+				.setDstAccessMask(vk::AccessFlagBits::eInputAttachmentRead)
+				.setDependencyFlags(vk::DependencyFlagBits::eByRegion)
+		};
 
 		vk::RenderPassCreateInfo renderPassInfo = vk::RenderPassCreateInfo()
 			.setAttachments(attachments)
-			.setDependencies(dependency)
-			.setSubpasses(subpass);
+			.setSubpasses(subpasses)
+			.setDependencies(dependencies);
 
 		renderPass = deviceWrapper.logicalDevice.createRenderPass(renderPassInfo);
 	}
-	void create_framebuffer(DeviceWrapper& deviceWrapper, SwapchainWrapper& swapchainWrapper, vk::ImageView& input)
+	void create_framebuffer(DeviceWrapper& deviceWrapper, SwapchainWrapper& swapchainWrapper)
 	{
-		std::array<vk::ImageView, 2> attachments = { input, VK_NULL_HANDLE };
+		std::array<vk::ImageView, 2> attachments = { VK_NULL_HANDLE, VK_NULL_HANDLE };
 
 		// create one framebuffer for each potential image view output
 		framebuffers.resize(swapchainWrapper.images.size());
 		for (size_t i = 0; i < swapchainWrapper.images.size(); i++) {
 
+			attachments[0] = displayImageView;
 			attachments[1] = swapchainWrapper.imageViews[i];
 
 			vk::FramebufferCreateInfo framebufferInfo = vk::FramebufferCreateInfo()
@@ -151,31 +205,22 @@ private:
 		}
 	}
 
-	void create_desc_set_layout(DeviceWrapper& deviceWrapper)
+	void create_desc_set_layout(DeviceWrapper& deviceWrapper, LayoutCache& layoutCache)
 	{
 		vk::DescriptorSetLayoutBinding setLayoutBinding = vk::DescriptorSetLayoutBinding()
 			.setBinding(0)
 			.setDescriptorCount(1)
 			.setDescriptorType(vk::DescriptorType::eInputAttachment)
 			.setStageFlags(vk::ShaderStageFlagBits::eFragment);
-
-		// create descriptor set layout from the bindings
-		vk::DescriptorSetLayoutCreateInfo createInfo = vk::DescriptorSetLayoutCreateInfo()
-			.setBindings(setLayoutBinding);
-
-		descSetLayout = deviceWrapper.logicalDevice.createDescriptorSetLayout(createInfo);
+		descSetLayout = layoutCache.get_desc_set_layout(deviceWrapper, { setLayoutBinding });
 	}
-	void create_desc_set(DeviceWrapper& deviceWrapper, vk::DescriptorPool& descPool, vk::ImageView& imageView)
+	void create_desc_set(DeviceWrapper& deviceWrapper, DescriptorAllocator& descAllocator)
 	{
-		// allocate the descriptor sets using descriptor pool
-		vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo()
-			.setDescriptorPool(descPool)
-			.setDescriptorSetCount(1).setPSetLayouts(&descSetLayout);
-		descSet = deviceWrapper.logicalDevice.allocateDescriptorSets(allocInfo)[0];
+		descSet = descAllocator.allocate(deviceWrapper, descSetLayout);
 
 		vk::DescriptorImageInfo descriptor = vk::DescriptorImageInfo()
 			.setImageLayout(vk::ImageLayout::eShaderReadOnlyOptimal)
-			.setImageView(imageView)
+			.setImageView(displayImageView)
 			.setSampler(nullptr);
 
 		// input image
@@ -192,12 +237,9 @@ private:
 		deviceWrapper.logicalDevice.updateDescriptorSets(descBufferWrites, {});
 	}
 
-	void create_pipeline_layout(DeviceWrapper& deviceWrapper)
+	void create_pipeline_layout(DeviceWrapper& deviceWrapper, LayoutCache& layoutCache)
 	{
-		vk::PipelineLayoutCreateInfo pipelineLayoutInfo = vk::PipelineLayoutCreateInfo()
-			.setSetLayouts(descSetLayout)
-			.setPushConstantRangeCount(0).setPushConstantRanges(nullptr);
-		pipelineLayout = deviceWrapper.logicalDevice.createPipelineLayout(pipelineLayoutInfo);
+		pipelineLayout = layoutCache.get_pipeline_layout(deviceWrapper, { descSetLayout });
 	}
 	void create_pipeline(DeviceWrapper& deviceWrapper, SwapchainWrapper& swapchainWrapper)
 	{
@@ -339,7 +381,7 @@ private:
 			.setLayout(pipelineLayout)
 			// render pass
 			.setRenderPass(renderPass)
-			.setSubpass(0);
+			.setSubpass(1);
 
 		auto result = deviceWrapper.logicalDevice.createGraphicsPipeline(pipelineCache, graphicsPipelineInfo);
 		switch (result.result)
@@ -354,8 +396,14 @@ private:
 	}
 	
 private:
+	static constexpr vk::Format displayFormat = vk::Format::eR8G8B8A8Srgb;
 	vk::RenderPass renderPass;
 	std::vector<vk::Framebuffer> framebuffers;
+
+	// display
+	vma::Allocation displayAlloc;
+	vk::Image displayImage;
+	vk::ImageView displayImageView;
 	vk::ShaderModule vs, ps;
 
 	// subpasses
@@ -2,14 +2,29 @@
 
 #include "vk_mem_alloc.hpp"
 #include "utils/types.hpp"
+#include "utils/thread_pool.hpp"
+#include "utils/timeline.hpp"
 #include "scene_objects/camera.hpp"
+#include "buffers/ring_buffer.hpp"
 #include "buffers/push_constant.hpp"
+#include "buffers/staging_ring.hpp"
+#include "buffers/mesh_arena.hpp"
+#include "buffers/uniform_arena.hpp"
+#include "buffers/instance_buffer.hpp"
+#include "wrappers/descriptor_allocator.hpp"
+#include "wrappers/layout_cache.hpp"
 #include "wrappers/imgui_wrapper.hpp"
 #include "wrappers/swapchain_wrapper.hpp"
 #include "wrappers/shader_wrapper.hpp"
+#include "wrappers/profiler_wrapper.hpp"
+#include "wrappers/memory_wrapper.hpp"
+#include "render_passes/frame_graph.hpp"
 #include "render_passes/lightfield/lightfield.hpp"
+#include "render_passes/lightfield/cull_pass.hpp"
 #include "render_passes/lightfield/forward_renderpass.hpp"
-#include "render_passes/lightfield/gradients_renderpass.hpp"
+#include "render_passes/lightfield/gradients_pass.hpp"
+#include "render_passes/lightfield/tiled_estimator.hpp"
+#include "render_passes/lightfield/cpu_estimator.hpp"
 #include "render_passes/lightfield/disparity_renderpass.hpp"
 #include "render_passes/swapchain_write.hpp"
 
@@ -21,17 +36,27 @@ public:
 	ROF_COPY_MOVE_DELETE(Renderer)
 
 public:
-	void init(DeviceWrapper& deviceWrapper, Window& window, const char* lightfieldDir)
+	void init(DeviceWrapper& deviceWrapper, Window& window, const char* lightfieldDir, vk::PresentModeKHR presentMode, Timeline& timeline)
 	{
 		VMI_LOG("[Initializing] Renderer...");
 		create_vma_allocator(deviceWrapper, window);
-		create_descriptor_pools(deviceWrapper);
+		stagingRing.init(allocator);
+		meshArena.init(allocator, sizeof(Vertex));
+		memoryWrapper.init(deviceWrapper);
+		descAllocator.init(deviceWrapper);
 		create_command_pools(deviceWrapper);
 
-		create_KHR(deviceWrapper, window, lightfieldDir);
-		syncFrames.set_size(swapchainWrapper.nImages).init(deviceWrapper);
+		threadPool.init();
 
-		imguiWrapper.init(deviceWrapper, window, swapchainWriteRenderpass.get_render_pass(), syncFrames);
+		// the ring only bounds the frames in flight, so it stays the same when the swapchain image count changes
+		syncFrames.set_size(nSyncFrames).init(deviceWrapper, threadPool.get_thread_count());
+		profiler.init(deviceWrapper, syncFrames.get_size());
+
+		swapchainWrapper.targetPresentMode = presentMode;
+		create_KHR(deviceWrapper, window, lightfieldDir, timeline);
+
+		// font upload is submitted without waiting on it
+		timeline.record("ImGui", [&]() { imguiWrapper.init(deviceWrapper, window, swapchainWriteRenderpass.get_render_pass(), syncFrames); });
 	}
 	void destroy(DeviceWrapper& deviceWrapper, entt::registry& reg)
 	{
@@ -39,16 +64,23 @@ public:
 		
 		destroy_KHR(deviceWrapper);
 
+		meshArena.release_uploads(deviceWrapper, transientCommandPool);
 		device.destroyCommandPool(transientCommandPool);
-		device.destroyDescriptorPool(descPool);
+		descAllocator.destroy(deviceWrapper);
+		layoutCache.destroy(deviceWrapper);
 
 		syncFrames.destroy(deviceWrapper);
+		profiler.destroy(deviceWrapper);
 
 		imguiWrapper.destroy(deviceWrapper);
 		ImGui_ImplVulkan_Shutdown();
 
 		deallocate_entities(deviceWrapper, reg);
+		meshArena.destroy(allocator);
+		stagingRing.destroy(deviceWrapper);
 		allocator.destroy();
+
+		threadPool.destroy();
 	}
 
 	// runtime
@@ -60,9 +92,11 @@ public:
 		if (w != swapchainWrapper.extent.width || h != swapchainWrapper.extent.height || bForceRebuild) {
 
 			VMI_LOG("Rebuilding KHR");
-			deviceWrapper.logicalDevice.waitIdle();
-			destroy_KHR(deviceWrapper);
-			create_KHR(deviceWrapper, window, lightfieldDir);
+			Timeline timeline;
+			timeline.record("Wait for submissions", [&]() { deviceWrapper.wait_for_submissions(); });
+			timeline.record("Destroy", [&]() { destroy_KHR(deviceWrapper); });
+			create_KHR(deviceWrapper, window, lightfieldDir, timeline);
+			timeline.log("Rebuild");
 		}
 	}
 	void dump_mem_vma()
@@ -73,15 +107,41 @@ public:
 		out.close();
 		VMI_LOG("Dumped VMA stats to vma_stats.json");
 	}
-	void handle_allocations(DeviceWrapper& deviceWrapper, entt::registry& reg)
+	void handle_allocations(DeviceWrapper& deviceWrapper, entt::registry& reg, TransformStore& transforms)
 	{
-		deallocate_entities(deviceWrapper, reg);
-		allocate_entities(deviceWrapper, reg);
+		// every frame builds its matrices in its own region, so slots can be handed out again right away
+		systems::Transform::deallocate(reg, transforms);
+
+		// draw records follow the entities
+		bool bChanged = deallocate_entities(deviceWrapper, reg);
+		bChanged |= allocate_entities(deviceWrapper, reg);
+		if (bChanged) cullPass.invalidate();
 	}
-	void render(DeviceWrapper& deviceWrapper, entt::registry& reg, PC pushConstant)
+	void render(DeviceWrapper& deviceWrapper, entt::registry& reg, TransformStore& transforms, PC pushConstant)
 	{
 		// get next frame of sync objects
 		auto& syncFrame = syncFrames.get_next();
+		uint32_t iSyncFrame = syncFrames.get_current_index();
+
+		// wait for the fetched frame's previous use before reusing any of its sync objects,
+		// as well as for older frames until no more than the allowed number are in flight
+		{
+			auto begin = std::chrono::high_resolution_clock::now();
+			uint64_t waitValue = syncFrame.timelineValue;
+			retire_frames(deviceWrapper);
+			if (inFlightFrames.size() >= maxFramesInFlight) {
+				waitValue = std::max(waitValue, inFlightFrames[inFlightFrames.size() - maxFramesInFlight].timelineValue);
+			}
+			deviceWrapper.wait_for(waitValue);
+			deviceWrapper.wait_for_compute(syncFrame.computeTimelineValue); // its gradients pass may still run after the graphics work
+			retire_frames(deviceWrapper);
+			imguiWrapper.finish_font_upload(deviceWrapper);
+			auto end = std::chrono::high_resolution_clock::now();
+			profiler.record_frame_wait(std::chrono::duration<float, std::milli>(end - begin).count());
+
+			// timestamps of this frame's previous use are available now
+			profiler.read_frame(deviceWrapper, iSyncFrame);
+		}
 
 		uint32_t iFrame;
 		// Acquire image
@@ -97,30 +157,71 @@ public:
 		}
 
 		// Render (record)
+		vk::CommandBuffer commandBuffer;
+		uint32_t iDisplay;
 		{
-			// wait for fence of fetched frame before rendering to it
-			vk::Result result = deviceWrapper.logicalDevice.waitForFences(syncFrame.commandBufferFence, VK_TRUE, UINT64_MAX);
-			if (result != vk::Result::eSuccess) assert(false);
-			// and reset it
-			deviceWrapper.logicalDevice.resetFences(syncFrame.commandBufferFence);
-
-			// reset command pool and then record into it (using command buffer)
-			deviceWrapper.logicalDevice.resetCommandPool(syncFrame.commandPool);
-			record_command_buffer(reg, deviceWrapper, syncFrame.commandBuffer, iFrame, pushConstant);
+			// reset command pools and then record into them (using command buffers)
+			syncFrame.reset_command_pools(deviceWrapper);
+			// uniforms of this frame's previous use were consumed as well
+			uniformArena.begin_frame(iSyncFrame);
+			instanceBuffer.update(deviceWrapper, allocator, transforms, threadPool, iSyncFrame);
+			commandBuffer = record_command_buffer(reg, deviceWrapper, syncFrame, iFrame, iSyncFrame, pushConstant, iDisplay);
 		}
 
 		// Render (submit)
 		{
-			vk::PipelineStageFlags waitStages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+			// with async compute, the displayed estimate may still be computed
+			std::array<vk::PipelineStageFlags, 2> waitStages = { acquireWaitStage, vk::PipelineStageFlagBits::eAllCommands };
+			std::array<vk::Semaphore, 2> waitSemaphores = { syncFrame.imageAvailable, deviceWrapper.computeTimeline };
 			vk::SubmitInfo submitInfo = vk::SubmitInfo()
-				.setPWaitDstStageMask(&waitStages)
+				.setPWaitDstStageMask(waitStages.data())
 				// semaphores
-				.setWaitSemaphoreCount(1).setPWaitSemaphores(&syncFrame.imageAvailable)
+				.setWaitSemaphoreCount(deviceWrapper.bAsyncCompute ? 2 : 1).setPWaitSemaphores(waitSemaphores.data())
 				.setSignalSemaphoreCount(1).setPSignalSemaphores(&syncFrame.renderFinished)
 				// command buffers
-				.setCommandBufferCount(1).setPCommandBuffers(&syncFrame.commandBuffer);
+				.setCommandBufferCount(1).setPCommandBuffers(&commandBuffer);
 
-			deviceWrapper.queue.submit(submitInfo, syncFrame.commandBufferFence);
+			syncFrame.timelineValue = deviceWrapper.submit(submitInfo, { 0, frameComputeValues[iDisplay] });
+			inFlightFrames.push_back({ syncFrame.timelineValue, inputTime });
+		}
+		profiler.record_frames_in_flight((uint32_t)inFlightFrames.size());
+		memoryWrapper.update(allocator);
+
+		// read back the latest disparity once it was computed
+		if (bCompareDisparity) {
+			deviceWrapper.wait_for_submissions();
+			lightfield.compare_disparity(deviceWrapper, stagingRing, transientCommandPool, iLatestFrame, bSimulateLightfield);
+			bCompareDisparity = false;
+		}
+		// the comparison image of the latest frame, e.g. the simulated ground truth, once its writes completed
+		if (bSaveLightfield) {
+			deviceWrapper.wait_for_submissions();
+			lightfield.save_pfm("disparity0.pfm", deviceWrapper, stagingRing, transientCommandPool, iLatestFrame);
+			bSaveLightfield = false;
+		}
+		// estimate the dataset at its full resolution, which does not have to fit into the lightfield images
+		if (bEstimateTiled) {
+			deviceWrapper.wait_for_submissions();
+			tiledEstimator.run(deviceWrapper, stagingRing, transientCommandPool, threadPool, lightfield, gradientsPass, pushConstant, "disparity_tiled.pfm");
+			bEstimateTiled = false;
+		}
+		// CPU reference of the latest estimate, from the same dataset files
+		if (bCompareCpu) {
+			deviceWrapper.wait_for_submissions();
+			if (bSimulateLightfield) {
+				VMI_WARN("The CPU reference only estimates loaded datasets");
+			}
+			else {
+				LightfieldData data;
+				threadPool.dispatch(Lightfield::nFiles, [&](uint32_t iFile, uint32_t iThread) { lightfield.decode_file(iFile, data); });
+				CpuEstimate cpuEstimate = CpuEstimator::estimate(data, pushConstant.iFilterMode, threadPool);
+				Lightfield::free_views(data);
+
+				std::vector<float4> gpuDisparity;
+				lightfield.read_disparity(deviceWrapper, stagingRing, transientCommandPool, iLatestFrame, gpuDisparity);
+				CpuEstimator::log_difference(cpuEstimate, gpuDisparity, lightfield.extent);
+			}
+			bCompareCpu = false;
 		}
 
 		// Present
@@ -143,12 +244,17 @@ public:
 
 	void handle_input(DeviceWrapper& deviceWrapper, Input& input)
 	{
+		// the next frame reacts to input sampled up to this point
+		inputTime = std::chrono::high_resolution_clock::now();
+
 		if (input.keysPressed.count(SDLK_SPACE)) {
-			//lightfield.compare_disparity(deviceWrapper, allocator, transientCommandPool);
+			bCompareDisparity = true;
 		}
 		if (input.keysPressed.count(SDLK_RCTRL)) {
+			// simulating needs a set of views per frame, while loaded ones are shared,
+			// so the lightfield is rebuilt (and the dataset reloaded) before the next frame
 			bSimulateLightfield = !bSimulateLightfield;
-			if (!bSimulateLightfield) lightfield.load_images(deviceWrapper, allocator, transientCommandPool);
+			bRebuildKHR = true;
 		}
 
 		if (bSimulateLightfield) {
@@ -164,38 +270,61 @@ public:
 			forwardRenderpass.update_cam_offsets(camOffset);
 		}
 		ImGui::End();
+
+		ImGui::Begin("Recording");
+		if (forwardRenderpass.is_multiview()) {
+			ImGui::Text("Forward: single multiview pass");
+		}
+		else {
+			ImGui::Text("Forward: one pass per camera (multiview unsupported)");
+			ImGui::Checkbox("Parallel forward recording", &bParallelRecording);
+		}
+		ImGui::Text("Depth estimation: %s", bAsyncCompute ? "async compute queue (display lags one frame)" : "graphics queue");
+		ImGui::Text("Worker threads: %u", threadPool.get_thread_count());
+		ImGui::Text("Uniform arena: %llu / %llu bytes", (unsigned long long)uniformArena.get_frame_usage(), (unsigned long long)uniformArena.get_frame_capacity());
+		ImGui::Text("Descriptor pools: %u", descAllocator.get_pool_count());
+		ImGui::Text("Instances: %u", instanceBuffer.get_instance_count());
+		ImGui::Text("Indirect draws: %u", cullPass.get_draw_count(syncFrames.get_current_index()));
+		ImGui::Checkbox("GPU frustum culling", &cullPass.bCulling);
+		ImGui::End();
+
+		ImGui::Begin("Frame Pacing");
+		static constexpr std::array<vk::PresentModeKHR, 4> presentModes = {
+			vk::PresentModeKHR::eFifo, vk::PresentModeKHR::eFifoRelaxed, vk::PresentModeKHR::eMailbox, vk::PresentModeKHR::eImmediate
+		};
+		ImGui::Text("Present mode: %s, %u swapchain images", vk::to_string(swapchainWrapper.presentMode).c_str(), (uint32_t)swapchainWrapper.images.size());
+		for (auto presentMode : presentModes) {
+			if (ImGui::RadioButton(vk::to_string(presentMode).c_str(), swapchainWrapper.targetPresentMode == presentMode)) {
+				swapchainWrapper.targetPresentMode = presentMode;
+				bRebuildKHR = true;
+			}
+		}
+		int nMaxFramesInFlight = (int)maxFramesInFlight;
+		if (ImGui::SliderInt("Max frames in flight", &nMaxFramesInFlight, 1, (int)syncFrames.get_size())) {
+			maxFramesInFlight = (uint32_t)nMaxFramesInFlight;
+		}
+		ImGui::End();
+
+		profiler.handle_imgui();
+		memoryWrapper.handle_imgui();
+		frameGraph.handle_imgui();
 	}
 
 private:
 	void create_vma_allocator(DeviceWrapper& deviceWrapper, Window& window)
 	{
+		vma::AllocatorCreateFlags flags = vma::AllocatorCreateFlagBits::eKhrDedicatedAllocation;
+		if (deviceWrapper.bMemoryBudget) flags |= vma::AllocatorCreateFlagBits::eExtMemoryBudget;
+
 		vma::AllocatorCreateInfo info = vma::AllocatorCreateInfo()
 			.setPhysicalDevice(deviceWrapper.physicalDevice)
 			.setDevice(deviceWrapper.logicalDevice)
 			.setInstance(window.get_vulkan_instance())
 			.setVulkanApiVersion(VK_API_VERSION_1_1)
-			.setFlags(vma::AllocatorCreateFlagBits::eKhrDedicatedAllocation);
+			.setFlags(flags);
 
 		allocator = vma::createAllocator(info);
 	}
-	void create_descriptor_pools(DeviceWrapper& deviceWrapper)
-	{
-		static constexpr uint32_t poolSize = 1000;
-
-		std::array<vk::DescriptorPoolSize, 1>  poolSizes =
-		{
-			vk::DescriptorPoolSize(vk::DescriptorType::eUniformBuffer, poolSize)
-			// TODO: other stuff this pool will need
-		};
-		vk::DescriptorPoolCreateFlags flags;
-
-		vk::DescriptorPoolCreateInfo info = vk::DescriptorPoolCreateInfo()
-			.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet)
-			.setMaxSets(poolSize * (uint32_t)poolSizes.size())
-			.setPoolSizeCount((uint32_t)poolSizes.size())
-			.setPPoolSizes(poolSizes.data());
-		descPool = deviceWrapper.logicalDevice.createDescriptorPool(info);
-	}
 	void create_command_pools(DeviceWrapper& deviceWrapper)
 	{
 		vk::CommandPoolCreateInfo commandPoolInfo = vk::CommandPoolCreateInfo()
@@ -203,120 +332,297 @@ private:
 			.setFlags(vk::CommandPoolCreateFlagBits::eTransient);
 		transientCommandPool = deviceWrapper.logicalDevice.createCommandPool(commandPoolInfo);
 	}
-	void create_KHR(DeviceWrapper& deviceWrapper, Window& window, const char* lightfieldDir)
+	void create_KHR(DeviceWrapper& deviceWrapper, Window& window, const char* lightfieldDir, Timeline& timeline)
 	{
-		swapchainWrapper.init(deviceWrapper, window);
-		camera.init(deviceWrapper, allocator, descPool, swapchainWrapper);
-
-		// 9 camera views, along with disparity and gradient maps
-		LightfieldCreateInfo lightfieldInfo = { deviceWrapper, swapchainWrapper, allocator, descPool, transientCommandPool, lightfieldDir };
-		lightfield.init(lightfieldInfo);
-
-		// create lightfield and the renderpass that writes to it
-		ForwardRenderpassCreateInfo forwardInfo = { deviceWrapper, swapchainWrapper, allocator, descPool, lightfield };
-		forwardRenderpass.init(forwardInfo);
-
-		GradientsRenderpassCreateInfo gradientsInfo = { deviceWrapper, swapchainWrapper, allocator, descPool, lightfield };
-		gradientsRenderpass.init(gradientsInfo);
-
-		DisparityRenderpassCreateInfo disparityInfo = { deviceWrapper, swapchainWrapper, allocator, descPool, lightfield };
-		disparityRenderpass.init(disparityInfo);
-
-		swapchainWriteRenderpass.init(deviceWrapper, swapchainWrapper, descPool, lightfield.disparityImageView);
+		timeline.record("Swapchain", [&]() { swapchainWrapper.init(deviceWrapper, window); });
+
+		// all per-frame uniforms live in here, one region per frame in flight
+		uniformArena.init(deviceWrapper, allocator, syncFrames.get_size());
+		instanceBuffer.init(deviceWrapper, allocator, descAllocator, layoutCache, syncFrames.get_size());
+		camera.init(deviceWrapper, descAllocator, layoutCache, swapchainWrapper, uniformArena);
+
+		// disparity and gradient maps, one set per frame in flight,
+		// the async compute queue lags one frame behind and keeps an extra set for the estimate it displays meanwhile,
+		// the 9 camera views only need as many sets while the forward pass renders them, loaded ones are shared
+		bAsyncCompute = deviceWrapper.bAsyncCompute;
+		uint32_t nLightfieldFrames = syncFrames.get_size() + (bAsyncCompute ? 1u : 0u);
+		LightfieldCreateInfo lightfieldInfo = { deviceWrapper, swapchainWrapper.extent, allocator, descAllocator, layoutCache, lightfieldDir, nLightfieldFrames, bSimulateLightfield };
+		timeline.record("Lightfield images", [&]() { lightfield.init(lightfieldInfo); });
+
+		// passes only reference the lightfield's images, so they are built on the workers while its files are decoded
+		ForwardRenderpassCreateInfo forwardInfo = { deviceWrapper, swapchainWrapper, allocator, descAllocator, layoutCache, lightfield, uniformArena };
+		CullPassCreateInfo cullInfo = { deviceWrapper, allocator, descAllocator, layoutCache, uniformArena, syncFrames.get_size() };
+		GradientsPassCreateInfo gradientsInfo = { deviceWrapper, layoutCache, lightfield };
+		TiledEstimatorCreateInfo tiledInfo = { deviceWrapper, allocator, descAllocator, lightfield };
+		LightfieldData lightfieldData;
+		std::vector<std::pair<const char*, std::function<void()>>> tasks = {
+			// create lightfield and the renderpass that writes to it
+			{ "Forward pass", [&]() { forwardRenderpass.init(forwardInfo); } },
+			// draws of the forward pass, culled per view
+			{ "Cull pass", [&]() { cullPass.init(cullInfo); } },
+			{ "Gradients pass", [&]() { gradientsPass.init(gradientsInfo); } },
+			{ "Tiled estimator", [&]() { tiledEstimator.init(tiledInfo); } },
+			// final pass renders as the first subpass of the swapchain write, keeping its output on chip
+			{ "Swapchain write and disparity pass", [&]() {
+				swapchainWriteRenderpass.init(deviceWrapper, swapchainWrapper, allocator, descAllocator, layoutCache);
+				DisparityRenderpassCreateInfo disparityInfo = { deviceWrapper, swapchainWrapper, allocator, layoutCache, lightfield, swapchainWriteRenderpass.get_render_pass() };
+				disparityRenderpass.init(disparityInfo);
+			} }
+		};
+		for (uint32_t i = 0; i < Lightfield::nFiles; i++) {
+			const char* name = i < Lightfield::nCameras ? Lightfield::camFiles[i] : "Ground truth";
+			tasks.push_back({ name, [&, i]() { lightfield.decode_file(i, lightfieldData); } });
+		}
+		threadPool.dispatch((uint32_t)tasks.size(), [&](uint32_t iTask, uint32_t iThread) {
+			timeline.record(tasks[iTask].first, tasks[iTask].second);
+		});
+		timeline.record("Dataset upload", [&]() { lightfield.upload(deviceWrapper, stagingRing, transientCommandPool, lightfieldData); });
+
+		lightfield.register_images(frameGraph);
+
+		// freshly created outputs hold no valid data yet
+		frameGradientsVersions.assign(lightfield.frames.size(), 0);
+		frameComputeValues.assign(lightfield.frames.size(), 0);
+		iLatestFrame = 0;
+		gradientsVersion++;
 	}
 	void destroy_KHR(DeviceWrapper& deviceWrapper)
 	{
-		camera.destroy(deviceWrapper, allocator);
+		frameGraph.clear();
+		uniformArena.destroy(allocator);
+		instanceBuffer.destroy(allocator);
+		descAllocator.reset(deviceWrapper); // every set so far belongs to the resources rebuilt with the swapchain
 
 		lightfield.destroy(deviceWrapper, allocator);
 		forwardRenderpass.destroy(deviceWrapper, allocator);
-		gradientsRenderpass.destroy(deviceWrapper);
+		cullPass.destroy(deviceWrapper, allocator);
+		gradientsPass.destroy(deviceWrapper);
+		tiledEstimator.destroy(deviceWrapper, allocator);
 		disparityRenderpass.destroy(deviceWrapper);
-		swapchainWriteRenderpass.destroy(deviceWrapper);
+		swapchainWriteRenderpass.destroy(deviceWrapper, allocator);
 
 		swapchainWrapper.destroy(deviceWrapper);
 	}
 	
 	// runtime
-	void allocate_entities(DeviceWrapper& deviceWrapper, entt::registry& reg)
+	bool allocate_entities(DeviceWrapper& deviceWrapper, entt::registry& reg)
 	{
-		systems::Geometry::allocate(reg, deviceWrapper, allocator, transientCommandPool);
+		return systems::Geometry::allocate(reg, deviceWrapper, meshArena, stagingRing, transientCommandPool);
 	}
-	void deallocate_entities(DeviceWrapper& deviceWrapper, entt::registry& reg)
+	bool deallocate_entities(DeviceWrapper& deviceWrapper, entt::registry& reg)
 	{
-		systems::Geometry::deallocate(reg, allocator);
+		return systems::Geometry::deallocate(reg, deviceWrapper, meshArena);
 	}
-	void record_command_buffer(entt::registry& reg, DeviceWrapper& deviceWrapper, vk::CommandBuffer& commandBuffer, uint32_t iFrame, PC pushConstant)
+	void retire_frames(DeviceWrapper& deviceWrapper)
 	{
+		// frames are submitted in order, so they complete in order as well
+		uint64_t completedValue = deviceWrapper.get_completed_value();
+		auto now = std::chrono::high_resolution_clock::now();
+		while (!inFlightFrames.empty() && inFlightFrames.front().timelineValue <= completedValue) {
+			profiler.record_latency(std::chrono::duration<float, std::milli>(now - inFlightFrames.front().inputTime).count());
+			inFlightFrames.pop_front();
+		}
+	}
+	// returns the command buffer to submit last, which presents the lightfield frame shown in iDisplay
+	vk::CommandBuffer record_command_buffer(entt::registry& reg, DeviceWrapper& deviceWrapper, SyncFrameData& syncFrame, uint32_t iFrame, uint32_t iSyncFrame, PC pushConstant, uint32_t& iDisplay)
+	{
+		vk::CommandBuffer commandBuffer = syncFrame.commandBuffer;
+
 		// setting up command buffer
 		vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
 			.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit)
 			.setPInheritanceInfo(nullptr);
 		commandBuffer.begin(beginInfo);
+		profiler.begin_frame(commandBuffer, iSyncFrame);
+
+		// gradients, disparity, confidence and filter index only change with the lightfield or filter mode,
+		// switching between render modes merely changes how the final pass maps them
+		if (bSimulateLightfield || pushConstant.iFilterMode != iGradientsFilterMode) {
+			iGradientsFilterMode = pushConstant.iFilterMode;
+			gradientsVersion++;
+		}
+		// a new estimate goes into the next lightfield frame, so the latest one stays readable while it is computed,
+		// with async compute that one is displayed in the meantime (one frame of lag) unless it never held an estimate
+		bool bEstimate = frameGradientsVersions[iLatestFrame] != gradientsVersion;
+		uint32_t iTarget = bEstimate ? (iLatestFrame + 1) % (uint32_t)lightfield.frames.size() : iLatestFrame;
+		iDisplay = bAsyncCompute && bEstimate && frameGradientsVersions[iLatestFrame] != 0 ? iLatestFrame : iTarget;
+		LightfieldFrame& target = lightfield.frames[iTarget];
+
+		uint32_t iSwapchainImage = frameGraph.import_swapchain_image(swapchainWrapper.images[iFrame], acquireWaitStage);
+		frameGraph.add_output(iSwapchainImage);
+		// the display may not read the new estimate, it is needed by the next frames all the same
+		if (bEstimate) frameGraph.add_output(target.iDisparityImage);
 
 		// manually switching between rendering geometry vs reading image data
 		if (bSimulateLightfield)
 		{
-			// update camera buffer (and other buffers later)
-			camera.update();
-
-			// transition lightfield images
-			lightfield.layout_transition_lightfields(commandBuffer, vk::ImageLayout::eUndefined, vk::ImageLayout::eColorAttachmentOptimal);
-
-			// writing to lightfield (9 cams)
-			for (auto i = 0u; i < 9; i++) {
-				forwardRenderpass.begin(commandBuffer, i);
-				forwardRenderpass.bind_desc_sets(commandBuffer, camera.get_desc_set(), i);
-				systems::Geometry::bind(reg, commandBuffer);
-				forwardRenderpass.end(commandBuffer);
-			}
-
-			// transition lightfield images
-			lightfield.layout_transition_lightfields(commandBuffer, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+			// push this frame's uniforms, worker threads only read the resulting offsets
+			camera.update(uniformArena);
+			forwardRenderpass.write_uniforms(uniformArena, camera);
+			cullPass.write_uniforms(uniformArena, camera, forwardRenderpass.get_cam_offsets());
+			cullPass.update_records(reg, deviceWrapper, iSyncFrame);
+
+			// writing to lightfield (9 cams) and the ground truth disparity of each view
+			frameGraph.add_pass("Forward", { FrameGraph::color_write(target.iLightfieldImage), FrameGraph::color_write(target.iComparisonImage) }, [&](vk::CommandBuffer& commandBuffer) {
+				// culling writes the indirect draws right before the render pass consumes them
+				cullPass.execute(commandBuffer, iSyncFrame, instanceBuffer);
+
+				if (forwardRenderpass.is_multiview()) {
+					// one render pass writes every layer, geometry is submitted once and broadcast to all views
+					forwardRenderpass.begin(commandBuffer, iTarget);
+					forwardRenderpass.bind_desc_sets(commandBuffer, camera, instanceBuffer);
+					meshArena.bind(commandBuffer);
+					cullPass.draw(commandBuffer, iSyncFrame, (uint32_t)Lightfield::nCameras);
+					forwardRenderpass.end(commandBuffer);
+				}
+				else if (bParallelRecording) {
+					// each view is recorded into a secondary buffer on a worker thread, the primary only stitches them together
+					std::array<vk::CommandBuffer, 9> secondaries;
+					threadPool.dispatch((uint32_t)secondaries.size(), [&](uint32_t iCam, uint32_t iThread) {
+						vk::CommandBuffer secondary = syncFrame.get_secondary_command_buffer(deviceWrapper, iThread);
+						forwardRenderpass.begin_secondary(secondary, iTarget, iCam);
+						forwardRenderpass.bind_desc_sets(secondary, camera, instanceBuffer, iCam);
+						meshArena.bind(secondary);
+						cullPass.draw(secondary, iSyncFrame, iCam);
+						secondary.end();
+						secondaries[iCam] = secondary;
+					});
+					for (auto i = 0u; i < 9; i++) {
+						forwardRenderpass.begin(commandBuffer, iTarget, i, vk::SubpassContents::eSecondaryCommandBuffers);
+						commandBuffer.executeCommands(secondaries[i]);
+						forwardRenderpass.end(commandBuffer);
+					}
+				}
+				else {
+					for (auto i = 0u; i < 9; i++) {
+						forwardRenderpass.begin(commandBuffer, iTarget, i);
+						forwardRenderpass.bind_desc_sets(commandBuffer, camera, instanceBuffer, i);
+						meshArena.bind(commandBuffer);
+						cullPass.draw(commandBuffer, iSyncFrame, i);
+						forwardRenderpass.end(commandBuffer);
+					}
+				}
+				profiler.write_stamp(commandBuffer, iSyncFrame, ProfilerWrapper::eForward);
+			});
 		}
 
-		gradientsRenderpass.execute(commandBuffer, pushConstant);
-		lightfield.layout_transition_gradients(commandBuffer, vk::ImageLayout::eColorAttachmentOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
-		disparityRenderpass.execute(commandBuffer, pushConstant);
-
-		if (bCompareDisparity) {
-			lightfield.compare_disparity(deviceWrapper, allocator, transientCommandPool);
-			bCompareDisparity = false;
-		}
-		if (bSaveLightfield) {
-			lightfield.save_pfm("disparity0.pfm", deviceWrapper, allocator, transientCommandPool);
-			bSaveLightfield = false;
+		// each lightfield frame keeps its estimate until it is the target again
+		if (bEstimate) {
+			std::vector<ImageAccess> accesses = {
+				FrameGraph::sampled(target.iLightfieldImage, vk::PipelineStageFlagBits::eComputeShader),
+				FrameGraph::storage_write(target.iGradientsImage),
+				FrameGraph::storage_write(target.iDisparityImage)
+			};
+			frameGraph.add_pass("Gradients", accesses, [&](vk::CommandBuffer& commandBuffer) {
+				profiler.write_stamp(commandBuffer, iSyncFrame, ProfilerWrapper::eComputeBegin);
+				gradientsPass.execute(commandBuffer, pushConstant, iTarget);
+				frameGradientsVersions[iTarget] = gradientsVersion;
+				profiler.write_stamp(commandBuffer, iSyncFrame, ProfilerWrapper::eGradients);
+			}, FrameGraph::Queue::eCompute);
 		}
 
-		// direct write to swapchain image
-		swapchainWriteRenderpass.execute(commandBuffer, iFrame);
+		// final pass and swapchain write share a render pass, only the outputs shown in the current render mode are read
+		std::vector<ImageAccess> displayAccesses = DisparityRenderpass::get_reads(lightfield, iDisplay, pushConstant.iRenderMode);
+		displayAccesses.push_back(FrameGraph::color_write(iSwapchainImage));
+		frameGraph.add_pass("Disparity + Swapchain Write", displayAccesses, [&](vk::CommandBuffer& commandBuffer) {
+			profiler.write_stamp(commandBuffer, iSyncFrame, ProfilerWrapper::eDisplayBegin);
+			swapchainWriteRenderpass.begin(commandBuffer, iFrame);
+			disparityRenderpass.execute(commandBuffer, pushConstant, iDisplay);
+			profiler.write_stamp(commandBuffer, iSyncFrame, ProfilerWrapper::eDisparity);
+			swapchainWriteRenderpass.execute(commandBuffer);
+		});
+
+		// with async compute the gradients pass splits the frame into three submissions: graphics work up to it,
+		// the pass itself on the compute queue and the display back on the graphics queue
+		std::function<vk::CommandBuffer(FrameGraph::Queue)> switch_queue;
+		if (bAsyncCompute) switch_queue = [&](FrameGraph::Queue queue) {
+			commandBuffer.end();
+			vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+			vk::SubmitInfo submitInfo = vk::SubmitInfo()
+				.setWaitSemaphoreCount(1).setPWaitDstStageMask(&waitStage)
+				.setCommandBufferCount(1).setPCommandBuffers(&commandBuffer);
+
+			if (queue == FrameGraph::Queue::eCompute) {
+				// the target is only written again once the previous estimate from it is done
+				submitInfo.setPWaitSemaphores(&deviceWrapper.computeTimeline);
+				deviceWrapper.submit(submitInfo, { frameComputeValues[iTarget] });
+				commandBuffer = syncFrame.computeCommandBuffer;
+			}
+			else {
+				// the gradients pass reads what the graphics queue rendered up to here
+				submitInfo.setPWaitSemaphores(&deviceWrapper.timeline);
+				frameComputeValues[iTarget] = deviceWrapper.submit_compute(submitInfo, { deviceWrapper.timelineValue });
+				syncFrame.computeTimelineValue = frameComputeValues[iTarget];
+				commandBuffer = syncFrame.lateCommandBuffer;
+			}
+			commandBuffer.begin(beginInfo);
+			return commandBuffer;
+		};
+		frameGraph.execute(commandBuffer, switch_queue);
+		profiler.write_stamp(commandBuffer, iSyncFrame, ProfilerWrapper::eSwapchainWrite);
+		iLatestFrame = iTarget;
 
 		// finalize command buffer
 		commandBuffer.end();
+		return commandBuffer;
 	}
 
 public:
 	// basically event messengers
 	bool bSaveLightfield = false;
 	bool bCompareDisparity = false;
+	bool bEstimateTiled = false;
+	bool bCompareCpu = false;
+	bool bRebuildKHR = false;
 
 private:
 	vma::Allocator allocator;
+	StagingRing stagingRing; // shared by all uploads and readbacks
+	MeshArena meshArena; // vertices and indices of every entity
 	SwapchainWrapper swapchainWrapper;
 	ImguiWrapper imguiWrapper;
+	ProfilerWrapper profiler;
+	MemoryWrapper memoryWrapper;
+	FrameGraph frameGraph;
+	ThreadPool threadPool;
+	bool bParallelRecording = true;
+	UniformArena uniformArena;
+	InstanceBuffer instanceBuffer; // model matrices, indexed by each draw's first instance
 
 	Lightfield lightfield;
+	CullPass cullPass;
 	ForwardRenderpass forwardRenderpass;
-	GradientsRenderpass gradientsRenderpass;
+	GradientsPass gradientsPass;
+	TiledEstimator tiledEstimator; // full resolution estimates, independent of the lightfield frames
 	DisparityRenderpass disparityRenderpass;
 	SwapchainWrite swapchainWriteRenderpass;
 
 	RingBuffer<SyncFrameData> syncFrames;
+	struct InFlightFrame
+	{
+		uint64_t timelineValue;
+		std::chrono::high_resolution_clock::time_point inputTime;
+	};
+	std::deque<InFlightFrame> inFlightFrames; // submitted frames the GPU has not finished yet, oldest first
+	std::chrono::high_resolution_clock::time_point inputTime = std::chrono::high_resolution_clock::now();
+	uint32_t maxFramesInFlight = 2;
+	static constexpr uint32_t nSyncFrames = 3;
+	static constexpr vk::PipelineStageFlagBits acquireWaitStage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
 	vk::CommandPool transientCommandPool; // TODO: transfer queue!
-	vk::DescriptorPool descPool;
+	DescriptorAllocator descAllocator; // sets live until the next swapchain rebuild
+	LayoutCache layoutCache;
 
 	// scene objects
 	Camera camera;
 	float camOffset = 0.01f;
 	bool bSimulateLightfield = false;
+
+	// gradients pass outputs persist until their inputs change,
+	// bumping the version invalidates the outputs of every frame
+	uint64_t gradientsVersion = 1;
+	std::vector<uint64_t> frameGradientsVersions; // version each lightfield frame's outputs were computed from
+	std::vector<uint64_t> frameComputeValues; // compute timeline value of each lightfield frame's latest gradients pass
+	uint32_t iLatestFrame = 0; // lightfield frame holding the newest estimate
+	uint8_t iGradientsFilterMode = 0;
+	bool bAsyncCompute = false;
 };
\ No newline at end of file
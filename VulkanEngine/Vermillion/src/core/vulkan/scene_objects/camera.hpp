@@ -1,6 +1,6 @@
 #pragma once
 
-#include "buffers/uniform_buffer.hpp"
+#include "buffers/uniform_arena.hpp"
 #include "wrappers/swapchain_wrapper.hpp"
 
 class Camera
@@ -11,23 +11,12 @@ public:
 	ROF_COPY_MOVE_DELETE(Camera)
 
 public:
-	void init(DeviceWrapper& deviceWrapper, vma::Allocator& allocator, vk::DescriptorPool& descPool, SwapchainWrapper& swapchainWrapper)
+	void init(DeviceWrapper& deviceWrapper, DescriptorAllocator& descAllocator, LayoutCache& layoutCache, SwapchainWrapper& swapchainWrapper, UniformArena& uniformArena)
 	{
 		aspectRatio = (float)swapchainWrapper.extent.width / (float)swapchainWrapper.extent.height;
 
-		BufferInfo info = {
-			deviceWrapper,
-			allocator,
-			descPool,
-			stageFlags, binding,
-			swapchainWrapper.images.size()
-		};
-		viewProjBuffer.init(info);
-		update();
-	}
-	void destroy(DeviceWrapper& deviceWrapper, vma::Allocator& allocator)
-	{
-		viewProjBuffer.destroy(deviceWrapper, allocator);
+		vk::DescriptorSetLayout layout = get_desc_set_layout(deviceWrapper, layoutCache);
+		descSet = uniformArena.create_desc_set(deviceWrapper, descAllocator, layout, binding, sizeof(ViewProjection));
 	}
 
 	void handle_input(Input& input)
@@ -74,9 +63,10 @@ public:
 		rotationEuler += rot;
 	}
 	
-	void update()
+	// pushes this frame's matrices, has to happen every frame the camera is bound
+	void update(UniformArena& uniformArena)
 	{
-		auto& ubo = viewProjBuffer.data;
+		auto& ubo = viewProj;
 
 		// view matrix
 		ubo.view = glm::mat4_cast(glm::inverse(glm::quat(rotationEuler)));
@@ -88,22 +78,37 @@ public:
 		// combination
 		ubo.viewProj = ubo.proj * ubo.view;
 		
-		viewProjBuffer.write_buffer();
+		dynamicOffset = uniformArena.push(ubo);
 	}
 	vk::DescriptorSet& get_desc_set()
 	{
-		return viewProjBuffer.get_desc_set();
+		return descSet;
+	}
+	uint32_t get_dynamic_offset()
+	{
+		return dynamicOffset;
+	}
+	// matrices of the last update
+	float4x4& get_view()
+	{
+		return viewProj.view;
+	}
+	float4x4& get_proj()
+	{
+		return viewProj.proj;
 	}
-	static vk::DescriptorSetLayout get_temp_desc_set_layout(DeviceWrapper& deviceWrapper)
+	static vk::DescriptorSetLayout get_desc_set_layout(DeviceWrapper& deviceWrapper, LayoutCache& layoutCache)
 	{
-		return UniformBufferDynamic<ViewProjection>::get_temp_desc_set_layout(deviceWrapper, binding, stageFlags);
+		return UniformArena::get_desc_set_layout(deviceWrapper, layoutCache, binding, stageFlags);
 	}
 
 private:
 	static constexpr uint32_t binding = 1;
 	static constexpr vk::ShaderStageFlags stageFlags = vk::ShaderStageFlagBits::eVertex;
 	struct ViewProjection { float4x4 view, proj, viewProj; };
-	UniformBufferDynamic<ViewProjection> viewProjBuffer;
+	ViewProjection viewProj;
+	vk::DescriptorSet descSet;
+	uint32_t dynamicOffset = 0;
 
 	// camera position in world space
 	float3 position = { 0.0f, 0.0f, -5.0f };
@@ -1,16 +1,42 @@
 #pragma once
 
+#include "buffers/staging_ring.hpp"
+#include "buffers/mesh_arena.hpp"
+
 enum class Primitive { eCube, eSphere };
 
+// procedural detail of a primitive, the defaults give the plain untextured shapes
+struct Surface
+{
+	uint32_t nSegments = 50; // rings and slices of spheres
+	float tiling = 0.0f; // noise cells along each uv axis (see lightfield_write_ps), zero leaves the surface untextured
+	float4 tint = float4(1.0f);
+};
+
+// 24 bytes instead of three float4s, every vertex is fetched once per lightfield view
 struct Vertex
 {
 public:
 	Vertex(float4 pos, float4 col, float4 norm, float2 uv = float2(1.0f, 0.0f)) : 
 		pos(pos), 
-		col(col.x, col.y, col.z, uv.x), 
-		norm(norm.x, norm.y, norm.z, uv.y) 
+		col(glm::packUnorm4x8(col)), 
+		norm(glm::packSnorm2x16(encode_oct(norm))), 
+		uv(glm::packHalf2x16(uv)) 
 	{
-		// hiding uv in w of col and norm
+	}
+
+private:
+	// octahedral mapping of the unit normal onto [-1, 1]^2, decoded again in the vertex shader
+	static float2 encode_oct(float4 norm)
+	{
+		float3 n = float3(norm);
+		n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+		float2 oct = float2(n);
+		if (n.z < 0.0f) {
+			oct.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+			oct.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+		}
+		return oct;
 	}
 
 public:
@@ -23,56 +49,75 @@ public:
 		return desc;
 	}
 
-	static std::array<vk::VertexInputAttributeDescription, 3> get_attr_desc()
+	static std::array<vk::VertexInputAttributeDescription, 4> get_attr_desc()
 	{
-		std::array<vk::VertexInputAttributeDescription, 3> desc;
+		std::array<vk::VertexInputAttributeDescription, 4> desc;
 		desc[0] = vk::VertexInputAttributeDescription()
 			.setBinding(0)
 			.setLocation(0)
-			.setFormat(vk::Format::eR32G32B32A32Sfloat)
+			.setFormat(vk::Format::eR32G32B32Sfloat)
 			.setOffset(offsetof(Vertex, pos));
 		desc[1] = vk::VertexInputAttributeDescription()
 			.setBinding(0)
 			.setLocation(1)
-			.setFormat(vk::Format::eR32G32B32A32Sfloat)
+			.setFormat(vk::Format::eR8G8B8A8Unorm)
 			.setOffset(offsetof(Vertex, col));
 		desc[2] = vk::VertexInputAttributeDescription()
 			.setBinding(0)
 			.setLocation(2)
-			.setFormat(vk::Format::eR32G32B32A32Sfloat)
+			.setFormat(vk::Format::eR16G16Snorm)
 			.setOffset(offsetof(Vertex, norm));
+		desc[3] = vk::VertexInputAttributeDescription()
+			.setBinding(0)
+			.setLocation(3)
+			.setFormat(vk::Format::eR16G16Sfloat)
+			.setOffset(offsetof(Vertex, uv));
 		return desc;
 	}
 
 public:
-	float4 pos;
-	float4 col;
-	float4 norm;
+	float3 pos;
+	uint32_t col; // unorm8 rgba
+	uint32_t norm; // snorm16 octahedral normal
+	uint32_t uv; // half xy
 };
+static_assert(sizeof(Vertex) == 24, "Vertex must match the attribute formats in get_attr_desc()");
 
 namespace components
 {
 	struct Geometry
 	{
 	public:
-		Geometry(Primitive primitive)
+		Geometry(Primitive primitive, const Surface& surface = Surface())
 		{
 			switch (primitive) {
-			case Primitive::eCube: set_cube(); break;
-			case Primitive::eSphere: set_sphere(); break;
+			case Primitive::eCube: set_cube(surface); break;
+			case Primitive::eSphere: set_sphere(surface); break;
 			}
+			calc_bounds();
 		}
 
 	private:
-		void set_cube()
+		// sphere around the box of all vertices, used for culling
+		void calc_bounds()
+		{
+			float3 min = float3(FLT_MAX), max = float3(-FLT_MAX);
+			for (auto& vertex : vertices) {
+				min = glm::min(min, float3(vertex.pos));
+				max = glm::max(max, float3(vertex.pos));
+			}
+			float3 center = (min + max) * 0.5f;
+			float radius = 0.0f;
+			for (auto& vertex : vertices) radius = std::max(radius, glm::distance(center, float3(vertex.pos)));
+			bounds = float4(center, radius);
+		}
+		void set_cube(const Surface& surface)
 		{
 			const float p = 1.0f, n = -1.0f, z = 0.0f;
-			const float4 white = float4(1.0f, 1.0f, 1.0f, 1.0f);
-			const float4 red = float4(1.0f, 0.0f, 0.0f, 1.0f);
-			const float4 green = float4(0.0f, 1.0f, 0.0f, 1.0f);
-			const float4 blue = float4(0.0f, 0.0f, 1.0f, 1.0f);
+			const float4 white = float4(1.0f, 1.0f, 1.0f, 1.0f) * surface.tint;
+			const float4 red = float4(1.0f, 0.0f, 0.0f, 1.0f) * surface.tint;
 
-			const float tiling = 10.0f;
+			const float tiling = surface.tiling;
 
 			// todo: calc the vertices using rotations of a single surface?
 			vertices = {
@@ -122,7 +167,7 @@ namespace components
 				20, 21, 22, 22, 21, 23,
 			};
 		}
-		void set_sphere()
+		void set_sphere(const Surface& surface)
 		{
 			static constexpr float4x4 cols = {
 				float4(1.0f, 1.0f, 1.0f, 1.0f),
@@ -130,10 +175,9 @@ namespace components
 				float4(0.0f, 1.0f, 0.0f, 1.0f),
 				float4(0.0f, 0.0f, 1.0f, 1.0f)
 			};
-			static constexpr float4 white = float4(1.0f, 1.0f, 1.0f, 1.0f);
-			static constexpr float M = 50.0f;
-			static constexpr float N = 50.0f;
 			static constexpr float pi = (float)M_PI;
+			const float M = (float)std::max(surface.nSegments, 3u);
+			const float N = M;
 
 			uint colIndex = 0;
 			for (float m = 0; m <= M; m++) {
@@ -141,14 +185,15 @@ namespace components
 					float x = sinf(pi * m / M) * cosf(2 * pi * n / N);
 					float y = sinf(pi * m / M) * sinf(2 * pi * n / N);
 					float z = cosf(pi * m / M);
-					vertices.emplace_back(float4(x, y, z, 1.0f), cols[(colIndex++) % 4], float4(x, y, z, 1.0f));
+					float2 uv = float2(2.0f * n / N, m / M) * surface.tiling; // slices span twice the angle of rings
+					vertices.emplace_back(float4(x, y, z, 1.0f), cols[(colIndex++) % 4] * surface.tint, float4(x, y, z, 1.0f), uv);
 				}
 			}
 
 			uint nLati = static_cast<uint>(M);
 			uint nLongi = static_cast<uint>(N);
 			uint nLatiP = nLati + 1u;
-			for (uint lati = 0u; lati <= nLati; ++lati) {
+			for (uint lati = 0u; lati < nLati; ++lati) { // the last ring has no ring below it
 				for (uint longi = 0u; longi < nLongi; ++longi) {
 
 					uint latiIndex = lati * nLatiP;
@@ -168,8 +213,8 @@ namespace components
 		}
 
 	public:
-		vk::Buffer buffer;
-		vma::Allocation alloc;
+		MeshAllocation mesh; // location within the mesh arena once uploaded
+		float4 bounds; // bounding sphere, xyz center and w radius
 
 		std::vector<Vertex> vertices;
 		std::vector<Index> indices;
@@ -180,93 +225,104 @@ namespace systems
 {
 	struct Geometry
 	{
-		static inline void allocate(entt::registry& reg, DeviceWrapper& deviceWrapper, vma::Allocator& allocator, vk::CommandPool& commandPool)
+		// every pending entity is copied into the mesh arena with a single submission, returns whether there were any
+		static inline bool allocate(entt::registry& reg, DeviceWrapper& deviceWrapper, MeshArena& meshArena, StagingRing& stagingRing, vk::CommandPool& commandPool)
 		{
-			reg.view<components::Geometry, components::Allocator>().each([&](auto entity, auto& geometry) {
-				size_t vertexSize = geometry.vertices.size() * sizeof(Vertex);
-				size_t indexSize = geometry.indices.size() * sizeof(Index);
-				size_t bufferSize = vertexSize + indexSize;
-
-				// buffer
-				vk::BufferCreateInfo bufferInfo = vk::BufferCreateInfo()
-					.setSize(bufferSize)
-					.setUsage(vk::BufferUsageFlagBits::eTransferDst |
-						vk::BufferUsageFlagBits::eVertexBuffer |
-						vk::BufferUsageFlagBits::eIndexBuffer);
-				vma::AllocationCreateInfo allocCreateInfo = vma::AllocationCreateInfo()
-					.setUsage(vma::MemoryUsage::eAutoPreferDevice);
-				vk::Result result = allocator.createBuffer(&bufferInfo, &allocCreateInfo, &geometry.buffer, &geometry.alloc, nullptr);
-
-				// staging buffer
-				bufferInfo = vk::BufferCreateInfo()
-					.setSize(bufferSize)
-					.setUsage(vk::BufferUsageFlagBits::eTransferSrc);
-				allocCreateInfo = vma::AllocationCreateInfo()
-					.setUsage(vma::MemoryUsage::eAuto)
-					.setFlags(vma::AllocationCreateFlagBits::eHostAccessSequentialWrite | vma::AllocationCreateFlagBits::eMapped);
-				vma::AllocationInfo allocInfo;
-				auto stagingBuffer = allocator.createBuffer(bufferInfo, allocCreateInfo, allocInfo);
-
-				// already mapped, so just copy over
-				memcpy(allocInfo.pMappedData, geometry.vertices.data(), vertexSize);
-				memcpy(static_cast<char*>(allocInfo.pMappedData) + vertexSize, geometry.indices.data(), indexSize);
-
-				// memory transfer
-				{
-					vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
-						.setLevel(vk::CommandBufferLevel::ePrimary)
-						.setCommandPool(commandPool)
-						.setCommandBufferCount(1);
-
-					vk::CommandBuffer commandBuffer;
-					auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&allocInfo, &commandBuffer);
-
-					// begin recording to temporary command buffer
-					vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
-						.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
-					commandBuffer.begin(beginInfo);
-
-					vk::BufferCopy copyRegion = vk::BufferCopy()
-						.setSrcOffset(0)
-						.setDstOffset(0)
-						.setSize(bufferSize);
-					commandBuffer.copyBuffer(stagingBuffer.first, geometry.buffer, copyRegion);
-					commandBuffer.end();
-
-					vk::SubmitInfo submitInfo = vk::SubmitInfo()
-						.setCommandBufferCount(1)
-						.setPCommandBuffers(&commandBuffer);
-					deviceWrapper.queue.submit(submitInfo);
-					deviceWrapper.queue.waitIdle(); // TODO: change this to wait on a fence instead (upon queue submit) so multiple memory transfers would be possible
-
-					// free command buffer directly after use
-					deviceWrapper.logicalDevice.freeCommandBuffers(commandPool, commandBuffer);
+			meshArena.release_uploads(deviceWrapper, commandPool);
+			auto view = reg.view<components::Geometry, components::Allocator>();
+			if (view.begin() == view.end()) return false;
+
+			// reserve arena space first, so the whole batch fits in one staging allocation
+			size_t stagingSize = 0;
+			bool bFull = false;
+			view.each([&](auto entity, auto& geometry) {
+				if (bFull || !meshArena.allocate((uint32_t)geometry.vertices.size(), (uint32_t)geometry.indices.size(), geometry.mesh)) {
+					bFull = true;
+					return;
 				}
-
-				allocator.destroyBuffer(stagingBuffer.first, stagingBuffer.second);
+				stagingSize += geometry.vertices.size() * sizeof(Vertex) + geometry.indices.size() * sizeof(Index);
 			});
 
-			auto view = reg.view<components::Allocator>();
-			reg.erase<components::Allocator>(view.begin(), view.end());
-		}
-		static inline void deallocate(entt::registry& reg, vma::Allocator& allocator)
-		{
-			reg.view<components::Geometry, components::Deallocator>().each([&](auto entity, auto& geometry) {
-				allocator.destroyBuffer(geometry.buffer, geometry.alloc);
+			// a full arena grows to twice the size the scene needs and takes every mesh anew, they are all still on the CPU
+			if (bFull) {
+				vk::DeviceSize nVertices = 0, nIndices = 0;
+				auto geometries = reg.view<components::Geometry>();
+				geometries.each([&](auto entity, auto& geometry) {
+					nVertices += geometry.vertices.size();
+					nIndices += geometry.indices.size();
+					geometry.mesh = {};
+					reg.emplace_or_replace<components::Allocator>(entity);
+				});
+				meshArena.release_uploads(deviceWrapper, commandPool);
+				meshArena.grow(deviceWrapper, 2 * nVertices, 2 * nIndices);
+				return allocate(reg, deviceWrapper, meshArena, stagingRing, commandPool);
+			}
+
+			// already mapped, so just copy over
+			StagingAllocation staging = stagingRing.allocate(deviceWrapper, stagingSize);
+			std::vector<vk::BufferCopy> copyRegions;
+			vk::DeviceSize stagingOffset = 0;
+			auto copy_to_staging = [&](const void* pData, vk::DeviceSize size, vk::DeviceSize dstOffset) {
+				StagingAllocation region = { staging.buffer, staging.offset + stagingOffset, size, staging.pMapped + stagingOffset };
+				stagingRing.write(region, pData, size);
+				copyRegions.emplace_back(region.offset, dstOffset, size);
+				stagingOffset += size;
+			};
+			view.each([&](auto entity, auto& geometry) {
+				copy_to_staging(geometry.vertices.data(), geometry.vertices.size() * sizeof(Vertex), meshArena.get_vertex_byte_offset(geometry.mesh));
+				copy_to_staging(geometry.indices.data(), geometry.indices.size() * sizeof(Index), meshArena.get_index_byte_offset(geometry.mesh));
 			});
 
-			auto view = reg.view<components::Deallocator>();
-			reg.destroy(view.begin(), view.end());
+			// memory transfer
+			if (!copyRegions.empty()) {
+				vk::CommandBufferAllocateInfo allocInfo = vk::CommandBufferAllocateInfo()
+					.setLevel(vk::CommandBufferLevel::ePrimary)
+					.setCommandPool(commandPool)
+					.setCommandBufferCount(1);
+
+				vk::CommandBuffer commandBuffer;
+				auto res = deviceWrapper.logicalDevice.allocateCommandBuffers(&allocInfo, &commandBuffer);
+
+				// begin recording to temporary command buffer
+				vk::CommandBufferBeginInfo beginInfo = vk::CommandBufferBeginInfo()
+					.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+				commandBuffer.begin(beginInfo);
+				commandBuffer.copyBuffer(staging.buffer, meshArena.get_buffer(), copyRegions);
+
+				// later frames read the arena without waiting on this submission, the queue orders them behind the barrier
+				vk::MemoryBarrier barrier = vk::MemoryBarrier()
+					.setSrcAccessMask(vk::AccessFlagBits::eTransferWrite)
+					.setDstAccessMask(vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead);
+				commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eVertexInput, {}, barrier, {}, {});
+				commandBuffer.end();
+
+				vk::SubmitInfo submitInfo = vk::SubmitInfo()
+					.setCommandBufferCount(1)
+					.setPCommandBuffers(&commandBuffer);
+				uint64_t timelineValue = deviceWrapper.submit(submitInfo);
+				stagingRing.track(timelineValue);
+				meshArena.track_upload(commandBuffer, timelineValue);
+			}
+			else stagingRing.track(deviceWrapper.timelineValue); // nothing to copy, release the allocation right away
+
+			auto allocators = reg.view<components::Allocator>();
+			reg.erase<components::Allocator>(allocators.begin(), allocators.end());
+			return true;
 		}
-		static inline void bind(entt::registry& reg, vk::CommandBuffer& commandBuffer)
+		static inline bool deallocate(entt::registry& reg, DeviceWrapper& deviceWrapper, MeshArena& meshArena)
 		{
-			// draw geometry (TODO: use group instead of view when >1 components)
-			reg.view<components::Geometry>().each([&](auto& geometry) {
-				vk::DeviceSize offsets[] = { 0 };
-				commandBuffer.bindVertexBuffers(0, 1, &geometry.buffer, offsets);
-				commandBuffer.bindIndexBuffer(geometry.buffer, sizeof(Vertex) * geometry.vertices.size(), vk::IndexType::eUint32);
-				commandBuffer.drawIndexed((uint32_t)geometry.indices.size(), 1, 0, 0, 0);
+			auto view = reg.view<components::Geometry, components::Deallocator>();
+			if (view.begin() == view.end()) return false;
+
+			// freed ranges are handed out again right away, so earlier frames must be done drawing them
+			deviceWrapper.wait_for_submissions();
+			view.each([&](auto entity, auto& geometry) {
+				if (geometry.mesh.nIndices > 0) meshArena.free(geometry.mesh);
 			});
+
+			auto deallocators = reg.view<components::Deallocator>();
+			reg.destroy(deallocators.begin(), deallocators.end());
+			return true;
 		}
 	};
 }
\ No newline at end of file
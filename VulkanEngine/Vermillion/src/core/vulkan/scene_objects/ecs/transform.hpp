@@ -1,36 +1,101 @@
 #pragma once
 
 #include "utils/types.hpp"
-#include "vk_mem_alloc.hpp"
-#include "buffers/ring_buffer.hpp"
+#include "utils/thread_pool.hpp"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <immintrin.h>
+	#define VMI_TRANSFORM_SSE
+#endif
+
+// positions, rotations and scales of every entity in structure-of-arrays form,
+// slots are handed out in batches of four so matrices can always be built a full batch at a time
+class TransformStore
+{
+public:
+	TransformStore() = default;
+	~TransformStore() = default;
+	ROF_COPY_MOVE_DELETE(TransformStore)
+
+public:
+	uint32_t create(float3 position = float3(0.0f), Quaternion rotation = glm::identity<Quaternion>(), float3 scale = float3(1.0f))
+	{
+		if (freeSlots.empty()) grow();
+		uint32_t i = freeSlots.back();
+		freeSlots.pop_back();
+
+		set_position(i, position);
+		set_rotation(i, rotation);
+		set_scale(i, scale);
+		return i;
+	}
+	void destroy(uint32_t i)
+	{
+		// zero scale collapses the matrix, in case the slot is still drawn somewhere
+		set_scale(i, float3(0.0f));
+		freeSlots.push_back(i);
+	}
+
+	void set_position(uint32_t i, float3 position)
+	{
+		posX[i] = position.x; posY[i] = position.y; posZ[i] = position.z;
+		version++;
+	}
+	void set_rotation(uint32_t i, Quaternion rotation)
+	{
+		rotX[i] = rotation.x; rotY[i] = rotation.y; rotZ[i] = rotation.z; rotW[i] = rotation.w;
+		version++;
+	}
+	void set_scale(uint32_t i, float3 scale)
+	{
+		scaleX[i] = scale.x; scaleY[i] = scale.y; scaleZ[i] = scale.z;
+		version++;
+	}
+	float3 get_position(uint32_t i) const
+	{
+		return float3(posX[i], posY[i], posZ[i]);
+	}
+
+	// number of slots including free ones, always a multiple of the batch size
+	uint32_t get_count() const
+	{
+		return (uint32_t)posX.size();
+	}
+	// changes with every write, consumers rebuild their matrices when it differs from the one they last saw
+	uint64_t get_version() const
+	{
+		return version;
+	}
+
+private:
+	void grow()
+	{
+		uint32_t iBegin = get_count();
+		for (auto* pArray : { &posX, &posY, &posZ, &rotX, &rotY, &rotZ, &scaleX, &scaleY, &scaleZ }) pArray->resize(iBegin + batchSize, 0.0f);
+		rotW.resize(iBegin + batchSize, 1.0f);
+
+		// lowest slot of the batch is handed out first
+		for (uint32_t i = iBegin + batchSize; i > iBegin; i--) freeSlots.push_back(i - 1);
+	}
+
+public:
+	static constexpr uint32_t batchSize = 4;
+
+	std::vector<float> posX, posY, posZ;
+	std::vector<float> rotX, rotY, rotZ, rotW;
+	std::vector<float> scaleX, scaleY, scaleZ;
+
+private:
+	std::vector<uint32_t> freeSlots;
+	uint64_t version = 0;
+};
 
 namespace components
 {
+	// slot of the entity within the transform store, doubles as its instance index when drawn
 	struct Transform
 	{
-		float3 position = float3(0.0f, 0.0f, 0.0f);
-		Quaternion rotation = glm::identity<Quaternion>();
-		float3 scale = float3(1.0f, 1.0f, 1.0f);
-	};
-	struct TransformBufferDynamic
-	{
-		struct BufferFrame
-		{
-			vk::Buffer buffer;
-			vk::DescriptorSet descSet;
-			vma::Allocation alloc;
-			vma::AllocationInfo allocInfo;
-		};
-		RingBuffer<BufferFrame> bufferFrames;
-	};
-	struct TransformBufferStatic
-	{
-		// TODO: could split this up into more components to improve memory access
-		// e.g.: have desc set in a separate buffer, such that many desc sets fit into a single cache line
-		vk::Buffer buffer;
-		vk::DescriptorSet descSet;
-		vma::Allocation alloc;
-		vma::AllocationInfo allocInfo;
+		uint32_t iInstance;
 	};
 }
 
@@ -38,24 +103,95 @@ namespace systems
 {
 	struct Transform
 	{
-		static void allocate()
+		static inline void deallocate(entt::registry& reg, TransformStore& store)
 		{
-
+			reg.view<components::Transform, components::Deallocator>().each([&](auto entity, auto& transform) {
+				store.destroy(transform.iInstance);
+			});
 		}
 
-		static void deallocate()
+		// model matrices (translation * rotation * scale) of the first nMatrices slots,
+		// large stores are split into jobs across the thread pool
+		static void build_matrices(const TransformStore& store, float4x4* pMatrices, uint32_t nMatrices, ThreadPool& threadPool)
 		{
+			uint32_t nBatches = nMatrices / TransformStore::batchSize;
+			if (nMatrices < nParallelThreshold) {
+				build_batches(store, pMatrices, 0, nBatches);
+				return;
+			}
 
+			uint32_t nJobs = (nBatches + nBatchesPerJob - 1) / nBatchesPerJob;
+			threadPool.dispatch(nJobs, [&](uint32_t iJob, uint32_t iThread) {
+				uint32_t iBegin = iJob * nBatchesPerJob;
+				build_batches(store, pMatrices, iBegin, std::min(iBegin + nBatchesPerJob, nBatches));
+			});
 		}
 
-		static void update_dynamic()
+	private:
+		static inline void build_batches(const TransformStore& store, float4x4* pMatrices, uint32_t iBatchBegin, uint32_t iBatchEnd)
 		{
-			// TODO
+			for (uint32_t iBatch = iBatchBegin; iBatch < iBatchEnd; iBatch++) {
+#ifdef VMI_TRANSFORM_SSE
+				build_batch_sse(store, pMatrices, iBatch * TransformStore::batchSize);
+#else
+				for (uint32_t i = 0; i < TransformStore::batchSize; i++) build_single(store, pMatrices, iBatch * TransformStore::batchSize + i);
+#endif
+			}
 		}
-
-		static void update_static()
+		static inline void build_single(const TransformStore& store, float4x4* pMatrices, uint32_t i)
+		{
+			float x = store.rotX[i], y = store.rotY[i], z = store.rotZ[i], w = store.rotW[i];
+			float4x4& m = pMatrices[i];
+			m[0] = float4(1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + w * z), 2.0f * (x * z - w * y), 0.0f) * store.scaleX[i];
+			m[1] = float4(2.0f * (x * y - w * z), 1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + w * x), 0.0f) * store.scaleY[i];
+			m[2] = float4(2.0f * (x * z + w * y), 2.0f * (y * z - w * x), 1.0f - 2.0f * (x * x + y * y), 0.0f) * store.scaleZ[i];
+			m[3] = float4(store.posX[i], store.posY[i], store.posZ[i], 1.0f);
+		}
+#ifdef VMI_TRANSFORM_SSE
+		// same math as build_single(), each lane holds one slot until the final transposes turn lanes into columns
+		static inline void build_batch_sse(const TransformStore& store, float4x4* pMatrices, uint32_t i)
 		{
-			// TODO
+			const __m128 one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f), zero = _mm_setzero_ps();
+			__m128 x = _mm_loadu_ps(&store.rotX[i]), y = _mm_loadu_ps(&store.rotY[i]);
+			__m128 z = _mm_loadu_ps(&store.rotZ[i]), w = _mm_loadu_ps(&store.rotW[i]);
+			__m128 sx = _mm_loadu_ps(&store.scaleX[i]), sy = _mm_loadu_ps(&store.scaleY[i]), sz = _mm_loadu_ps(&store.scaleZ[i]);
+
+			__m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+			__m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+			__m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+			__m128 cols[4][4] = {
+				{
+					_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+					_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+					_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx),
+					zero
+				},
+				{
+					_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+					_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+					_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy),
+					zero
+				},
+				{
+					_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+					_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+					_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz),
+					zero
+				},
+				{ _mm_loadu_ps(&store.posX[i]), _mm_loadu_ps(&store.posY[i]), _mm_loadu_ps(&store.posZ[i]), one }
+			};
+
+			for (uint32_t iCol = 0; iCol < 4; iCol++) {
+				__m128* col = cols[iCol];
+				_MM_TRANSPOSE4_PS(col[0], col[1], col[2], col[3]);
+				for (uint32_t iLane = 0; iLane < 4; iLane++) _mm_storeu_ps(&pMatrices[i + iLane][iCol][0], col[iLane]);
+			}
 		}
+#endif
+
+	private:
+		static constexpr uint32_t nParallelThreshold = 8192;
+		static constexpr uint32_t nBatchesPerJob = 512;
 	};
-}
\ No newline at end of file
+}
@@ -3,6 +3,7 @@
 #include "components.hpp"
 #include "ecs/transform.hpp"
 #include "ecs/geometry.hpp"
+#include "scene_generator.hpp"
 
 class Scene
 {
@@ -12,26 +13,31 @@ public:
 	ROF_COPY_MOVE_DELETE(Scene)
 
 public:
-	void init()
+	void init(const SceneConfig& config = SceneConfig())
 	{
 		VMI_LOG("[Initializing] Scene...");
 
+		// load testing scenes replace the default sphere
+		if (config.nPrimitives > 0) {
+			SceneGenerator(config.seed).generate(reg, transforms, config);
+			return;
+		}
+
 		//cube = reg.create();
 		//reg.emplace<components::Geometry>(cube, Primitive::eCube);
 		//reg.emplace<components::Allocator>(cube);
-		//reg.emplace<components::Transform>(cube);
-		//reg.emplace<components::TransformBufferStatic>(cube);
+		//reg.emplace<components::Transform>(cube, transforms.create());
 
 		sphere = reg.create();
 		reg.emplace<components::Geometry>(sphere, Primitive::eSphere);
 		reg.emplace<components::Allocator>(sphere);
-		reg.emplace<components::Transform>(sphere);
-		reg.emplace<components::TransformBufferStatic>(sphere);
+		reg.emplace<components::Transform>(sphere, transforms.create());
 	}
 	void destroy()
 	{
-		//reg.emplace<components::Deallocator>(cube);
-		reg.emplace<components::Deallocator>(sphere);
+		// covers generated entities as well
+		auto view = reg.view<components::Geometry>();
+		for (auto entity : view) reg.emplace<components::Deallocator>(entity);
 	}
 	void update()
 	{
@@ -40,6 +46,7 @@ public:
 
 public:
 	entt::registry reg;
+	TransformStore transforms; // indexed by components::Transform
 private:
 	entt::entity cube;
 	entt::entity sphere;
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "components.hpp"
+#include "ecs/transform.hpp"
+#include "ecs/geometry.hpp"
+
+// parameters of a generated scene, read from a plain "key = value" file (# starts a comment)
+struct SceneConfig
+{
+	uint32_t seed = 0;
+	uint32_t nPrimitives = 0; // none keeps the default scene
+	float cubeRatio = 0.5f; // share of cubes, the rest are spheres
+	float3 boundsMin = float3(-4.0f, -4.0f, 0.0f), boundsMax = float3(4.0f, 4.0f, 20.0f); // box the centers are placed in
+	float scaleMin = 0.2f, scaleMax = 1.0f;
+	uint32_t segmentsMin = 8, segmentsMax = 50; // sphere tessellation
+	float tilingMin = 1.0f, tilingMax = 16.0f; // texture frequency, uvs are stored as halfs so keep this moderate
+
+	static SceneConfig load(const std::string& path)
+	{
+		SceneConfig config;
+		std::ifstream file(path);
+		if (!file.is_open()) {
+			VMI_WARN("Could not open scene config: " << path);
+			return config;
+		}
+
+		std::string line;
+		while (std::getline(file, line)) {
+			line = line.substr(0, line.find('#'));
+			size_t iSeparator = line.find('=');
+			if (iSeparator == std::string::npos) continue;
+
+			std::string key = line.substr(0, iSeparator);
+			key.erase(std::remove_if(key.begin(), key.end(), ::isspace), key.end());
+			std::istringstream value(line.substr(iSeparator + 1));
+
+			if (key == "seed") value >> config.seed;
+			else if (key == "primitives") value >> config.nPrimitives;
+			else if (key == "cube_ratio") value >> config.cubeRatio;
+			else if (key == "bounds_min") value >> config.boundsMin.x >> config.boundsMin.y >> config.boundsMin.z;
+			else if (key == "bounds_max") value >> config.boundsMax.x >> config.boundsMax.y >> config.boundsMax.z;
+			else if (key == "scale") value >> config.scaleMin >> config.scaleMax;
+			else if (key == "segments") value >> config.segmentsMin >> config.segmentsMax;
+			else if (key == "tiling") value >> config.tilingMin >> config.tilingMax;
+			else {
+				VMI_WARN("Ignoring unknown scene config key: " << key);
+				continue;
+			}
+			if (value.fail()) VMI_WARN("Malformed value for scene config key: " << key);
+		}
+		return config;
+	}
+};
+
+// fills a registry with seeded random primitives, the same config always produces the same scene
+class SceneGenerator
+{
+public:
+	SceneGenerator(uint32_t seed) : rng(seed) {}
+	~SceneGenerator() = default;
+	ROF_COPY_MOVE_DELETE(SceneGenerator)
+
+public:
+	void generate(entt::registry& reg, TransformStore& transforms, const SceneConfig& config)
+	{
+		VMI_LOG("Generating scene: " << config.nPrimitives << " primitives, seed " << config.seed);
+		for (uint32_t i = 0; i < config.nPrimitives; i++) {
+			Primitive primitive = uniform(0.0f, 1.0f) < config.cubeRatio ? Primitive::eCube : Primitive::eSphere;
+
+			Surface surface;
+			surface.nSegments = (uint32_t)uniform((float)config.segmentsMin, (float)config.segmentsMax + 1.0f);
+			surface.tiling = std::floor(uniform(config.tilingMin, config.tilingMax));
+			surface.tint = float4(uniform(0.3f, 1.0f), uniform(0.3f, 1.0f), uniform(0.3f, 1.0f), 1.0f);
+
+			float3 position = float3(
+				uniform(config.boundsMin.x, config.boundsMax.x),
+				uniform(config.boundsMin.y, config.boundsMax.y),
+				uniform(config.boundsMin.z, config.boundsMax.z));
+			float3 scale = float3(uniform(config.scaleMin, config.scaleMax));
+
+			entt::entity entity = reg.create();
+			reg.emplace<components::Geometry>(entity, primitive, surface);
+			reg.emplace<components::Allocator>(entity);
+			reg.emplace<components::Transform>(entity, transforms.create(position, random_rotation(), scale));
+		}
+	}
+
+private:
+	// the standard distributions differ between library implementations, this does not
+	float uniform(float min, float max)
+	{
+		float t = (float)(rng() >> 8) * (1.0f / 16777216.0f); // 24 bits in [0, 1)
+		return min + (max - min) * t;
+	}
+	// uniformly distributed unit quaternion (Shoemake)
+	Quaternion random_rotation()
+	{
+		float u0 = uniform(0.0f, 1.0f), u1 = uniform(0.0f, 1.0f), u2 = uniform(0.0f, 1.0f);
+		float a = std::sqrt(1.0f - u0), b = std::sqrt(u0);
+		float tau = 2.0f * (float)M_PI;
+		return Quaternion(a * std::cos(tau * u1), a * std::sin(tau * u1), b * std::sin(tau * u2), b * std::cos(tau * u2));
+	}
+
+private:
+	std::mt19937 rng;
+};
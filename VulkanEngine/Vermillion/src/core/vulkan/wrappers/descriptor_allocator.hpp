@@ -0,0 +1,118 @@
+#pragma once
+
+#include "devices/device_wrapper.hpp"
+
+// hands out descriptor sets from a chain of pools, a new and larger pool is created whenever the current one runs dry,
+// sets are never freed individually, reset() recycles every pool at once
+class DescriptorAllocator
+{
+public:
+	DescriptorAllocator() = default;
+	~DescriptorAllocator() = default;
+	ROF_COPY_MOVE_DELETE(DescriptorAllocator)
+
+public:
+	void init(DeviceWrapper& deviceWrapper, uint32_t nSetsPerPool = 64)
+	{
+		this->nSetsPerPool = nSetsPerPool;
+		currentPool = grab_pool(deviceWrapper);
+	}
+	void destroy(DeviceWrapper& deviceWrapper)
+	{
+		for (auto& pool : freePools) deviceWrapper.logicalDevice.destroyDescriptorPool(pool);
+		for (auto& pool : usedPools) deviceWrapper.logicalDevice.destroyDescriptorPool(pool);
+		freePools.clear();
+		usedPools.clear();
+		currentPool = nullptr;
+	}
+
+	vk::DescriptorSet allocate(DeviceWrapper& deviceWrapper, vk::DescriptorSetLayout layout)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		vk::DescriptorSetAllocateInfo allocInfo = vk::DescriptorSetAllocateInfo()
+			.setDescriptorPool(currentPool)
+			.setSetLayouts(layout);
+
+		// the pointer overload reports exhaustion instead of throwing
+		vk::DescriptorSet descSet;
+		vk::Result result = deviceWrapper.logicalDevice.allocateDescriptorSets(&allocInfo, &descSet);
+		if (result == vk::Result::eErrorOutOfPoolMemory || result == vk::Result::eErrorFragmentedPool) {
+			currentPool = grab_pool(deviceWrapper);
+			allocInfo.setDescriptorPool(currentPool);
+			result = deviceWrapper.logicalDevice.allocateDescriptorSets(&allocInfo, &descSet);
+		}
+		if (result != vk::Result::eSuccess) VMI_ERR("Descriptor set allocation unsuccessful: " << vk::to_string(result));
+		return descSet;
+	}
+	std::vector<vk::DescriptorSet> allocate(DeviceWrapper& deviceWrapper, vk::DescriptorSetLayout layout, uint32_t count)
+	{
+		std::vector<vk::DescriptorSet> descSets(count);
+		for (auto& descSet : descSets) descSet = allocate(deviceWrapper, layout);
+		return descSets;
+	}
+
+	// invalidates every set handed out so far, only once the GPU finished all submissions using them
+	void reset(DeviceWrapper& deviceWrapper)
+	{
+		for (auto& pool : usedPools) {
+			deviceWrapper.logicalDevice.resetDescriptorPool(pool);
+			freePools.push_back(pool);
+		}
+		usedPools.clear();
+		currentPool = grab_pool(deviceWrapper);
+	}
+
+	uint32_t get_pool_count()
+	{
+		return (uint32_t)(usedPools.size() + freePools.size());
+	}
+
+private:
+	vk::DescriptorPool grab_pool(DeviceWrapper& deviceWrapper)
+	{
+		vk::DescriptorPool pool;
+		if (freePools.empty()) {
+			pool = create_pool(deviceWrapper, nSetsPerPool);
+			// the next pool gets more room, so long-lived chains stay short
+			nSetsPerPool = std::min(nSetsPerPool * 2, maxSetsPerPool);
+		}
+		else {
+			pool = freePools.back();
+			freePools.pop_back();
+		}
+		usedPools.push_back(pool);
+		return pool;
+	}
+	vk::DescriptorPool create_pool(DeviceWrapper& deviceWrapper, uint32_t nSets)
+	{
+		// each type is sized relative to the set count, by how often it appears in the sets in use
+		std::array<vk::DescriptorPoolSize, poolRatios.size()> poolSizes;
+		for (size_t i = 0; i < poolRatios.size(); i++) {
+			poolSizes[i]
+				.setType(poolRatios[i].first)
+				.setDescriptorCount((uint32_t)(poolRatios[i].second * (float)nSets));
+		}
+
+		vk::DescriptorPoolCreateInfo info = vk::DescriptorPoolCreateInfo()
+			.setMaxSets(nSets)
+			.setPoolSizes(poolSizes);
+		return deviceWrapper.logicalDevice.createDescriptorPool(info);
+	}
+
+private:
+	static constexpr uint32_t maxSetsPerPool = 4096;
+	static constexpr std::array<std::pair<vk::DescriptorType, float>, 7> poolRatios = { {
+		{ vk::DescriptorType::eCombinedImageSampler, 4.0f },
+		{ vk::DescriptorType::eUniformBufferDynamic, 1.0f },
+		{ vk::DescriptorType::eUniformBuffer, 1.0f },
+		{ vk::DescriptorType::eInputAttachment, 1.0f },
+		{ vk::DescriptorType::eStorageImage, 2.0f },
+		{ vk::DescriptorType::eStorageBuffer, 2.0f },
+		{ vk::DescriptorType::eStorageBufferDynamic, 1.0f }
+	} };
+
+	vk::DescriptorPool currentPool;
+	std::vector<vk::DescriptorPool> usedPools, freePools;
+	uint32_t nSetsPerPool = 64;
+	std::mutex mutex; // passes may be built on worker threads, pools must not be used concurrently either
+};
@@ -16,8 +16,19 @@ public:
 	}
 	void destroy(DeviceWrapper& deviceWrapper)
 	{
+		if (fontUploadValue > 0) {
+			deviceWrapper.wait_for(fontUploadValue);
+			finish_font_upload(deviceWrapper);
+		}
 		deviceWrapper.logicalDevice.destroyDescriptorPool(descPool);
 	}
+	// releases the font staging buffer once its upload is done, called every frame
+	void finish_font_upload(DeviceWrapper& deviceWrapper)
+	{
+		if (fontUploadValue == 0 || deviceWrapper.get_completed_value() < fontUploadValue) return;
+		ImGui_ImplVulkan_DestroyFontUploadObjects();
+		fontUploadValue = 0;
+	}
 
 private:
 	void imgui_create_desc_pool(DeviceWrapper& deviceWrapper)
@@ -56,7 +67,7 @@ private:
 		info.Queue = deviceWrapper.queue;
 		info.PipelineCache = nullptr;
 		info.DescriptorPool = descPool;
-		info.Subpass = 0;
+		info.Subpass = 1; // drawn on top of the display image in the swapchain write
 		info.MinImageCount = syncFrames.get_size();
 		info.ImageCount = syncFrames.get_size();
 		info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
@@ -80,12 +91,13 @@ private:
 		vk::SubmitInfo submitInfo = vk::SubmitInfo()
 			.setCommandBufferCount(1)
 			.setPCommandBuffers(&commandBuffer);
-		deviceWrapper.queue.submit(submitInfo);
+		syncFrame.timelineValue = deviceWrapper.submit(submitInfo);
 
-		deviceWrapper.logicalDevice.waitIdle();
-		ImGui_ImplVulkan_DestroyFontUploadObjects();
+		// startup continues while the GPU copies, later submissions on the queue are ordered behind the upload barrier
+		fontUploadValue = syncFrame.timelineValue;
 	}
 
 private:
 	vk::DescriptorPool descPool;
+	uint64_t fontUploadValue = 0;
 };
\ No newline at end of file
@@ -0,0 +1,150 @@
+#pragma once
+
+#include "devices/device_wrapper.hpp"
+
+// deduplicates descriptor set layouts, pipeline layouts and samplers by their description,
+// every object is owned by the cache and lives until destroy()
+class LayoutCache
+{
+public:
+	LayoutCache() = default;
+	~LayoutCache() = default;
+	ROF_COPY_MOVE_DELETE(LayoutCache)
+
+public:
+	void destroy(DeviceWrapper& deviceWrapper)
+	{
+		for (auto& pair : pipelineLayouts) deviceWrapper.logicalDevice.destroyPipelineLayout(pair.second);
+		for (auto& pair : descSetLayouts) deviceWrapper.logicalDevice.destroyDescriptorSetLayout(pair.second);
+		for (auto& pair : samplers) deviceWrapper.logicalDevice.destroySampler(pair.second);
+		pipelineLayouts.clear();
+		descSetLayouts.clear();
+		samplers.clear();
+	}
+
+	vk::DescriptorSetLayout get_desc_set_layout(DeviceWrapper& deviceWrapper, std::vector<vk::DescriptorSetLayoutBinding> bindings)
+	{
+		// binding order does not change the layout
+		std::sort(bindings.begin(), bindings.end(), [](auto& a, auto& b) { return a.binding < b.binding; });
+		LayoutKey key;
+		for (auto& binding : bindings) {
+			assert(binding.pImmutableSamplers == nullptr); // not part of the key
+			key.words.insert(key.words.end(), { binding.binding, (uint64_t)binding.descriptorType, binding.descriptorCount, (uint64_t)(VkShaderStageFlags)binding.stageFlags });
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		auto it = descSetLayouts.find(key);
+		if (it != descSetLayouts.end()) return it->second;
+
+		vk::DescriptorSetLayoutCreateInfo createInfo = vk::DescriptorSetLayoutCreateInfo()
+			.setBindings(bindings);
+		vk::DescriptorSetLayout layout = deviceWrapper.logicalDevice.createDescriptorSetLayout(createInfo);
+		descSetLayouts.emplace(std::move(key), layout);
+		return layout;
+	}
+	vk::PipelineLayout get_pipeline_layout(DeviceWrapper& deviceWrapper, const std::vector<vk::DescriptorSetLayout>& setLayouts, const std::vector<vk::PushConstantRange>& pushConstantRanges = {})
+	{
+		LayoutKey key;
+		for (auto& setLayout : setLayouts) key.words.push_back((uint64_t)(VkDescriptorSetLayout)setLayout);
+		key.words.push_back(UINT64_MAX); // separates the layouts from the ranges
+		for (auto& range : pushConstantRanges) {
+			key.words.insert(key.words.end(), { (uint64_t)(VkShaderStageFlags)range.stageFlags, range.offset, range.size });
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+		auto it = pipelineLayouts.find(key);
+		if (it != pipelineLayouts.end()) return it->second;
+
+		vk::PipelineLayoutCreateInfo createInfo = vk::PipelineLayoutCreateInfo()
+			.setSetLayouts(setLayouts)
+			.setPushConstantRanges(pushConstantRanges);
+		vk::PipelineLayout layout = deviceWrapper.logicalDevice.createPipelineLayout(createInfo);
+		pipelineLayouts.emplace(std::move(key), layout);
+		return layout;
+	}
+	vk::Sampler get_sampler(DeviceWrapper& deviceWrapper, const vk::SamplerCreateInfo& createInfo)
+	{
+		assert(createInfo.pNext == nullptr); // not part of the key
+		SamplerKey key = { createInfo };
+
+		std::unique_lock<std::mutex> lock(mutex);
+		auto it = samplers.find(key);
+		if (it != samplers.end()) return it->second;
+
+		vk::Sampler sampler = deviceWrapper.logicalDevice.createSampler(createInfo);
+		samplers.emplace(key, sampler);
+		return sampler;
+	}
+
+	// nearest filtering, clamped to the edges
+	vk::Sampler get_nearest_sampler(DeviceWrapper& deviceWrapper)
+	{
+		vk::SamplerCreateInfo samplerInfo = vk::SamplerCreateInfo()
+			.setMagFilter(vk::Filter::eNearest)
+			.setMinFilter(vk::Filter::eNearest)
+			.setAnisotropyEnable(VK_FALSE)
+			.setMaxAnisotropy(0.0f)
+			.setUnnormalizedCoordinates(VK_FALSE)
+			.setBorderColor(vk::BorderColor::eIntOpaqueBlack)
+			.setAddressModeU(vk::SamplerAddressMode::eClampToEdge)
+			.setAddressModeV(vk::SamplerAddressMode::eClampToEdge)
+			.setAddressModeW(vk::SamplerAddressMode::eClampToEdge)
+			.setCompareEnable(VK_FALSE)
+			.setCompareOp(vk::CompareOp::eAlways)
+			.setMipmapMode(vk::SamplerMipmapMode::eNearest)
+			.setMipLodBias(0.0f)
+			.setMinLod(0.0f)
+			.setMaxLod(0.0f);
+		return get_sampler(deviceWrapper, samplerInfo);
+	}
+
+private:
+	// both layout kinds reduce to a flat list of integers
+	struct LayoutKey
+	{
+		std::vector<uint64_t> words;
+		bool operator==(const LayoutKey& other) const
+		{
+			return words == other.words;
+		}
+	};
+	struct LayoutHash
+	{
+		size_t operator()(const LayoutKey& key) const
+		{
+			size_t hash = key.words.size();
+			for (uint64_t word : key.words) hash ^= std::hash<uint64_t>()(word) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+			return hash;
+		}
+	};
+	// sampler descriptions are plain 32 bit values past the header, so they are compared bytewise
+	static constexpr size_t samplerKeyBegin = offsetof(VkSamplerCreateInfo, flags);
+	static constexpr size_t samplerKeySize = sizeof(VkSamplerCreateInfo) - samplerKeyBegin;
+	struct SamplerKey
+	{
+		VkSamplerCreateInfo info;
+		bool operator==(const SamplerKey& other) const
+		{
+			return memcmp(get_bytes(), other.get_bytes(), samplerKeySize) == 0;
+		}
+		const uint8_t* get_bytes() const
+		{
+			return reinterpret_cast<const uint8_t*>(&info) + samplerKeyBegin;
+		}
+	};
+	struct SamplerHash
+	{
+		size_t operator()(const SamplerKey& key) const
+		{
+			const uint8_t* pBytes = key.get_bytes();
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < samplerKeySize; i++) hash = (hash ^ pBytes[i]) * 1099511628211ull;
+			return (size_t)hash;
+		}
+	};
+
+	std::unordered_map<LayoutKey, vk::DescriptorSetLayout, LayoutHash> descSetLayouts;
+	std::unordered_map<LayoutKey, vk::PipelineLayout, LayoutHash> pipelineLayouts;
+	std::unordered_map<SamplerKey, vk::Sampler, SamplerHash> samplers;
+	std::mutex mutex; // passes may be built on worker threads
+};
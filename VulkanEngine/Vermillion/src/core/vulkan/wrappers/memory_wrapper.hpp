@@ -0,0 +1,127 @@
+#pragma once
+
+// live heap usage against the budget VMA reports, along with the size of every named allocation
+class MemoryWrapper
+{
+public:
+	MemoryWrapper() = default;
+	~MemoryWrapper() = default;
+	ROF_COPY_MOVE_DELETE(MemoryWrapper)
+
+public:
+	void init(DeviceWrapper& deviceWrapper)
+	{
+		bBudgetExtension = deviceWrapper.bMemoryBudget;
+		if (!bBudgetExtension) VMI_WARN("VK_EXT_memory_budget unavailable, budgets are estimated by VMA");
+
+		auto& memProperties = deviceWrapper.deviceMemProperties;
+		heaps.resize(memProperties.memoryHeapCount);
+		for (uint32_t i = 0; i < heaps.size(); i++) {
+			heaps[i].bDeviceLocal = (bool)(memProperties.memoryHeaps[i].flags & vk::MemoryHeapFlagBits::eDeviceLocal);
+		}
+	}
+
+	// querying is not free, so it only happens every few frames
+	void update(vma::Allocator& allocator)
+	{
+		if (++nFramesSinceUpdate < updateInterval) return;
+		nFramesSinceUpdate = 0;
+
+		std::array<vma::Budget, VK_MAX_MEMORY_HEAPS> budgets;
+		allocator.getHeapBudgets(budgets.data());
+		for (uint32_t i = 0; i < heaps.size(); i++) {
+			Heap& heap = heaps[i];
+			heap.usage = budgets[i].usage;
+			heap.budget = budgets[i].budget;
+			heap.history[heap.iHistory] = to_mib(heap.usage);
+			heap.iHistory = (heap.iHistory + 1) % heap.history.size();
+
+			// only warn when crossing the threshold, not on every update above it
+			bool bNearBudget = heap.budget > 0 && (float)heap.usage > warningThreshold * (float)heap.budget;
+			if (bNearBudget && !heap.bNearBudget) {
+				VMI_WARN("Memory heap " << i << " at " << to_mib(heap.usage) << " of " << to_mib(heap.budget) << " MiB budget");
+			}
+			heap.bNearBudget = bNearBudget;
+		}
+
+		read_named_allocations(allocator);
+	}
+
+	void handle_imgui()
+	{
+		ImGui::Begin("Memory Budget");
+		ImGui::Text(bBudgetExtension ? "Source: VK_EXT_memory_budget" : "Source: VMA estimate");
+		for (uint32_t i = 0; i < heaps.size(); i++) {
+			Heap& heap = heaps[i];
+			if (heap.budget == 0) continue;
+
+			std::string label = std::to_string(to_mib(heap.usage)).append(" / ").append(std::to_string(to_mib(heap.budget))).append(" MiB");
+			ImGui::Text("Heap %u (%s)", i, heap.bDeviceLocal ? "device local" : "host");
+			if (heap.bNearBudget) ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Usage above %.0f%% of budget", warningThreshold * 100.0f);
+			ImGui::ProgressBar((float)heap.usage / (float)heap.budget, ImVec2(-1.0f, 0.0f), label.c_str());
+			ImGui::PlotLines(std::string("##heap").append(std::to_string(i)).c_str(), heap.history.data(), (int)heap.history.size(),
+				(int)heap.iHistory, "MiB over time", 0.0f, (float)to_mib(heap.budget), ImVec2(-1.0f, 40.0f));
+		}
+
+		// allocations are grouped by name, numbered per-frame copies count towards the same entry
+		ImGui::Separator();
+		vk::DeviceSize maxSize = 1;
+		for (auto& allocation : namedAllocations) maxSize = std::max(maxSize, allocation.second);
+		for (auto& allocation : namedAllocations) {
+			std::string label = std::string(allocation.first).append(": ").append(std::to_string(to_kib(allocation.second))).append(" KiB");
+			ImGui::ProgressBar((float)allocation.second / (float)maxSize, ImVec2(-1.0f, 0.0f), label.c_str());
+		}
+		ImGui::End();
+	}
+
+private:
+	void read_named_allocations(vma::Allocator& allocator)
+	{
+		// VMA has no way to iterate its allocations, but its detailed stats list each of them with size and name
+		std::string stats = allocator.buildStatsString(true);
+		namedAllocations.clear();
+
+		const std::string nameKey = "\"Name\": \"";
+		const std::string sizeKey = "\"Size\": ";
+		for (size_t iName = stats.find(nameKey); iName != std::string::npos; iName = stats.find(nameKey, iName + 1)) {
+			// allocation objects are flat, their size precedes the name
+			size_t iObject = stats.rfind('{', iName);
+			size_t iSize = stats.find(sizeKey, iObject);
+			if (iObject == std::string::npos || iSize == std::string::npos || iSize > iName) continue;
+
+			size_t iNameBegin = iName + nameKey.size();
+			std::string name = stats.substr(iNameBegin, stats.find('"', iNameBegin) - iNameBegin);
+			vk::DeviceSize size = std::stoull(stats.substr(iSize + sizeKey.size(), 20));
+
+			// strip per-frame indices, e.g. "Gradients 2"
+			size_t iSuffix = name.find_last_not_of("0123456789");
+			if (iSuffix != std::string::npos && iSuffix + 1 < name.size() && name[iSuffix] == ' ') name.erase(iSuffix);
+			namedAllocations[name] += size;
+		}
+	}
+	static uint64_t to_mib(vk::DeviceSize size)
+	{
+		return size / (1024 * 1024);
+	}
+	static uint64_t to_kib(vk::DeviceSize size)
+	{
+		return size / 1024;
+	}
+
+private:
+	struct Heap
+	{
+		vk::DeviceSize usage = 0, budget = 0;
+		bool bDeviceLocal = false;
+		bool bNearBudget = false;
+		std::array<float, 120> history = {};
+		uint32_t iHistory = 0;
+	};
+	std::vector<Heap> heaps;
+	std::map<std::string, vk::DeviceSize> namedAllocations;
+	bool bBudgetExtension = false;
+
+	static constexpr float warningThreshold = 0.9f;
+	static constexpr uint32_t updateInterval = 30;
+	uint32_t nFramesSinceUpdate = updateInterval - 1; // update right away
+};
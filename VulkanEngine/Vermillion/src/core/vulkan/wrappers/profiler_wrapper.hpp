@@ -0,0 +1,253 @@
+#pragma once
+
+// GPU timestamps around each pass, one range of queries per frame in flight
+class ProfilerWrapper
+{
+public:
+	// the gradients pass may run on the compute queue, so it and the display are measured from stamps of their own
+	enum Stamp : uint32_t
+	{
+		eFrameBegin,
+		eForward,
+		eComputeBegin,
+		eGradients,
+		eDisplayBegin,
+		eDisparity,
+		eSwapchainWrite,
+		eStampCount
+	};
+
+public:
+	ProfilerWrapper() = default;
+	~ProfilerWrapper() = default;
+	ROF_COPY_MOVE_DELETE(ProfilerWrapper)
+
+public:
+	void init(DeviceWrapper& deviceWrapper, uint32_t nFrames)
+	{
+		// timestamps are only meaningful when the queue actually writes them
+		uint32_t validBits = deviceWrapper.physicalDevice.getQueueFamilyProperties()[deviceWrapper.iQueue].timestampValidBits;
+		if (validBits == 0) {
+			VMI_WARN("GPU timestamps unsupported on the graphics queue, profiler disabled");
+			return;
+		}
+		timestampMask = validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1ull;
+		timestampPeriod = deviceWrapper.deviceProperties.limits.timestampPeriod;
+
+		// compute only families are allowed to lack timestamps
+		bAsyncCompute = deviceWrapper.bAsyncCompute;
+		if (bAsyncCompute && deviceWrapper.physicalDevice.getQueueFamilyProperties()[deviceWrapper.iComputeQueue].timestampValidBits == 0) {
+			VMI_WARN("GPU timestamps unsupported on the compute queue, gradients pass is not profiled");
+			bComputeStamps = false;
+		}
+
+		vk::QueryPoolCreateInfo info = vk::QueryPoolCreateInfo()
+			.setQueryType(vk::QueryType::eTimestamp)
+			.setQueryCount(nFrames * eStampCount);
+		queryPool = deviceWrapper.logicalDevice.createQueryPool(info);
+
+		bPending.assign(nFrames, false);
+		bEnabled = true;
+	}
+	void destroy(DeviceWrapper& deviceWrapper)
+	{
+		if (!bEnabled) return;
+		deviceWrapper.logicalDevice.destroyQueryPool(queryPool);
+		bEnabled = false;
+	}
+
+	// call after the frame's timeline value was waited on, before recording into it again
+	void read_frame(DeviceWrapper& deviceWrapper, uint32_t iFrame)
+	{
+		if (!bEnabled || !bPending[iFrame]) return;
+		bPending[iFrame] = false;
+
+		// passes culled by the frame graph leave their queries unwritten, so availability is queried alongside
+		std::array<uint64_t, eStampCount * 2> results;
+		vk::Result result = deviceWrapper.logicalDevice.getQueryPoolResults(queryPool, iFrame * eStampCount, eStampCount,
+			sizeof(results), results.data(), sizeof(uint64_t) * 2, vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability);
+		if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) return;
+
+		std::array<uint64_t, eStampCount> stamps;
+		std::array<bool, eStampCount> bAvailable;
+		for (uint32_t i = 0; i < eStampCount; i++) {
+			stamps[i] = results[i * 2];
+			bAvailable[i] = results[i * 2 + 1] != 0;
+		}
+		if (!bAvailable[eFrameBegin] || !bAvailable[eSwapchainWrite]) {
+			bPendingCompute = false;
+			return;
+		}
+
+		// passes, measured from the stamp that begins them, culled ones count as zero
+		auto measure = [&](Stamp begin, Stamp end) {
+			bool bWritten = bAvailable[begin] && bAvailable[end];
+			accumulate(passTimes[end], bWritten ? to_ms(stamps[begin], stamps[end]) : 0.0f);
+		};
+		measure(eFrameBegin, eForward);
+		measure(eComputeBegin, eGradients);
+		measure(eDisplayBegin, eDisparity);
+		measure(eDisparity, eSwapchainWrite);
+		accumulate(frameTime, to_ms(stamps[eFrameBegin], stamps[eSwapchainWrite]));
+		if (bAvailable[eForward]) record_forward(to_ms(stamps[eFrameBegin], stamps[eForward]));
+
+		// the previous frame's compute work overlaps this frame's forward pass, so its share is only complete now
+		Span forward = { stamps[eFrameBegin], bAvailable[eForward] ? stamps[eForward] : stamps[eFrameBegin] };
+		if (bPendingCompute) {
+			float overlap = pendingOverlap + get_overlap(pendingCompute, forward);
+			float duration = to_ms(pendingCompute.begin, pendingCompute.end);
+			accumulate(computeOverlap, overlap);
+			accumulate(computeOverlapShare, duration > 0.0f ? 100.0f * overlap / duration : 0.0f);
+		}
+		bPendingCompute = bAsyncCompute && bComputeStamps && bAvailable[eComputeBegin] && bAvailable[eGradients];
+		if (bPendingCompute) {
+			pendingCompute = { stamps[eComputeBegin], stamps[eGradients] };
+			pendingOverlap = get_overlap(pendingCompute, { stamps[eDisplayBegin], stamps[eSwapchainWrite] });
+		}
+
+		// frames are read in submission order, so the gap to the previous frame is the time the queue sat idle,
+		// without a barrier between submissions this frame may also begin before the previous one ended
+		if (lastFrameEnd != 0) {
+			accumulate(idleGap, stamps[eFrameBegin] > lastFrameEnd ? to_ms(lastFrameEnd, stamps[eFrameBegin]) : 0.0f);
+		}
+		lastFrameEnd = stamps[eSwapchainWrite];
+	}
+	void begin_frame(vk::CommandBuffer& commandBuffer, uint32_t iFrame)
+	{
+		if (!bEnabled) return;
+		commandBuffer.resetQueryPool(queryPool, iFrame * eStampCount, eStampCount);
+		commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, iFrame * eStampCount + eFrameBegin);
+		bPending[iFrame] = true;
+	}
+	void write_stamp(vk::CommandBuffer& commandBuffer, uint32_t iFrame, Stamp stamp)
+	{
+		if (!bEnabled) return;
+		if (!bComputeStamps && (stamp == eComputeBegin || stamp == eGradients)) return;
+		commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, iFrame * eStampCount + stamp);
+	}
+
+	// cpu side frame pacing
+	void record_frame_wait(float ms)
+	{
+		accumulate(frameWait, ms);
+	}
+	// time from sampling a frame's input until the GPU finished the work it presents
+	void record_latency(float ms)
+	{
+		accumulate(latency, ms);
+		latencySum += ms;
+		latencyMax = std::max(latencyMax, ms);
+		nLatencySamples++;
+
+		if (nLatencySamples == latencyLogInterval) {
+			VMI_LOG("Input to present latency: avg " << latencySum / nLatencySamples << " ms, max " << latencyMax << " ms over " << nLatencySamples << " frames");
+			latencyMaxLogged = latencyMax;
+			latencySum = 0.0f;
+			latencyMax = 0.0f;
+			nLatencySamples = 0;
+		}
+	}
+	void record_frames_in_flight(uint32_t nFrames)
+	{
+		framesInFlight = nFrames;
+		accumulate(framesInFlightAvg, (float)nFrames);
+	}
+
+	void handle_imgui()
+	{
+		ImGui::Begin("Frame Pacing");
+		ImGui::Text("Frames in flight: %u (avg %.2f)", framesInFlight, framesInFlightAvg);
+		ImGui::Text("CPU blocked on timeline: %.3f ms", frameWait);
+		ImGui::Text("Input to present: %.3f ms (max %.3f ms)", latency, latencyMaxLogged);
+		ImGui::End();
+
+		ImGui::Begin("GPU Timings");
+		if (bEnabled) {
+			ImGui::Text("Forward:         %.3f ms", passTimes[eForward]);
+			ImGui::Text("Gradients:       %.3f ms%s", passTimes[eGradients], bAsyncCompute ? " (compute queue)" : "");
+			ImGui::Text("Disparity:       %.3f ms", passTimes[eDisparity]);
+			ImGui::Text("Swapchain Write: %.3f ms", passTimes[eSwapchainWrite]);
+			ImGui::Text("Frame (GPU):     %.3f ms", frameTime);
+			ImGui::Text("Idle between frames: %.3f ms", idleGap);
+			if (bAsyncCompute && bComputeStamps) {
+				// stamps of both queues are compared directly, which assumes they share the device clock (true on common drivers)
+				ImGui::Text("Async compute overlap: %.3f ms (%.1f%%)", computeOverlap, computeOverlapShare);
+			}
+		}
+		else {
+			ImGui::Text("Timestamps unsupported");
+		}
+		ImGui::End();
+	}
+
+private:
+	// unsmoothed forward pass times, logged in intervals so runs (e.g. before and after a vertex format change) can be compared in the log
+	void record_forward(float ms)
+	{
+		forwardSum += ms;
+		forwardMin = std::min(forwardMin, ms);
+		nForwardSamples++;
+
+		if (nForwardSamples == forwardLogInterval) {
+			VMI_LOG("Forward pass: avg " << forwardSum / nForwardSamples << " ms, min " << forwardMin << " ms over " << nForwardSamples << " frames");
+			forwardSum = 0.0f;
+			forwardMin = FLT_MAX;
+			nForwardSamples = 0;
+		}
+	}
+
+	struct Span
+	{
+		uint64_t begin, end;
+	};
+	float to_ms(uint64_t begin, uint64_t end)
+	{
+		uint64_t ticks = (end - begin) & timestampMask;
+		return (float)((double)ticks * (double)timestampPeriod / 1000000.0);
+	}
+	float get_overlap(Span a, Span b)
+	{
+		uint64_t begin = std::max(a.begin, b.begin), end = std::min(a.end, b.end);
+		return end > begin ? to_ms(begin, end) : 0.0f;
+	}
+	void accumulate(float& average, float value)
+	{
+		// smooth values out, single frames are too noisy to read
+		average = average * 0.95f + value * 0.05f;
+	}
+
+private:
+	vk::QueryPool queryPool;
+	std::vector<bool> bPending; // whether a frame's queries were written and not yet read
+	uint64_t timestampMask = UINT64_MAX;
+	uint64_t lastFrameEnd = 0;
+	float timestampPeriod = 1.0f; // nanoseconds per tick
+	bool bEnabled = false;
+	bool bAsyncCompute = false;
+	bool bComputeStamps = true;
+
+	// gradients pass of the last frame read, waiting for the next frame's forward pass it may overlap with
+	Span pendingCompute = {};
+	float pendingOverlap = 0.0f;
+	bool bPendingCompute = false;
+
+	// averaged results in milliseconds
+	std::array<float, eStampCount> passTimes = {};
+	float frameTime = 0.0f;
+	float idleGap = 0.0f;
+	float computeOverlap = 0.0f, computeOverlapShare = 0.0f; // gradients pass time spent alongside graphics work
+	float frameWait = 0.0f;
+	float latency = 0.0f;
+	float framesInFlightAvg = 0.0f;
+	uint32_t framesInFlight = 0;
+
+	// latency summary over the last logging interval
+	static constexpr uint32_t latencyLogInterval = 1000;
+	float latencySum = 0.0f, latencyMax = 0.0f, latencyMaxLogged = 0.0f;
+	uint32_t nLatencySamples = 0;
+
+	// forward pass summary, only over frames that simulated the lightfield
+	static constexpr uint32_t forwardLogInterval = 1000;
+	float forwardSum = 0.0f, forwardMin = FLT_MAX;
+	uint32_t nForwardSamples = 0;
+};
@@ -52,6 +52,7 @@ private:
 		}
 
 		// settle with fifo present mode should the requested one not be available
+		VMI_WARN("Present mode " << vk::to_string(targetPresentMode) << " unavailable. Falling back to FIFO.");
 		presentMode = vk::PresentModeKHR::eFifo;
 	}
 	void choose_extent(DeviceWrapper& deviceWrapper, Window& window)
@@ -67,12 +68,15 @@ private:
 	}
 	void create_swapchain(DeviceWrapper& deviceWrapper, Window& window)
 	{
-		if (deviceWrapper.capabilities.minImageCount > nTargetSwapchainImages) nImages = deviceWrapper.capabilities.minImageCount;
-		else nImages = nTargetSwapchainImages;
+		// mailbox needs a spare image to replace while one is presented and another one rendered to
+		uint32_t nTargetImages = presentMode == vk::PresentModeKHR::eMailbox ? nTargetSwapchainImagesMailbox : nTargetSwapchainImages;
+		nImages = std::max(nTargetImages, deviceWrapper.capabilities.minImageCount);
+		if (deviceWrapper.capabilities.maxImageCount > 0) nImages = std::min(nImages, deviceWrapper.capabilities.maxImageCount);
 
 		VMI_LOG("    Selected swapchain formatting:");
 		VMI_LOG("    - Format: " << (uint32_t)surfaceFormat.format);
 		VMI_LOG("    - Color space: " << (uint32_t)surfaceFormat.colorSpace);
+		VMI_LOG("    - Present mode: " << vk::to_string(presentMode) << " with " << nImages << " images");
 		vk::SwapchainCreateInfoKHR swapchainInfo = vk::SwapchainCreateInfoKHR()
 			// image settings
 			.setMinImageCount(nImages)
@@ -135,12 +139,12 @@ private:
 private:
 	static constexpr vk::Format targetFormat = vk::Format::eB8G8R8A8Srgb;
 	static constexpr vk::ColorSpaceKHR targetColorSpace = vk::ColorSpaceKHR::eSrgbNonlinear;
-	static constexpr vk::PresentModeKHR targetPresentMode = vk::PresentModeKHR::eFifo; // vsync
-	//static constexpr vk::PresentModeKHR targetPresentMode = vk::PresentModeKHR::eFifoRelaxed; // vsync?
-	//static constexpr vk::PresentModeKHR targetPresentMode = vk::PresentModeKHR::eImmediate; // no vsync, tearing very likely
-	//static constexpr vk::PresentModeKHR targetPresentMode = vk::PresentModeKHR::eMailbox; // better than immediate, if available
 
 public:
+	// fifo: vsync, fifo relaxed: tears when late, immediate: no vsync, mailbox: uncapped without tearing, if available
+	// takes effect on the next (re)creation
+	vk::PresentModeKHR targetPresentMode = vk::PresentModeKHR::eFifo;
+
 	vk::SwapchainKHR swapchain;
 	vk::SurfaceFormatKHR surfaceFormat;
 	vk::PresentModeKHR presentMode;
@@ -151,5 +155,6 @@ public:
 	std::vector<vk::ImageView> imageViews;
 
 private:
-	static constexpr uint32_t nTargetSwapchainImages = 2; // max frames in flight (minimum for swapchain)
+	static constexpr uint32_t nTargetSwapchainImages = 2;
+	static constexpr uint32_t nTargetSwapchainImagesMailbox = 3;
 };
\ No newline at end of file
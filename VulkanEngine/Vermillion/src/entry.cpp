@@ -1,7 +1,9 @@
 #include "pch.hpp"
 #include "application/application.hpp"
+#include "application/validator.hpp"
+#include "application/self_test.hpp"
 
-int main() {
+int main(int argc, char** argv) {
 
 #ifdef _WIN32
     VMI_LOG("Windows-x64");
@@ -11,7 +13,21 @@ int main() {
     DEBUG_ONLY(VMI_LOG("Debug build\n"));
 
     try {
-        Application app;
+        LaunchOptions options = LaunchOptions::parse(argc, argv);
+        // headless, e.g. on machines without a GPU
+        if (!options.cpuEstimatePath.empty()) {
+            CpuEstimator::run(options.cpuEstimatePath, 0, "disparity_cpu.pfm");
+            return EXIT_SUCCESS;
+        }
+        if (!options.validatePath.empty()) {
+            Validator validator;
+            return validator.run(options.validatePath, options.bUpdateGolden) ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        if (options.bSelfTest) {
+            return SelfTest::run() ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+
+        Application app(options);
         app.run();
     }
     catch (const std::exception& e) {
@@ -6,10 +6,18 @@
 #include <queue>
 #include <optional>
 #include <set>
+#include <map>
+#include <unordered_map>
 #include <cstdint>
 #include <algorithm>
 #include <fstream>
 #include <filesystem>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <random>
+#include <sstream>
 
 // Enable the WSI extensions
 #if defined(_WIN32)